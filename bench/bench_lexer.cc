@@ -0,0 +1,178 @@
+/*
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * @file
+ *
+ * @brief Lexer throughput (MB/s) for the istream and memory-mapped input paths
+ *
+ * Usage: bench_lexer [-r repetitions] [-s size in MB] [file ...]
+ *
+ * Without any files, a large Cool program of the requested size is generated in a temporary file.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "cool_parse.h"
+#include "mapped_file.h"
+#include "parse_context.h"
+#include "stringtab.h"
+
+extern int cool_yy_flex_debug;
+
+namespace {
+
+/// Write a Cool program of at least \p size bytes to \p os
+void GenerateSource(std::ostream& os, std::size_t size) {
+  std::size_t written = 0;
+  for (int i = 0; written < size; i++) {
+    std::string klass = "class Gen" + std::to_string(i) + " inherits IO {\n"
+      "  count" + std::to_string(i) + " : Int <- " + std::to_string(i * 7919 % 100000) + ";\n"
+      "  label : String <- \"generated class number " + std::to_string(i) + "\";\n"
+      "  (* A comment that the lexer has to skip over (* including a nested one *) *)\n"
+      "  step(x : Int, y : Int) : Int {\n"
+      "    let z : Int <- x * 3 + y in {\n"
+      "      -- a line comment\n"
+      "      while z < 1000 loop z <- z + count" + std::to_string(i) + " pool;\n"
+      "      if z = y then out_string(\"equal\\n\") else out_int(z) fi;\n"
+      "      z;\n"
+      "    }\n"
+      "  };\n"
+      "};\n\n";
+    os << klass;
+    written += klass.size();
+  }
+}
+
+/// Lex all tokens in the current input of \p context, returning the number of tokens
+std::size_t LexAll(cool::ParseContext* context) {
+  YYSTYPE yylval;
+  std::size_t tokens = 0;
+  while (cool_yylex(&yylval, context) != 0) {
+    tokens++;
+  }
+  cool_yy_scan_end(context);
+  return tokens;
+}
+
+std::size_t LexStream(const std::string& path) {
+  std::ifstream input_stream(path);
+  if (input_stream.fail()) {
+    std::cerr << "Could not open input file: " << path << std::endl;
+    exit(1);
+  }
+  cool::ParseContext context(path.c_str());
+  cool_yy_scan_stream(&context, &input_stream);
+  return LexAll(&context);
+}
+
+std::size_t LexMapped(const std::string& path) {
+  cool::MappedFile mapped_file;
+  if (!mapped_file.Open(path.c_str(), 2)) {
+    std::cerr << "Could not map input file: " << path << std::endl;
+    exit(1);
+  }
+  cool::ParseContext context(path.c_str());
+  cool_yy_scan_in_place(&context, mapped_file.data(), mapped_file.size());
+  return LexAll(&context);
+}
+
+/// Report the best throughput over \p repetitions runs of \p lex over all of the \p paths
+void Measure(const char* name, std::size_t (*lex)(const std::string&),
+             const std::vector<std::string>& paths, std::size_t bytes, int repetitions) {
+  double best = 0;
+  std::size_t tokens = 0;
+  for (int r = 0; r < repetitions; r++) {
+    auto start = std::chrono::steady_clock::now();
+    tokens = 0;
+    for (auto& path : paths) {
+      tokens += lex(path);
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    best = std::max(best, bytes / elapsed.count() / (1024 * 1024));
+  }
+  std::cout << name << ": " << tokens << " tokens, " << best << " MB/s" << std::endl;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  cool_yy_flex_debug = 0;
+  int repetitions = 5;
+  std::size_t size_mb = 64;
+
+  int c;
+  while ((c = getopt(argc, argv, "r:s:")) != -1) {
+    switch (c) {
+      case 'r':
+        repetitions = std::atoi(optarg);
+        break;
+      case 's':
+        size_mb = std::atoi(optarg);
+        break;
+      default:
+        std::cerr << "Usage: " << argv[0] << " [-r repetitions] [-s size in MB] [file ...]"
+                  << std::endl;
+        return 85;
+    }
+  }
+
+  std::vector<std::string> paths(argv + optind, argv + argc);
+  std::string generated;
+  if (paths.empty()) {
+    char path[] = "/tmp/bench_lexerXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+      std::cerr << "Could not create temporary file" << std::endl;
+      return 1;
+    }
+    close(fd);
+    generated = path;
+    std::ofstream os(generated);
+    GenerateSource(os, size_mb * 1024 * 1024);
+    paths.push_back(generated);
+  }
+
+  std::size_t bytes = 0;
+  for (auto& path : paths) {
+    cool::MappedFile mapped_file;
+    if (!mapped_file.Open(path.c_str(), 2)) {
+      std::cerr << "Could not map input file: " << path << std::endl;
+      return 1;
+    }
+    bytes += mapped_file.size();
+  }
+  std::cout << "Lexing " << bytes / (1024.0 * 1024) << " MB, best of " << repetitions << std::endl;
+
+  // Lex once to populate the symbol tables, so that both paths only look up existing entries
+  for (auto& path : paths) {
+    LexStream(path);
+  }
+  Measure("istream", LexStream, paths, bytes, repetitions);
+  Measure("mmap", LexMapped, paths, bytes, repetitions);
+
+  if (!generated.empty()) {
+    std::remove(generated.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,122 @@
+/*
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+
+/**
+ * @file
+ *
+ * @brief ScopedTable implementations on the scope pattern of deeply nested let expressions
+ *
+ * Usage: bench_scopedtab [-r repetitions] [-d nesting depth] [-n lookups per scope]
+ *
+ * Simulates typechecking `let x1 : T <- e in let x2 : T <- e in ... body` where each let binds a
+ * new identifier in its own scope and each initializer refers to variables bound by enclosing lets.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include "scopedtab.h"
+#include "stringtab.h"
+
+namespace {
+
+/// Enter \p depth nested scopes (each binding one variable after looking up \p lookups variables)
+/// and then exit them all, returning the number of lookups that found a binding
+template <class Table>
+std::size_t NestedLets(Table& table, const std::vector<cool::Symbol*>& names, std::size_t depth,
+                       std::size_t lookups) {
+  std::size_t found = 0;
+  for (std::size_t i = 0; i < depth; i++) {
+    for (std::size_t j = 0; j < lookups; j++) {
+      // Variables bound by enclosing lets, or the one about to be bound (a miss, i.e. a reference
+      // that would fall through to the class attributes)
+      found += table.Lookup(names[(i * 7 + j * 13) % (i + 1)]) != nullptr;
+    }
+    table.EnterScope();
+    table.AddToScope(names[i], names[i]);
+  }
+  for (std::size_t i = 0; i < depth; i++) {
+    table.ExitScope();
+  }
+  return found;
+}
+
+/// Report the best time per let over \p repetitions runs of 1000 method bodies
+template <class Table>
+void Measure(const char* name, const std::vector<cool::Symbol*>& names, std::size_t depth,
+             std::size_t lookups, int repetitions) {
+  const int kBodies = 1000;
+  double best = 0;
+  std::size_t found = 0;
+  Table table;
+  for (int r = 0; r < repetitions; r++) {
+    auto start = std::chrono::steady_clock::now();
+    for (int b = 0; b < kBodies; b++) {
+      found = NestedLets(table, names, depth, lookups);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    double per_let = elapsed.count() / (kBodies * depth);
+    if (r == 0 || per_let < best) best = per_let;
+  }
+  std::cout << name << ": " << best << " ns/let (" << found << " found)" << std::endl;
+}
+
+}  // anonymous namespace
+
+int main(int argc, char* argv[]) {
+  int repetitions = 5;
+  std::size_t depth = 256, lookups = 4;
+
+  int c;
+  while ((c = getopt(argc, argv, "r:d:n:")) != -1) {
+    switch (c) {
+      case 'r':
+        repetitions = std::atoi(optarg);
+        break;
+      case 'd':
+        depth = std::atoi(optarg);
+        break;
+      case 'n':
+        lookups = std::atoi(optarg);
+        break;
+      default:
+        std::cerr << "Usage: " << argv[0]
+                  << " [-r repetitions] [-d nesting depth] [-n lookups per scope]" << std::endl;
+        return 85;
+    }
+  }
+
+  std::vector<cool::Symbol*> names;
+  for (std::size_t i = 0; i < depth; i++) {
+    names.push_back(cool::gIdentTable.emplace("x" + std::to_string(i)));
+  }
+  std::cout << depth << " nested lets, " << lookups << " lookups per let, best of " << repetitions
+            << std::endl;
+
+  typedef cool::Symbol* Key;
+  typedef cool::Symbol* Value;
+  Measure<cool::ScopedTable<Key, Value>>("ScopedTable", names, depth, lookups, repetitions);
+  Measure<cool::PersistentScopedTable<Key, Value>>("PersistentScopedTable", names, depth, lookups,
+                                                   repetitions);
+  Measure<cool::FlatScopedTable<Key, Value>>("FlatScopedTable", names, depth, lookups,
+                                             repetitions);
+  return 0;
+}
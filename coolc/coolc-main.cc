@@ -0,0 +1,270 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <cstdio>
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include <unistd.h>
+#include "spdlog/spdlog.h"
+#include "spdlog/sinks/stdout_color_sinks.h"
+
+#include "ast.h"
+#include "ast_context.h"
+#include "semant.h"
+#include "cgen.h"
+#include "parallel.h"
+#include "mapped_file.h"
+#include "parse_context.h"
+#include "stringtab.h"
+#include "time_report.h"
+
+// Lexer and parser associated variables
+extern int cool_yy_flex_debug;  // Control Flex debugging (set to 1 to turn on)
+extern int cool_yydebug;        // Control Bison debugging (set to 1 to turn on)
+
+namespace {
+
+void usage(const char *program) {
+  std::cerr << "Usage: " << program << " [-lpscragtTOmR] [-Os] [-i min:max] [-j threads] [-o file] [-J file] file [...]" << std::endl;
+}
+
+/**
+ * @brief Lex and parse all of the input files into a single program
+ *
+ * Each file is lexed and parsed separately (so that errors are reported against the correct file and
+ * line) and concurrently (with -j), into its own ASTContext in \p file_contexts, which must outlive
+ * the program. The errors are reported and the classes appended to a single Program in the order of
+ * the files on the command line, the same as the token stream produced by the standalone lexer for
+ * multiple files. The symbols interned by each file are logged and assigned their ids in the same
+ * order, so that the ids (and thus the generated labels) don't depend on the number of threads.
+ *
+ * @return cool::Program* The program, or nullptr if there were lexing or parsing errors
+ */
+cool::Program *ParseFiles(int first, int last, char *argv[], bool mmap_input,
+                          std::vector<std::unique_ptr<cool::ASTContext>> &file_contexts) {
+  std::size_t num_files = last - first;
+  std::vector<std::unique_ptr<cool::ParseContext>> contexts(num_files);
+  std::vector<std::ostringstream> errors(num_files);
+  std::vector<cool::InternLog> intern_logs(num_files);
+  file_contexts.resize(num_files);
+
+  cool::ParallelFor(num_files, [&](std::size_t i) {
+    const char *filename = argv[first + i];
+    cool::InternLog::Scope intern_scope(intern_logs[i]);
+    cool::MappedFile mapped_file;
+    std::ifstream input_stream;
+    bool mapped = mmap_input && mapped_file.Open(filename, 2 /* flex requires two NULs */);
+    if (!mapped) {
+      input_stream.open(filename);
+      if (input_stream.fail()) {
+        errors[i] << "Could not open input file: " << filename << std::endl;
+        return;  // Reported (and compilation halted) in order below
+      }
+    }
+
+    contexts[i].reset(new cool::ParseContext(filename));
+    cool::ParseContext &context = *contexts[i];
+    context.err = &errors[i];
+    if (mapped) {
+      cool_yy_scan_in_place(&context, mapped_file.data(), mapped_file.size());
+    } else {
+      cool_yy_scan_stream(&context, &input_stream);
+    }
+    spdlog::info("Parsing file {}", filename);
+
+    // The AST for each file is allocated by its own thread
+    file_contexts[i].reset(new cool::ASTContext());
+    cool::ASTContext::Scope ast_scope(*file_contexts[i]);
+    cool_yyparse(&context);
+    cool_yy_scan_end(&context);
+  });
+  for (auto &log : intern_logs) {
+    log.AssignIds();
+  }
+
+  auto program = cool::Program::Create(cool::Klasses::Create());
+  int num_errors = 0;
+  for (std::size_t i = 0; i < num_files; i++) {
+    std::cerr << errors[i].str();
+    if (!contexts[i] || contexts[i]->errors > cool::ParseContext::kMaxErrors) {
+      exit(1);
+    }
+    num_errors += contexts[i]->errors;
+    if (contexts[i]->program) {  // nullptr if the parse was aborted
+      program->klasses()->push_back(contexts[i]->program->klasses());
+    }
+  }
+  return num_errors == 0 ? program : nullptr;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[]) {
+  cool_yy_flex_debug = 0;
+  cool_yydebug = 0;
+  std::string out_filename;
+  bool mmap_input = false;
+
+  // Initialize logger
+  auto err_logger = spdlog::stderr_color_mt("stderr");
+  spdlog::set_default_logger(err_logger);
+  spdlog::set_level(spdlog::level::err);
+
+  int c;
+  opterr = 0;  // getopt shouldn't print any messages
+  while ((c = getopt(argc, argv, "lpscrgatTO::bmo:i:j:hRJ:")) != -1) {
+    switch (c) {
+      case 'l':
+        cool_yy_flex_debug = 1;
+        spdlog::set_level(spdlog::level::debug);
+        break;
+      case 'p':
+        cool_yydebug = 1;
+        spdlog::set_level(spdlog::level::debug);
+        break;
+      case 's':
+      case 'c':
+        spdlog::set_level(spdlog::level::debug);
+        break;
+      case 'r':
+        disable_reg_alloc = 1;
+        break;
+      case 'a':  // pass the last arguments in registers (with -O)
+        cgen_reg_args = true;
+        break;
+      case 'g':  // enable garbage collection
+        cgen_Memmgr = GC_GENGC;
+        break;
+      case 't':  // run garbage collection very frequently (on every allocation)
+        cgen_Memmgr_Test = GC_TEST;
+        break;
+      case 'T':  // do even more pedantic tests in garbage collection
+        cgen_Memmgr_Debug = GC_DEBUG;
+        break;
+      case 'o':  // set the name of the output file
+        out_filename = optarg;
+        break;
+      case 'O':  // enable optimization, -Os also optimizes for code size
+        if (optarg && std::string(optarg) != "s") {
+          usage(argv[0]);
+          return 85;
+        }
+        cgen_optimize = true;
+        cgen_optimize_size = optarg != nullptr;
+        break;
+      case 'm':  // memory-map input files and lex them in place
+        mmap_input = true;
+        break;
+      case 'i':  // preallocate the Int objects with values in the range min:max, e.g. -128:1023
+        if (std::sscanf(optarg, "%d:%d", &cgen_int_cache_min, &cgen_int_cache_max) != 2 ||
+            cgen_int_cache_min < -32768 || cgen_int_cache_max > 32767) {
+          usage(argv[0]);
+          return 85;
+        }
+        break;
+      case 'j':  // number of threads of the parallel phases, 0 for one per hardware thread
+        if (std::sscanf(optarg, "%d", &cool::gNumThreads) != 1 || cool::gNumThreads < 0) {
+          usage(argv[0]);
+          return 85;
+        }
+        semant_parallel = true;
+        break;
+      case 'R':  // print the time and memory usage of each phase to stderr
+        cool::gTimeReport.EnableTable();
+        break;
+      case 'J':  // write the time and memory usage of each phase as JSON to a file
+        cool::gTimeReport.EnableJSON(optarg);
+        break;
+      case 'h':
+        usage(argv[0]);
+        return 0;
+      case '?':
+        usage(argv[0]);
+        return 85;
+      default:
+        break;
+    }
+  }
+
+  if (optind >= argc) {
+    usage(argv[0]);
+    return 85;
+  }
+  auto firstfile_index = optind;
+
+  // All phases share the AST, which is freed in one go when the contexts go out of scope
+  cool::ASTContext ast_context;
+  cool::ASTContext::Scope ast_scope(ast_context);
+  std::vector<std::unique_ptr<cool::ASTContext>> file_ast_contexts;
+
+  // The parser drives the lexer, so the time to parse includes lexing
+  cool::PhaseTimer parse_timer("parse");
+  cool::Program *program = ParseFiles(firstfile_index, argc, argv, mmap_input, file_ast_contexts);
+  parse_timer.Stop();
+  if (!program) {
+    std::cerr << "Compilation halted due to lex and parse errors" << std::endl;
+    exit(1);
+  }
+
+  // Semant exits with an error message if the program is not well-formed
+  cool::Semant(program);
+
+  // Don't touch the output file until we know that earlier phases of the
+  // compiler have succeeded.
+  if (out_filename.empty()) {  // no -o option
+    using std::string;
+    out_filename = argv[firstfile_index];
+    auto i = out_filename.rfind('.', out_filename.length());
+
+    // Replace extension with ".s" or append ".s" if no extension
+    if (i != string::npos) {
+      out_filename.replace(i, out_filename.size() - i, ".s");
+    } else {
+      out_filename += ".s";
+    }
+  }
+
+  std::ofstream output_stream(out_filename);
+  if (!output_stream) {
+    std::cerr << "Cannot open output file " << out_filename << std::endl;
+    exit(1);
+  }
+  cool::Cgen(program, output_stream);
+
+  return cool::gTimeReport.Report() ? 0 : 1;
+}
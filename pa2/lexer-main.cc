@@ -40,26 +40,19 @@ limitations under the License.
 #include "spdlog/sinks/stdout_color_sinks.h"
 
 #include "cool_parse.h" // Bison-generated file that defines the tokens
+#include "mapped_file.h"
+#include "parse_context.h"
 #include "stringtab.h"
 #include "utilities.h"
+#include "time_report.h"
 
 
-extern int yy_flex_debug;           // Control Flex debugging (set to 1 to turn on)
-std::istream* gInputStream;         // istream being lexed/parsed
-const char *gCurrFilename;          // Path to current file being lexed/parsed
-
-// The lexer keeps this global variable up to date with the line number
-// of the current line read from the input.
-cool::SourceLoc gCurrLineNo = 1;
-
-// Entry point to the lexer. It returns the next token each time it is called.
-extern int cool_yylex();
-YYSTYPE cool_yylval; // Not compiled with parser, so must define this.
+extern int cool_yy_flex_debug;  // Control Flex debugging (set to 1 to turn on)
 
 namespace {
 
 void usage(const char *program) {
-  std::cerr << "Usage: " << program << " [-lv] file [...]" << std::endl;
+  std::cerr << "Usage: " << program << " [-lmR] [-J file] file [...]" << std::endl;
 }
 
 }
@@ -70,16 +63,26 @@ int main(int argc, char* argv[]) {
   spdlog::set_default_logger(err_logger);
   spdlog::set_level(spdlog::level::err);
 
-  yy_flex_debug = 0;
+  cool_yy_flex_debug = 0;
+  bool mmap_input = false;
 
   int c;
   opterr = 0;  // getopt shouldn't print any messages
-  while ((c = getopt(argc, argv, "lpscrgtTOo:h")) != -1) {
+  while ((c = getopt(argc, argv, "lpscrgatTO::bmo:i:j:hRJ:")) != -1) {
     switch(c) {
       case 'l':
-        yy_flex_debug = 1;
+        cool_yy_flex_debug = 1;
         spdlog::set_level(spdlog::level::debug);
         break;
+      case 'm':  // memory-map input files and lex them in place
+        mmap_input = true;
+        break;
+      case 'R':  // print the time and memory usage of each phase to stderr
+        cool::gTimeReport.EnableTable();
+        break;
+      case 'J':  // write the time and memory usage of each phase as JSON to a file
+        cool::gTimeReport.EnableJSON(optarg);
+        break;
       case 'h':
         usage(argv[0]);
         return 0;
@@ -91,29 +94,38 @@ int main(int argc, char* argv[]) {
     }
   }
 
+  cool::PhaseTimer lex_timer("lex");
   while (optind < argc) {
-    std::ifstream input_stream(argv[optind]);
-    if (input_stream.fail()) {
-      std::cerr << "Could not open input file: " << argv[optind] << std::endl;
-      exit(1);
+    cool::ParseContext context(argv[optind]);
+    cool::MappedFile mapped_file;
+    std::ifstream input_stream;
+    if (mmap_input && mapped_file.Open(argv[optind], 2 /* flex requires two NULs */)) {
+      cool_yy_scan_in_place(&context, mapped_file.data(), mapped_file.size());
+    } else {
+      // Fall back to the istream for inputs that can't be mapped, e.g. pipes
+      input_stream.open(argv[optind]);
+      if (input_stream.fail()) {
+        std::cerr << "Could not open input file: " << argv[optind] << std::endl;
+        exit(1);
+      }
+      cool_yy_scan_stream(&context, &input_stream);
     }
     spdlog::info("Lexing file {}", argv[optind]);
-    gInputStream = &input_stream;
-
-    // Reset the line number for the current file
-    gCurrLineNo = 1;
 
     // Scan and print all tokens.
     std::cout << "#name \"" << argv[optind] << "\"" << std::endl;
+    YYSTYPE yylval;
     int token;
-    while ((token = cool_yylex()) != 0) {
-      cool::dump_cool_token(std::cout, gCurrLineNo, token, cool_yylval);
+    while ((token = cool_yylex(&yylval, &context)) != 0) {
+      cool::dump_cool_token(std::cout, context.line_no, token, yylval);
     }
+    cool_yy_scan_end(&context);
 
     optind++;
   }
+  lex_timer.Stop();
 
-  return 0;
+  return cool::gTimeReport.Report() ? 0 : 1;
 }
 
 
@@ -39,31 +39,35 @@
     */
 
     #include "ast.h"
+    #include "parse_context.h"
     #include "stringtab.h"
     #include "utilities.h"
 
     // Locations
     #define YYLTYPE cool::SourceLoc   // The type of locations
-    #define cool_yylloc gCurrLineNo   // Use the gCurrLineNo from the lexer for the location of tokens
 
     // The default action for locations. Use the location of the first
     // terminal/non-terminal.
     #define YYLLOC_DEFAULT(Cur, Rhs, N)         \
         (Cur) = (N) ? YYRHSLOC(Rhs, 1) : YYRHSLOC(Rhs, 0);
 
-    extern const char *gCurrFilename; // Current file being parsed
+    // Called for each parse error
+    void yyerror(YYLTYPE *loc, cool::ParseContext *context, const char *s);
 
-    void yyerror(const char *s);  // Called for each parse error
-    extern int yylex();           // Entry point to the lexer/
-
-    cool::Program* gASTRoot;	    // The result of the parsing
-    int omerrs = 0;               // Number of lexing or parsing errors
+    // The parser reads tokens through yylex below (not directly from the lexer) to track their
+    // locations and the lookahead reported with parse errors
+    #undef yylex
+    static int yylex(YYSTYPE *lval, YYLTYPE *loc, cool::ParseContext *context);
 
     using BinaryKind = cool::BinaryOperator::BinaryKind;
     using UnaryKind  = cool::UnaryOperator::UnaryKind;
 %}
 
 
+/* The parser is reentrant, with all of its state in the ParseContext for the file */
+%define api.pure full
+%param {cool::ParseContext *context}
+
 /* A union of all the types that can be the result of parsing actions. */
 %union {
     cool::Program* program;
@@ -160,9 +164,9 @@ program	:
     class_list {
         /* Ensure bison computes location information */
         @$ = @1;
-        gASTRoot = cool::Program::Create($1, @1); // Save AST root in a global variable for access by programs
+        context->program = cool::Program::Create($1, @1); // Save AST root in the context for access by programs
     }
-    | error { gASTRoot = cool::Program::Create(cool::Klasses::Create()); }
+    | error { context->program = cool::Program::Create(cool::Klasses::Create()); }
     ;
 
 /*
@@ -191,11 +195,11 @@ class :
     CLASS TYPEID '{' optional_feature_list '}' ';'
     {
         /* If no parent class is specified, the class inherits from Object */
-        $$ = cool::Klass::Create($2, cool::gIdentTable.emplace("Object"), $4, cool::StringLiteral::Create(gCurrFilename), @1);
+        $$ = cool::Klass::Create($2, cool::gIdentTable.emplace("Object"), $4, cool::StringLiteral::Create(context->filename), @1);
     }
     | CLASS TYPEID INHERITS TYPEID '{' optional_feature_list '}' ';'
     {
-        $$ = cool::Klass::Create($2, $4, $6, cool::StringLiteral::Create(gCurrFilename), @1);
+        $$ = cool::Klass::Create($2, $4, $6, cool::StringLiteral::Create(context->filename), @1);
     }
     ;
 
@@ -324,15 +328,21 @@ kase :
 %%
 
 /* This function is called automatically when Bison detects a parse error. */
-void yyerror(const char *s) {
-    extern cool::SourceLoc gCurrLineNo;
-
-    std::cerr << "\"" << gCurrFilename << "\", " << "line " << gCurrLineNo << ": " << s << " at or near ";
-    cool::print_cool_token(std::cerr, yychar);
-    std::cerr << std::endl;
-
-    if (++omerrs > 50) {
-        std::cerr << "More than 50 errors" << std::endl;
-        exit(1);
+void yyerror(YYLTYPE *loc, cool::ParseContext *context, const char *s) {
+    std::ostream& err = *context->err;
+    err << "\"" << context->filename << "\", " << "line " << *loc << ": " << s << " at or near ";
+    cool::print_cool_token(err, context->token, *context->token_value);
+    err << std::endl;
+
+    if (++context->errors > cool::ParseContext::kMaxErrors) {
+        err << "More than 50 errors" << std::endl;
     }
 }
+
+/* Read the next token from the lexer, ending the input after too many errors. */
+static int yylex(YYSTYPE *lval, YYLTYPE *loc, cool::ParseContext *context) {
+    context->token = context->errors > cool::ParseContext::kMaxErrors ? 0 : cool_yylex(lval, context);
+    context->token_value = lval;
+    *loc = context->line_no;
+    return context->token;
+}
@@ -40,20 +40,36 @@ limitations under the License.
 
 #include "cool_parse.h"
 #include "ast.h"
+#include "ast_binary.h"
+#include "parse_context.h"
+#include "time_report.h"
 
+// Lexer associated variables, the token lexer is not reentrant
 extern int yy_flex_debug;                // Control Flex debugging (set to 1 to turn on)
 std::istream* gInputStream = &std::cin;  // istream being lexed/parsed
 const char* gCurrFilename = "<stdin>";   // Path to current file being lexed/parsed
+cool::SourceLoc gCurrLineNo = 1;         // Current line number (updated by the lexer)
+YYSTYPE cool_yylval;                     // Value of the current token (set by the lexer)
+extern int cool_yylex();                 // Entry point to the token lexer
 
-extern int cool_yydebug;        // Control Bison debugging (set to 1 to turn on)
-extern cool::Program* gASTRoot; // AST produced by parser
-extern int omerrs;              // Number of lexing and parsing errors
-extern int cool_yyparse();      // Entry point to the parser
+extern int cool_yydebug;  // Control Bison debugging (set to 1 to turn on)
+
+/*
+ * The parser reads from the token lexer through the same interface as the reentrant Cool lexer,
+ * copying the lexer's state into the context. The token stream can switch files with #name lines.
+ */
+int cool_yylex(YYSTYPE* lval, cool::ParseContext* context) {
+  int token = cool_yylex();
+  *lval = cool_yylval;
+  context->filename = gCurrFilename;
+  context->line_no = gCurrLineNo;
+  return token;
+}
 
 namespace {
 
 void usage(const char *program) {
-  std::cerr << "Usage: " << program << " [-lp]" << std::endl;
+  std::cerr << "Usage: " << program << " [-lpbR] [-J file]" << std::endl;
 }
 
 }
@@ -61,6 +77,7 @@ void usage(const char *program) {
 int main(int argc, char *argv[]) {
   yy_flex_debug = 0;
   cool_yydebug = 0;
+  bool binary_ast = false;
 
   // Initialize logger
   auto err_logger = spdlog::stderr_color_mt("stderr");
@@ -69,7 +86,7 @@ int main(int argc, char *argv[]) {
 
   int c;
   opterr = 0;  // getopt shouldn't print any messages
-  while ((c = getopt(argc, argv, "lpscrgtTOo:h")) != -1) {
+  while ((c = getopt(argc, argv, "lpscrgatTO::bmo:i:j:hRJ:")) != -1) {
     switch(c) {
       case 'l':
         yy_flex_debug = 1;
@@ -79,6 +96,15 @@ int main(int argc, char *argv[]) {
         cool_yydebug = 1;
         spdlog::set_level(spdlog::level::debug);
         break;
+      case 'b':  // write the AST in the binary format
+        binary_ast = true;
+        break;
+      case 'R':  // print the time and memory usage of each phase to stderr
+        cool::gTimeReport.EnableTable();
+        break;
+      case 'J':  // write the time and memory usage of each phase as JSON to a file
+        cool::gTimeReport.EnableJSON(optarg);
+        break;
       case 'h':
         usage(argv[0]);
         return 0;
@@ -91,14 +117,21 @@ int main(int argc, char *argv[]) {
   }
 
 
-  cool_yyparse();
-  if (omerrs != 0) {
+  cool::ParseContext context(gCurrFilename);
+  cool::TimePhase("parse", [&]() { cool_yyparse(&context); });
+  if (context.errors > cool::ParseContext::kMaxErrors) {
+    exit(1);
+  } else if (context.errors != 0) {
     std::cerr << "Compilation halted due to lex and parse errors" << std::endl;
     exit(1);
   }
 
-  gASTRoot->DumpTree(std::cout, 0, false /* No types dumped as this stage */);
+  if (binary_ast) {
+    cool::DumpBinaryAST(std::cout, context.program, false /* No types dumped as this stage */);
+  } else {
+    context.program->DumpTree(std::cout, 0, false /* No types dumped as this stage */);
+  }
 
-  return 0;
+  return cool::gTimeReport.Report() ? 0 : 1;
 }
 
@@ -40,7 +40,10 @@ limitations under the License.
 #include "spdlog/sinks/stdout_color_sinks.h"
 
 #include "ast.h"
+#include "ast_binary.h"
+#include "parallel.h"
 #include "semant.h"
+#include "time_report.h"
 
 /**
  * @brief Root of the AST 
@@ -56,13 +59,14 @@ const char *gCurrFilename = "<stdin>";
 namespace {
 
 void usage(const char *program) {
-  std::cerr << "Usage: " << program << " [-s]" << std::endl;
+  std::cerr << "Usage: " << program << " [-sbR] [-j threads] [-J file]" << std::endl;
 }
 
 }
 
 int main(int argc, char *argv[]) {
   yy_flex_debug = 0;
+  bool binary_ast = false;
 
   // Initialize logger
   auto err_logger = spdlog::stderr_color_mt("stderr");
@@ -71,7 +75,7 @@ int main(int argc, char *argv[]) {
 
   int c;
   opterr = 0;  // getopt shouldn't print any messages
-  while ((c = getopt(argc, argv, "lpscrgtTOo:h")) != -1) {
+  while ((c = getopt(argc, argv, "lpscrgatTO::bmo:i:j:hRJ:")) != -1) {
     switch(c) {
       case 'l':
         yy_flex_debug = 1;
@@ -79,6 +83,22 @@ int main(int argc, char *argv[]) {
       case 's':
         spdlog::set_level(spdlog::level::debug);
         break;
+      case 'b':  // write the AST in the binary format
+        binary_ast = true;
+        break;
+      case 'j':  // type check on multiple threads, 0 for one per hardware thread
+        if (sscanf(optarg, "%d", &cool::gNumThreads) != 1 || cool::gNumThreads < 0) {
+          usage(argv[0]);
+          return 85;
+        }
+        semant_parallel = true;
+        break;
+      case 'R':  // print the time and memory usage of each phase to stderr
+        cool::gTimeReport.EnableTable();
+        break;
+      case 'J':  // write the time and memory usage of each phase as JSON to a file
+        cool::gTimeReport.EnableJSON(optarg);
+        break;
       case 'h':
         usage(argv[0]);
         return 0;
@@ -90,11 +110,29 @@ int main(int argc, char *argv[]) {
     }
   }
 
-  // Parse AST dump
-  ast_yyparse();
+  if (semant_parallel) {
+    // The AST is read from std::cin and dumped to std::cout, which are not mixed with C stdio. Once
+    // the type checker has started its threads, the synchronized streams would lock on every access.
+    std::ios::sync_with_stdio(false);
+  }
+
+  // Parse AST dump (in either the text or binary format)
+  cool::PhaseTimer read_timer("read AST");
+  if (cool::IsBinaryAST(std::cin)) {
+    gASTRoot = cool::ReadBinaryAST(std::cin);
+  } else {
+    ast_yyparse();
+  }
+  read_timer.Stop();
 
   cool::Semant(gASTRoot);
 
-  gASTRoot->DumpTree(std::cout, 0, true /* Dump types as well */);
+  if (binary_ast) {
+    cool::DumpBinaryAST(std::cout, gASTRoot, true /* Dump types as well */);
+  } else {
+    gASTRoot->DumpTree(std::cout, 0, true /* Dump types as well */);
+  }
+
+  return cool::gTimeReport.Report() ? 0 : 1;
 }
 
@@ -33,6 +33,7 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 #include <unistd.h>
@@ -40,7 +41,10 @@ limitations under the License.
 #include "spdlog/sinks/stdout_color_sinks.h"
 
 #include "ast.h"
+#include "ast_binary.h"
 #include "cgen.h"
+#include "parallel.h"
+#include "time_report.h"
 
 // Lexer and parser associated variables
 extern int yy_flex_debug;                // Control Flex debugging (set to 1 to turn on)
@@ -53,7 +57,7 @@ extern cool::Program *gASTRoot;          // AST produced by parser
 namespace {
 
 void usage(const char *program) {
-  std::cerr << "Usage: " << program << " [-crgtTO] [-o file]" << std::endl;
+  std::cerr << "Usage: " << program << " [-cragtTOR] [-Os] [-i min:max] [-j threads] [-o file] [-J file]" << std::endl;
 }
 }
 
@@ -61,9 +65,14 @@ int main(int argc, char *argv[]) {
   yy_flex_debug = 0;
   std::string out_filename;
 
+  // Initialize logger, the generated code may be written to stdout
+  auto err_logger = spdlog::stderr_color_mt("stderr");
+  spdlog::set_default_logger(err_logger);
+  spdlog::set_level(spdlog::level::err);
+
   int c;
   opterr = 0;  // getopt shouldn't print any messages
-  while ((c = getopt(argc, argv, "lpscrgtTOo:h")) != -1) {
+  while ((c = getopt(argc, argv, "lpscrgatTO::bmo:i:j:hRJ:")) != -1) {
     switch (c) {
       case 'l':
         yy_flex_debug = 1;
@@ -79,6 +88,9 @@ int main(int argc, char *argv[]) {
       case 'r':
         disable_reg_alloc = 1;
         break;
+      case 'a':  // pass the last arguments in registers (with -O)
+        cgen_reg_args = true;
+        break;
       case 'g':  // enable garbage collection
         cgen_Memmgr = GC_GENGC;
         break;
@@ -91,8 +103,32 @@ int main(int argc, char *argv[]) {
       case 'o':  // set the name of the output file
         out_filename = optarg;
         break;
-      case 'O':  // enable optimization
+      case 'O':  // enable optimization, -Os also optimizes for code size
+        if (optarg && std::string(optarg) != "s") {
+          usage(argv[0]);
+          return 85;
+        }
         cgen_optimize = true;
+        cgen_optimize_size = optarg != nullptr;
+        break;
+      case 'i':  // preallocate the Int objects with values in the range min:max, e.g. -128:1023
+        if (std::sscanf(optarg, "%d:%d", &cgen_int_cache_min, &cgen_int_cache_max) != 2 ||
+            cgen_int_cache_min < -32768 || cgen_int_cache_max > 32767) {
+          usage(argv[0]);
+          return 85;
+        }
+        break;
+      case 'j':  // number of threads of the parallel phases, 0 for one per hardware thread
+        if (std::sscanf(optarg, "%d", &cool::gNumThreads) != 1 || cool::gNumThreads < 0) {
+          usage(argv[0]);
+          return 85;
+        }
+        break;
+      case 'R':  // print the time and memory usage of each phase to stderr
+        cool::gTimeReport.EnableTable();
+        break;
+      case 'J':  // write the time and memory usage of each phase as JSON to a file
+        cool::gTimeReport.EnableJSON(optarg);
         break;
       case 'h':
         usage(argv[0]);
@@ -107,7 +143,14 @@ int main(int argc, char *argv[]) {
 
   auto firstfile_index = optind;
 
-  ast_yyparse();
+  // Parse AST dump (in either the text or binary format)
+  cool::PhaseTimer read_timer("read AST");
+  if (cool::IsBinaryAST(std::cin)) {
+    gASTRoot = cool::ReadBinaryAST(std::cin);
+  } else {
+    ast_yyparse();
+  }
+  read_timer.Stop();
 
   // Don't touch the output file until we know that earlier phases of the
   // compiler have succeeded.
@@ -135,5 +178,5 @@ int main(int argc, char *argv[]) {
     Cgen(gASTRoot, std::cout);
   }
 
-  return 0;
+  return cool::gTimeReport.Report() ? 0 : 1;
 }
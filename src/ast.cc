@@ -34,6 +34,8 @@ limitations under the License.
 */
 
 #include "ast.h"
+#include "ast_binary.h"
+#include "ast_context.h"
 #include <algorithm>
 #include <unordered_map>
 
@@ -43,7 +45,9 @@ const size_t kIndent = 2;
 
 namespace cool {
 
-Program* Program::Create(Klasses* klasses, SourceLoc loc) { return new Program(klasses, loc); }
+Program* Program::Create(Klasses* klasses, SourceLoc loc) {
+  return new (ASTContext::Current().Allocate<Program>()) Program(klasses, loc);
+}
 
 void Program::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpLine(os, level);
@@ -53,9 +57,17 @@ void Program::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   }
 }
 
+void Program::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Program, loc_);
+  writer.WriteCount(klasses_->size());
+  for (auto& klass : *klasses_) {
+    klass->DumpBinary(writer);
+  }
+}
+
 Klass* Klass::Create(Symbol* name, Symbol* parent, Features* features, StringLiteral* filename,
                      SourceLoc loc) {
-  return new Klass(name, parent, features, filename, loc);
+  return new (ASTContext::Current().Allocate<Klass>()) Klass(name, parent, features, filename, loc);
 }
 
 Method* Klass::method(Symbol* name) const {
@@ -92,8 +104,19 @@ void Klass::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   pad(os, level) << ')' << std::endl;
 }
 
+void Klass::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Klass, loc_);
+  writer.WriteSymbol(name_);
+  writer.WriteSymbol(parent_);
+  writer.WriteString(filename_->entry());
+  writer.WriteCount(features_->size());
+  for (auto& feature : *features_) {
+    feature->DumpBinary(writer);
+  }
+}
+
 Formal* Formal::Create(Symbol* name, Symbol* decl_type, SourceLoc loc) {
-  return new Formal(name, decl_type, loc);
+  return new (ASTContext::Current().Allocate<Formal>()) Formal(name, decl_type, loc);
 }
 
 void Formal::DumpTree(std::ostream& os, size_t level, bool with_types) const {
@@ -104,9 +127,15 @@ void Formal::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   pad(os, level) << *decl_type_ << std::endl;
 }
 
+void Formal::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Formal, loc_);
+  writer.WriteSymbol(name_);
+  writer.WriteSymbol(decl_type_);
+}
+
 Method* Method::Create(Symbol* name, Formals* formals, Symbol* decl_type, Expression* body,
                        SourceLoc loc) {
-  return new Method(name, formals, decl_type, body, loc);
+  return new (ASTContext::Current().Allocate<Method>()) Method(name, formals, decl_type, body, loc);
 }
 
 void Method::DumpTree(std::ostream& os, size_t level, bool with_types) const {
@@ -121,8 +150,19 @@ void Method::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   body_->DumpTree(os, level, with_types);
 }
 
+void Method::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Method, loc_);
+  writer.WriteSymbol(name_);
+  writer.WriteCount(formals_->size());
+  for (auto& formal : *formals_) {
+    formal->DumpBinary(writer);
+  }
+  writer.WriteSymbol(decl_type_);
+  body_->DumpBinary(writer);
+}
+
 Attr* Attr::Create(Symbol* name, Symbol* decl_type, Expression* init, SourceLoc loc) {
-  return new Attr(name, decl_type, init, loc);
+  return new (ASTContext::Current().Allocate<Attr>()) Attr(name, decl_type, init, loc);
 }
 
 void Attr::DumpTree(std::ostream& os, size_t level, bool with_types) const {
@@ -134,6 +174,13 @@ void Attr::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   init_->DumpTree(os, level, with_types);
 }
 
+void Attr::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Attr, loc_);
+  writer.WriteSymbol(name_);
+  writer.WriteSymbol(decl_type_);
+  init_->DumpBinary(writer);
+}
+
 void Expression::DumpType(std::ostream& os, size_t level, bool with_types) const {
   if (with_types && type_) {
     pad(os, level) << ": " << *type_ << std::endl;
@@ -142,8 +189,17 @@ void Expression::DumpType(std::ostream& os, size_t level, bool with_types) const
   }
 }
 
+void Expression::DumpBinaryType(BinaryASTWriter& writer) const {
+  // Mirror DumpType, which writes _no_type for missing types
+  if (writer.with_types() && type_) {
+    writer.WriteSymbol(type_);
+  } else {
+    writer.WriteSymbol(gIdentTable.emplace("_no_type"));
+  }
+}
+
 Assign* Assign::Create(Symbol* name, Expression* value, SourceLoc loc) {
-  return new Assign(name, value, loc);
+  return new (ASTContext::Current().Allocate<Assign>()) Assign(name, value, loc);
 }
 
 void Assign::DumpTree(std::ostream& os, size_t level, bool with_types) const {
@@ -154,9 +210,17 @@ void Assign::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpType(os, level, with_types);
 }
 
+void Assign::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Assign, loc_);
+  writer.WriteSymbol(name_);
+  value_->DumpBinary(writer);
+  DumpBinaryType(writer);
+}
+
 StaticDispatch* StaticDispatch::Create(Expression* receiver, Symbol* dispatch_type, Symbol* name,
                                        Expressions* actuals, SourceLoc loc) {
-  return new StaticDispatch(receiver, dispatch_type, name, actuals, loc);
+  return new (ASTContext::Current().Allocate<StaticDispatch>())
+      StaticDispatch(receiver, dispatch_type, name, actuals, loc);
 }
 
 void StaticDispatch::DumpTree(std::ostream& os, size_t level, bool with_types) const {
@@ -173,9 +237,21 @@ void StaticDispatch::DumpTree(std::ostream& os, size_t level, bool with_types) c
   DumpType(os, level, with_types);
 }
 
+void StaticDispatch::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::StaticDispatch, loc_);
+  receiver_->DumpBinary(writer);
+  writer.WriteSymbol(dispatch_type_);
+  writer.WriteSymbol(name_);
+  writer.WriteCount(actuals_->size());
+  for (auto& actual : *actuals_) {
+    actual->DumpBinary(writer);
+  }
+  DumpBinaryType(writer);
+}
+
 Dispatch* Dispatch::Create(Expression* receiver, Symbol* name, Expressions* actuals,
                            SourceLoc loc) {
-  return new Dispatch(receiver, name, actuals, loc);
+  return new (ASTContext::Current().Allocate<Dispatch>()) Dispatch(receiver, name, actuals, loc);
 }
 
 void Dispatch::DumpTree(std::ostream& os, size_t level, bool with_types) const {
@@ -191,9 +267,20 @@ void Dispatch::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpType(os, level, with_types);
 }
 
+void Dispatch::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Dispatch, loc_);
+  receiver_->DumpBinary(writer);
+  writer.WriteSymbol(name_);
+  writer.WriteCount(actuals_->size());
+  for (auto& actual : *actuals_) {
+    actual->DumpBinary(writer);
+  }
+  DumpBinaryType(writer);
+}
+
 Cond* Cond::Create(Expression* pred, Expression* then_branch, Expression* else_branch,
                    SourceLoc loc) {
-  return new Cond(pred, then_branch, else_branch, loc);
+  return new (ASTContext::Current().Allocate<Cond>()) Cond(pred, then_branch, else_branch, loc);
 }
 
 void Cond::DumpTree(std::ostream& os, size_t level, bool with_types) const {
@@ -205,8 +292,16 @@ void Cond::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpType(os, level, with_types);
 }
 
+void Cond::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Cond, loc_);
+  pred_->DumpBinary(writer);
+  then_branch_->DumpBinary(writer);
+  else_branch_->DumpBinary(writer);
+  DumpBinaryType(writer);
+}
+
 Loop* Loop::Create(Expression* pred, Expression* body, SourceLoc loc) {
-  return new Loop(pred, body, loc);
+  return new (ASTContext::Current().Allocate<Loop>()) Loop(pred, body, loc);
 }
 
 void Loop::DumpTree(std::ostream& os, size_t level, bool with_types) const {
@@ -217,7 +312,16 @@ void Loop::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpType(os, level, with_types);
 }
 
-Block* Block::Create(Expressions* body, SourceLoc loc) { return new Block(body, loc); }
+void Loop::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Loop, loc_);
+  pred_->DumpBinary(writer);
+  body_->DumpBinary(writer);
+  DumpBinaryType(writer);
+}
+
+Block* Block::Create(Expressions* body, SourceLoc loc) {
+  return new (ASTContext::Current().Allocate<Block>()) Block(body, loc);
+}
 
 void Block::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpLine(os, level);
@@ -228,9 +332,18 @@ void Block::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpType(os, level, with_types);
 }
 
+void Block::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Block, loc_);
+  writer.WriteCount(body_->size());
+  for (auto& expr : *body_) {
+    expr->DumpBinary(writer);
+  }
+  DumpBinaryType(writer);
+}
+
 Let* Let::Create(Symbol* name, Symbol* decl_type, Expression* init, Expression* body,
                  SourceLoc loc) {
-  return new Let(name, decl_type, init, body, loc);
+  return new (ASTContext::Current().Allocate<Let>()) Let(name, decl_type, init, body, loc);
 }
 
 void Let::DumpTree(std::ostream& os, size_t level, bool with_types) const {
@@ -243,8 +356,17 @@ void Let::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpType(os, level, with_types);
 }
 
+void Let::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Let, loc_);
+  writer.WriteSymbol(name_);
+  writer.WriteSymbol(decl_type_);
+  init_->DumpBinary(writer);
+  body_->DumpBinary(writer);
+  DumpBinaryType(writer);
+}
+
 Kase* Kase::Create(Expression* input, KaseBranches* cases, SourceLoc loc) {
-  return new Kase(input, cases, loc);
+  return new (ASTContext::Current().Allocate<Kase>()) Kase(input, cases, loc);
 }
 
 void Kase::DumpTree(std::ostream& os, size_t level, bool with_types) const {
@@ -257,8 +379,18 @@ void Kase::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpType(os, level, with_types);
 }
 
+void Kase::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Kase, loc_);
+  input_->DumpBinary(writer);
+  writer.WriteCount(cases_->size());
+  for (auto& branch : *cases_) {
+    branch->DumpBinary(writer);
+  }
+  DumpBinaryType(writer);
+}
+
 KaseBranch* KaseBranch::Create(Symbol* name, Symbol* decl_type, Expression* body, SourceLoc loc) {
-  return new KaseBranch(name, decl_type, body, loc);
+  return new (ASTContext::Current().Allocate<KaseBranch>()) KaseBranch(name, decl_type, body, loc);
 }
 
 void KaseBranch::DumpTree(std::ostream& os, size_t level, bool with_types) const {
@@ -270,7 +402,17 @@ void KaseBranch::DumpTree(std::ostream& os, size_t level, bool with_types) const
   // We don't dump types of individual case branches
 }
 
-Knew* Knew::Create(Symbol* name, SourceLoc loc) { return new Knew(name, loc); }
+void KaseBranch::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::KaseBranch, loc_);
+  writer.WriteSymbol(name_);
+  writer.WriteSymbol(decl_type_);
+  body_->DumpBinary(writer);
+  // We don't dump types of individual case branches
+}
+
+Knew* Knew::Create(Symbol* name, SourceLoc loc) {
+  return new (ASTContext::Current().Allocate<Knew>()) Knew(name, loc);
+}
 
 void Knew::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpLine(os, level);
@@ -279,6 +421,12 @@ void Knew::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpType(os, level, with_types);
 }
 
+void Knew::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Knew, loc_);
+  writer.WriteSymbol(name_);
+  DumpBinaryType(writer);
+}
+
 namespace {
 constexpr const char* DumpOperator(UnaryOperator::UnaryKind kind) {
   switch (kind) {
@@ -315,10 +463,42 @@ constexpr const char* DumpOperator(BinaryOperator::BinaryKind kind) {
       return "";
   }
 }
+
+constexpr BinaryASTTag BinaryOperatorTag(UnaryOperator::UnaryKind kind) {
+  switch (kind) {
+    case UnaryOperator::UnaryKind::UO_Neg:
+      return BinaryASTTag::Neg;
+    case UnaryOperator::UnaryKind::UO_Not:
+      return BinaryASTTag::Not;
+    case UnaryOperator::UnaryKind::UO_IsVoid:
+    default:
+      return BinaryASTTag::IsVoid;
+  }
+}
+
+constexpr BinaryASTTag BinaryOperatorTag(BinaryOperator::BinaryKind kind) {
+  switch (kind) {
+    case BinaryOperator::BinaryKind::BO_Add:
+      return BinaryASTTag::Add;
+    case BinaryOperator::BinaryKind::BO_Sub:
+      return BinaryASTTag::Sub;
+    case BinaryOperator::BinaryKind::BO_Mul:
+      return BinaryASTTag::Mul;
+    case BinaryOperator::BinaryKind::BO_Div:
+      return BinaryASTTag::Div;
+    case BinaryOperator::BinaryKind::BO_LT:
+      return BinaryASTTag::LessThan;
+    case BinaryOperator::BinaryKind::BO_EQ:
+      return BinaryASTTag::Equal;
+    case BinaryOperator::BinaryKind::BO_LE:
+    default:
+      return BinaryASTTag::LessOrEqual;
+  }
+}
 }  // anonymous namespace
 
 UnaryOperator* UnaryOperator::Create(UnaryKind kind, Expression* input, SourceLoc loc) {
-  return new UnaryOperator(kind, input, loc);
+  return new (ASTContext::Current().Allocate<UnaryOperator>()) UnaryOperator(kind, input, loc);
 }
 
 void UnaryOperator::DumpTree(std::ostream& os, size_t level, bool with_types) const {
@@ -328,6 +508,12 @@ void UnaryOperator::DumpTree(std::ostream& os, size_t level, bool with_types) co
   DumpType(os, level, with_types);
 }
 
+void UnaryOperator::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryOperatorTag(kind_), loc_);
+  input_->DumpBinary(writer);
+  DumpBinaryType(writer);
+}
+
 const char* BinaryOperator::KindAsString() const {
   switch (kind_) {
     case BinaryKind::BO_Add:
@@ -352,7 +538,7 @@ const char* BinaryOperator::KindAsString() const {
 
 BinaryOperator* BinaryOperator::Create(BinaryKind kind, Expression* lhs, Expression* rhs,
                                        SourceLoc loc) {
-  return new BinaryOperator(kind, lhs, rhs, loc);
+  return new (ASTContext::Current().Allocate<BinaryOperator>()) BinaryOperator(kind, lhs, rhs, loc);
 }
 
 void BinaryOperator::DumpTree(std::ostream& os, size_t level, bool with_types) const {
@@ -363,7 +549,16 @@ void BinaryOperator::DumpTree(std::ostream& os, size_t level, bool with_types) c
   DumpType(os, level, with_types);
 }
 
-Ref* Ref::Create(Symbol* name, SourceLoc loc) { return new Ref(name, loc); }
+void BinaryOperator::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryOperatorTag(kind_), loc_);
+  lhs_->DumpBinary(writer);
+  rhs_->DumpBinary(writer);
+  DumpBinaryType(writer);
+}
+
+Ref* Ref::Create(Symbol* name, SourceLoc loc) {
+  return new (ASTContext::Current().Allocate<Ref>()) Ref(name, loc);
+}
 
 void Ref::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpLine(os, level);
@@ -372,7 +567,15 @@ void Ref::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpType(os, level, with_types);
 }
 
-NoExpr* NoExpr::Create(SourceLoc loc) { return new NoExpr(loc); }
+void Ref::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Ref, loc_);
+  writer.WriteSymbol(name_);
+  DumpBinaryType(writer);
+}
+
+NoExpr* NoExpr::Create(SourceLoc loc) {
+  return new (ASTContext::Current().Allocate<NoExpr>()) NoExpr(loc);
+}
 
 void NoExpr::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpLine(os, level);
@@ -380,8 +583,13 @@ void NoExpr::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpType(os, level, with_types);
 }
 
+void NoExpr::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::NoExpr, loc_);
+  DumpBinaryType(writer);
+}
+
 StringLiteral* StringLiteral::Create(const StringEntry* value, SourceLoc loc) {
-  return new StringLiteral(value, loc);
+  return new (ASTContext::Current().Allocate<StringLiteral>()) StringLiteral(value, loc);
 }
 
 StringLiteral* StringLiteral::Create(const std::string& string, SourceLoc loc) {
@@ -401,8 +609,14 @@ void StringLiteral::DumpTree(std::ostream& os, size_t level, bool with_types) co
   DumpType(os, level, with_types);
 }
 
+void StringLiteral::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::String, loc_);
+  writer.WriteString(value_);
+  DumpBinaryType(writer);
+}
+
 IntLiteral* IntLiteral::Create(const Int32Entry* value, SourceLoc loc) {
-  return new IntLiteral(value, loc);
+  return new (ASTContext::Current().Allocate<IntLiteral>()) IntLiteral(value, loc);
 }
 
 IntLiteral* IntLiteral::Create(int32_t value, SourceLoc loc) {
@@ -416,7 +630,15 @@ void IntLiteral::DumpTree(std::ostream& os, size_t level, bool with_types) const
   DumpType(os, level, with_types);
 }
 
-BoolLiteral* BoolLiteral::Create(bool value, SourceLoc loc) { return new BoolLiteral(value, loc); }
+void IntLiteral::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Int, loc_);
+  writer.WriteInt(value_);
+  DumpBinaryType(writer);
+}
+
+BoolLiteral* BoolLiteral::Create(bool value, SourceLoc loc) {
+  return new (ASTContext::Current().Allocate<BoolLiteral>()) BoolLiteral(value, loc);
+}
 
 void BoolLiteral::DumpTree(std::ostream& os, size_t level, bool with_types) const {
   DumpLine(os, level);
@@ -425,4 +647,12 @@ void BoolLiteral::DumpTree(std::ostream& os, size_t level, bool with_types) cons
   DumpType(os, level, with_types);
 }
 
+void BoolLiteral::DumpBinary(BinaryASTWriter& writer) const {
+  writer.WriteNode(BinaryASTTag::Bool, loc_);
+  // The text reader lexes the value as an integer literal (interning it in gIntTable), so we do the
+  // same to keep the gIntTable ids identical between the two formats
+  writer.WriteInt(gIntTable.emplace(value_ ? 1 : 0));
+  DumpBinaryType(writer);
+}
+
 }  // namespace cool
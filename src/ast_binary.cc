@@ -0,0 +1,398 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "ast_binary.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+#include "ast.h"
+
+namespace cool {
+
+namespace {
+const char kMagic[] = {'\x7f', 'C', 'O', 'O', 'L', 'A', 'S', 'T'};
+
+void PutU32(std::ostream& os, uint32_t value) {
+  char bytes[4] = {static_cast<char>(value), static_cast<char>(value >> 8),
+                   static_cast<char>(value >> 16), static_cast<char>(value >> 24)};
+  os.write(bytes, sizeof(bytes));
+}
+
+void PutBytes(std::ostream& os, const char* data, std::size_t length) {
+  PutU32(os, static_cast<uint32_t>(length));
+  os.write(data, length);
+}
+}  // anonymous namespace
+
+void BinaryASTWriter::WriteU32(uint32_t value) {
+  nodes_.push_back(static_cast<char>(value));
+  nodes_.push_back(static_cast<char>(value >> 8));
+  nodes_.push_back(static_cast<char>(value >> 16));
+  nodes_.push_back(static_cast<char>(value >> 24));
+}
+
+template <class Entry>
+void BinaryASTWriter::WriteIndex(const Entry* entry, std::vector<const Entry*>& table) {
+  auto found = indices_.find(entry);
+  if (found == indices_.end()) {
+    found = indices_.emplace(entry, static_cast<uint32_t>(table.size())).first;
+    table.push_back(entry);
+  }
+  WriteU32(found->second);
+}
+
+void BinaryASTWriter::WriteNode(BinaryASTTag tag, SourceLoc loc) {
+  WriteU8(static_cast<uint8_t>(tag));
+  WriteU32(static_cast<uint32_t>(loc));
+}
+
+void BinaryASTWriter::WriteSymbol(const Symbol* symbol) { WriteIndex(symbol, symbols_); }
+
+void BinaryASTWriter::WriteString(const StringEntry* string) { WriteIndex(string, strings_); }
+
+void BinaryASTWriter::WriteInt(const Int32Entry* value) { WriteIndex(value, ints_); }
+
+void BinaryASTWriter::WriteCount(std::size_t count) { WriteU32(static_cast<uint32_t>(count)); }
+
+void BinaryASTWriter::Finish(std::ostream& os) const {
+  os.write(kMagic, sizeof(kMagic));
+  PutU32(os, kBinaryASTVersion);
+
+  PutU32(os, static_cast<uint32_t>(symbols_.size()));
+  for (auto symbol : symbols_) {
+    PutBytes(os, symbol->value().data(), symbol->value().size());
+  }
+  PutU32(os, static_cast<uint32_t>(strings_.size()));
+  for (auto string : strings_) {
+    PutBytes(os, string->value().data(), string->value().size());
+  }
+  PutU32(os, static_cast<uint32_t>(ints_.size()));
+  for (auto value : ints_) {
+    PutU32(os, static_cast<uint32_t>(value->value()));
+  }
+
+  os.write(nodes_.data(), nodes_.size());
+}
+
+void DumpBinaryAST(std::ostream& os, const Program* program, bool with_types) {
+  BinaryASTWriter writer(with_types);
+  program->DumpBinary(writer);
+  writer.Finish(os);
+}
+
+bool IsBinaryAST(std::istream& is) {
+  return is.peek() == static_cast<unsigned char>(kMagic[0]);
+}
+
+namespace {
+
+/**
+ * @brief Recursive-descent reader for the binary AST format
+ *
+ * The entire input is read into memory and then decoded in place.
+ */
+class BinaryASTReader {
+ public:
+  explicit BinaryASTReader(std::istream& is)
+      : data_(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()) {}
+
+  Program* ReadProgram();
+
+ private:
+  std::string data_;
+  std::size_t pos_ = 0;
+
+  std::vector<Symbol*> symbols_;
+  std::vector<StringEntry*> strings_;
+  std::vector<Int32Entry*> ints_;
+
+  [[noreturn]] void Error(const char* what) const {
+    std::cerr << "Malformed binary AST at byte " << pos_ << ": " << what << std::endl;
+    exit(1);
+  }
+
+  const char* Take(std::size_t length) {
+    if (length > data_.size() - pos_) Error("unexpected end of input");
+    const char* bytes = data_.data() + pos_;
+    pos_ += length;
+    return bytes;
+  }
+
+  uint8_t ReadU8() { return static_cast<uint8_t>(*Take(1)); }
+
+  uint32_t ReadU32() {
+    auto bytes = reinterpret_cast<const unsigned char*>(Take(4));
+    return static_cast<uint32_t>(bytes[0]) | static_cast<uint32_t>(bytes[1]) << 8 |
+           static_cast<uint32_t>(bytes[2]) << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+  }
+
+  /// Read the number of table entries that follow, each of which is at least \p min_size bytes
+  std::size_t ReadCount(std::size_t min_size) {
+    std::size_t count = ReadU32();
+    if (count > (data_.size() - pos_) / min_size) Error("table size exceeds the input");
+    return count;
+  }
+
+  template <class Entry>
+  Entry* ReadIndex(const std::vector<Entry*>& table) {
+    auto index = ReadU32();
+    if (index >= table.size()) Error("table index out of range");
+    return table[index];
+  }
+
+  Symbol* ReadSymbol() { return ReadIndex(symbols_); }
+
+  BinaryASTTag ReadTag(SourceLoc& loc) {
+    auto tag = static_cast<BinaryASTTag>(ReadU8());
+    loc = ReadU32();
+    return tag;
+  }
+
+  void ReadTables();
+  Klass* ReadKlass();
+  Feature* ReadFeature();
+  Formal* ReadFormal();
+  KaseBranch* ReadKaseBranch();
+  Expression* ReadExpression();
+  Expression* ReadUntypedExpression(BinaryASTTag tag, SourceLoc loc);
+};
+
+void BinaryASTReader::ReadTables() {
+  if (data_.size() < sizeof(kMagic) || ::memcmp(Take(sizeof(kMagic)), kMagic, sizeof(kMagic)))
+    Error("missing magic number");
+  if (ReadU32() != kBinaryASTVersion) Error("unsupported version");
+
+  // Intern the table entries in order, matching the order the text reader would intern them
+  symbols_.resize(ReadCount(4));
+  for (auto& symbol : symbols_) {
+    auto length = ReadU32();
+    symbol = gIdentTable.emplace(Take(length), length);
+  }
+  strings_.resize(ReadCount(4));
+  for (auto& string : strings_) {
+    auto length = ReadU32();
+    string = gStringTable.emplace(Take(length), length);
+  }
+  ints_.resize(ReadCount(4));
+  for (auto& value : ints_) {
+    value = gIntTable.emplace(static_cast<int32_t>(ReadU32()));
+  }
+}
+
+Program* BinaryASTReader::ReadProgram() {
+  ReadTables();
+
+  SourceLoc loc;
+  if (ReadTag(loc) != BinaryASTTag::Program) Error("expected program");
+  auto klasses = Klasses::Create();
+  for (auto count = ReadU32(); count > 0; count--) {
+    klasses->push_back(ReadKlass());
+  }
+  return Program::Create(klasses, loc);
+}
+
+Klass* BinaryASTReader::ReadKlass() {
+  SourceLoc loc;
+  if (ReadTag(loc) != BinaryASTTag::Klass) Error("expected class");
+  auto name = ReadSymbol();
+  auto parent = ReadSymbol();
+  auto filename = StringLiteral::Create(ReadIndex(strings_), loc);
+  auto features = Features::Create();
+  for (auto count = ReadU32(); count > 0; count--) {
+    features->push_back(ReadFeature());
+  }
+  return Klass::Create(name, parent, features, filename, loc);
+}
+
+Feature* BinaryASTReader::ReadFeature() {
+  SourceLoc loc;
+  switch (ReadTag(loc)) {
+    case BinaryASTTag::Method: {
+      auto name = ReadSymbol();
+      auto formals = Formals::Create();
+      for (auto count = ReadU32(); count > 0; count--) {
+        formals->push_back(ReadFormal());
+      }
+      auto decl_type = ReadSymbol();
+      auto body = ReadExpression();
+      return Method::Create(name, formals, decl_type, body, loc);
+    }
+    case BinaryASTTag::Attr: {
+      auto name = ReadSymbol();
+      auto decl_type = ReadSymbol();
+      auto init = ReadExpression();
+      return Attr::Create(name, decl_type, init, loc);
+    }
+    default:
+      Error("expected feature");
+  }
+}
+
+Formal* BinaryASTReader::ReadFormal() {
+  SourceLoc loc;
+  if (ReadTag(loc) != BinaryASTTag::Formal) Error("expected formal");
+  auto name = ReadSymbol();
+  auto decl_type = ReadSymbol();
+  return Formal::Create(name, decl_type, loc);
+}
+
+KaseBranch* BinaryASTReader::ReadKaseBranch() {
+  SourceLoc loc;
+  if (ReadTag(loc) != BinaryASTTag::KaseBranch) Error("expected case branch");
+  auto name = ReadSymbol();
+  auto decl_type = ReadSymbol();
+  auto body = ReadExpression();
+  return KaseBranch::Create(name, decl_type, body, loc);
+}
+
+Expression* BinaryASTReader::ReadExpression() {
+  SourceLoc loc;
+  auto tag = ReadTag(loc);
+  auto expr = ReadUntypedExpression(tag, loc);
+  expr->set_type(ReadSymbol());
+  return expr;
+}
+
+Expression* BinaryASTReader::ReadUntypedExpression(BinaryASTTag tag, SourceLoc loc) {
+  typedef UnaryOperator::UnaryKind UnaryKind;
+  typedef BinaryOperator::BinaryKind BinaryKind;
+
+  switch (tag) {
+    case BinaryASTTag::Assign: {
+      auto name = ReadSymbol();
+      auto value = ReadExpression();
+      return Assign::Create(name, value, loc);
+    }
+    case BinaryASTTag::StaticDispatch: {
+      auto receiver = ReadExpression();
+      auto dispatch_type = ReadSymbol();
+      auto name = ReadSymbol();
+      auto actuals = Expressions::Create();
+      for (auto count = ReadU32(); count > 0; count--) {
+        actuals->push_back(ReadExpression());
+      }
+      return StaticDispatch::Create(receiver, dispatch_type, name, actuals, loc);
+    }
+    case BinaryASTTag::Dispatch: {
+      auto receiver = ReadExpression();
+      auto name = ReadSymbol();
+      auto actuals = Expressions::Create();
+      for (auto count = ReadU32(); count > 0; count--) {
+        actuals->push_back(ReadExpression());
+      }
+      return Dispatch::Create(receiver, name, actuals, loc);
+    }
+    case BinaryASTTag::Cond: {
+      auto pred = ReadExpression();
+      auto then_branch = ReadExpression();
+      auto else_branch = ReadExpression();
+      return Cond::Create(pred, then_branch, else_branch, loc);
+    }
+    case BinaryASTTag::Loop: {
+      auto pred = ReadExpression();
+      auto body = ReadExpression();
+      return Loop::Create(pred, body, loc);
+    }
+    case BinaryASTTag::Block: {
+      auto body = Expressions::Create();
+      for (auto count = ReadU32(); count > 0; count--) {
+        body->push_back(ReadExpression());
+      }
+      return Block::Create(body, loc);
+    }
+    case BinaryASTTag::Let: {
+      auto name = ReadSymbol();
+      auto decl_type = ReadSymbol();
+      auto init = ReadExpression();
+      auto body = ReadExpression();
+      return Let::Create(name, decl_type, init, body, loc);
+    }
+    case BinaryASTTag::Kase: {
+      auto input = ReadExpression();
+      auto cases = KaseBranches::Create();
+      for (auto count = ReadU32(); count > 0; count--) {
+        cases->push_back(ReadKaseBranch());
+      }
+      return Kase::Create(input, cases, loc);
+    }
+    case BinaryASTTag::Knew:
+      return Knew::Create(ReadSymbol(), loc);
+    case BinaryASTTag::Neg:
+      return UnaryOperator::Create(UnaryKind::UO_Neg, ReadExpression(), loc);
+    case BinaryASTTag::Not:
+      return UnaryOperator::Create(UnaryKind::UO_Not, ReadExpression(), loc);
+    case BinaryASTTag::IsVoid:
+      return UnaryOperator::Create(UnaryKind::UO_IsVoid, ReadExpression(), loc);
+    case BinaryASTTag::Add:
+    case BinaryASTTag::Sub:
+    case BinaryASTTag::Mul:
+    case BinaryASTTag::Div:
+    case BinaryASTTag::LessThan:
+    case BinaryASTTag::Equal:
+    case BinaryASTTag::LessOrEqual: {
+      static const BinaryKind kinds[] = {BinaryKind::BO_Add, BinaryKind::BO_Sub,
+                                         BinaryKind::BO_Mul, BinaryKind::BO_Div,
+                                         BinaryKind::BO_LT,  BinaryKind::BO_EQ,
+                                         BinaryKind::BO_LE};
+      auto kind = kinds[static_cast<int>(tag) - static_cast<int>(BinaryASTTag::Add)];
+      auto lhs = ReadExpression();
+      auto rhs = ReadExpression();
+      return BinaryOperator::Create(kind, lhs, rhs, loc);
+    }
+    case BinaryASTTag::Ref:
+      return Ref::Create(ReadSymbol(), loc);
+    case BinaryASTTag::NoExpr:
+      return NoExpr::Create(loc);
+    case BinaryASTTag::String:
+      return StringLiteral::Create(ReadIndex(strings_), loc);
+    case BinaryASTTag::Int:
+      return IntLiteral::Create(ReadIndex(ints_), loc);
+    case BinaryASTTag::Bool:
+      return BoolLiteral::Create(ReadIndex(ints_)->value() != 0, loc);
+    default:
+      Error("expected expression");
+  }
+}
+
+}  // anonymous namespace
+
+Program* ReadBinaryAST(std::istream& is) {
+  BinaryASTReader reader(is);
+  return reader.ReadProgram();
+}
+
+}  // namespace cool
@@ -32,20 +32,26 @@ WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 See the License for the specific language governing permissions and
 limitations under the License.
 */
-#include "fmt/ostream.h"
 #include "spdlog/spdlog.h"
 #include <algorithm>
 #include <iostream>
+#include <sstream>
 
 #include "cgen.h"
 #include "cgen_supp.h"
+#include "parallel.h"
+#include "time_report.h"
 
 Memmgr cgen_Memmgr = GC_NOGC;               // Enable/disable garbage collection
 Memmgr_Test cgen_Memmgr_Test = GC_NORMAL;   // Normal/test GC
 Memmgr_Debug cgen_Memmgr_Debug = GC_QUICK;  // Check heap frequently
 
 bool cgen_optimize = false;      // Optimize switch for code generator
+bool cgen_optimize_size = false; // Optimize for code size
 bool disable_reg_alloc = false;  // Don't do register allocation
+bool cgen_reg_args = false;      // Pass the last arguments in registers
+int cgen_int_cache_min = 0;      // Preallocated Int objects, none by default
+int cgen_int_cache_max = -1;
 
 extern void emit_string_constant(std::ostream& str, const char* s);
 
@@ -56,199 +62,10 @@ static const char* gc_collect_names[] = {"_NoGC_Collect", "_GenGC_Collect", "_Sc
 // user-defined names.
 #define TEMP1 "_1"
 
-namespace {
-
-//////////////////////////////////////////////////////////////////////////////
-//
-//  emit_* procedures
-//
-//  emit_X  writes code for operation "X" to the output stream.
-//  There is an emit_X for each opcode X, as well as emit_ functions
-//  for generating names according to the naming conventions (see emit.h)
-//  and calls to support functions defined in the trap handler.
-//
-//////////////////////////////////////////////////////////////////////////////
-
-/// Emit instruction with leading tab for readability
-template <typename S, typename... Args>
-std::ostream& emit_instr(std::ostream& os, const S& format_str, const Args&... args) {
-  // Insert leading tab before every instruction to make assembly more readable
-  os << "\t";
-  fmt::print(os, format_str, args...);
-  return os;
-}
-
-std::ostream& emit_load(const char* dest_reg, int offset, const char* source_reg,
-                        std::ostream& os) {
-  // An example of use fmtlib to print strings using Python like syntax
-  return emit_instr(os, "lw {0} {1}({2})\n", dest_reg, offset * WORD_SIZE, source_reg);
-}
-
-std::ostream& emit_store(const char* source_reg, int offset, const char* dest_reg,
-                         std::ostream& os) {
-  return emit_instr(os, "sw {2} {1}({0})\n", dest_reg, offset * WORD_SIZE, source_reg);
-}
-
-std::ostream& emit_load_imm(const char* dest_reg, int val, std::ostream& os) {
-  return emit_instr(os, "li {} {}\n", dest_reg, val);
-}
-
-std::ostream& emit_load_address(const char* dest_reg, const char* address, std::ostream& os) {
-  return emit_instr(os, "la {} {}\n", dest_reg, address);
-}
-
-std::ostream& emit_partial_load_address(const char* dest_reg, std::ostream& os) {
-  return emit_instr(os, "la {} ", dest_reg);
-}
-
-std::ostream& emit_move(const char* dest_reg, const char* source_reg, std::ostream& os) {
-  if (regEq(dest_reg, source_reg)) {
-    spdlog::debug("Omitting move from {} to {}", source_reg, dest_reg);
-    return os;
-  }
-  return emit_instr(os, "move {} {}\n", dest_reg, source_reg);
-}
-
-std::ostream& emit_neg(const char* dest, const char* src1, std::ostream& os) {
-  return emit_instr(os, "neg {} {}\n", dest, src1);
-}
-
-std::ostream& emit_binop(const char* op, const char* dest, const char* src1, const char* src2,
-                         std::ostream& os) {
-  return emit_instr(os, "{} {} {} {}\n", op, dest, src1, src2);
-}
-
-std::ostream& emit_add(const char* dest, const char* src1, const char* src2, std::ostream& os) {
-  return emit_binop("add", dest, src1, src2, os);
-}
-
-std::ostream& emit_addu(const char* dest, const char* src1, const char* src2, std::ostream& os) {
-  return emit_binop("addu", dest, src1, src2, os);
-}
-
-std::ostream& emit_addiu(const char* dest, const char* src1, int imm, std::ostream& os) {
-  return emit_instr(os, "addiu {} {} {}\n", dest, src1, imm);
-}
-
-std::ostream& emit_div(const char* dest, const char* src1, const char* src2, std::ostream& os) {
-  return emit_binop("div", dest, src1, src2, os);
-}
-
-std::ostream& emit_mul(const char* dest, const char* src1, const char* src2, std::ostream& os) {
-  return emit_binop("mul", dest, src1, src2, os);
-}
-
-std::ostream& emit_sub(const char* dest, const char* src1, const char* src2, std::ostream& os) {
-  return emit_binop("sub", dest, src1, src2, os);
-}
-
-std::ostream& emit_sll(const char* dest, const char* src1, int num, std::ostream& os) {
-  return emit_instr(os, "sll {} {} {}\n", dest, src1, num);
-}
-
-std::ostream& emit_jalr(const char* dest, std::ostream& os) {
-  return emit_instr(os, "jalr {}\n", dest);
-}
-
-std::ostream& emit_return(std::ostream& os) {
-  return emit_instr(os, "jr $ra\n");
-}
-
-std::ostream& emit_jal_to_label(const char* label, std::ostream& os) {
-  return emit_instr(os, "jal {}\n", label);
-}
-
-std::ostream& emit_copy(std::ostream& os) { return emit_jal_to_label("Object.copy", os); }
-
-std::ostream& emit_gc_assign(std::ostream& os) { return emit_jal_to_label("_GenGC_Assign", os); }
-
-std::ostream& emit_equality_test(std::ostream& os) {
-  return emit_jal_to_label("equality_test", os);
-}
-
-std::ostream& emit_case_abort(std::ostream& os) { return emit_jal_to_label("_case_abort", os); }
-
-std::ostream& emit_case_abort2(std::ostream& os) { return emit_jal_to_label("_case_abort2", os); }
-
-std::ostream& emit_dispatch_abort(std::ostream& os) {
-  return emit_jal_to_label("_dispatch_abort", os);
-}
-
-std::ostream& emit_label_ref(int l, std::ostream& os) {
-  os << "label" << l;
-  return os;
-}
-
-std::ostream& emit_label_def(int l, std::ostream& os) {
-  emit_label_ref(l, os) << ":" << std::endl;
-  return os;
-}
-
-std::ostream& emit_beqz(const char* source, int label, std::ostream& os) {
-  return emit_instr(os, "beqz {} label{}\n", source, label);
-}
-
-std::ostream& emit_beq(const char* src1, const char* src2, int label, std::ostream& os) {
-  return emit_instr(os, "beq {} {} label{}\n", src1, src2, label);
-}
-
-std::ostream& emit_bne(const char* src1, const char* src2, int label, std::ostream& os) {
-  return emit_instr(os, "bne {} {} label{}\n", src1, src2, label);
-}
-
-std::ostream& emit_bleq(const char* src1, const char* src2, int label, std::ostream& os) {
-  return emit_instr(os, "ble {} {} label{}\n", src1, src2, label);
-}
-
-std::ostream& emit_blt(const char* src1, const char* src2, int label, std::ostream& os) {
-  return emit_instr(os, "blt {} {} label{}\n", src1, src2, label);
-}
-
-std::ostream& emit_blti(const char* src1, int imm, int label, std::ostream& os) {
-  return emit_instr(os, "blt {} {} label{}\n", src1, imm, label);
-}
-
-std::ostream& emit_bgti(const char* src1, int imm, int label, std::ostream& os) {
-  return emit_instr(os, "bgt {} {} label{}\n", src1, imm, label);
-}
-
-std::ostream& emit_branch(int label, std::ostream& os) {
-  return emit_instr(os, "b label{}\n", label);
-}
-
-/// Push a register on the stack. The stack grows towards smaller addresses.
-std::ostream& emit_push(const char* reg, std::ostream& os) {
-  emit_store(reg, 0, SP, os);
-  emit_addiu(SP, SP, -4, os);
-  return os;
-}
-
-/// Fetch the integer value in an Int object.
-std::ostream& emit_fetch_int(const char* dest, const char* source, std::ostream& os) {
-  return emit_load(dest, DEFAULT_OBJFIELDS, source, os);
-}
-
-/// Update the integer value in an int object.
-std::ostream& emit_store_int(const char* source, const char* dest, std::ostream& os) {
-  return emit_store(source, DEFAULT_OBJFIELDS, dest, os);
-}
-
-std::ostream& emit_gc_check(const char* source, std::ostream& os) {
-  if (source != A1) {
-    emit_move(A1, source, os);
-  }
-  return emit_jal_to_label("_gc_check", os);
-}
-
-}  // namespace
-
 namespace cool {
 
 bool gCgenDebug = false;
 
-int num_label = 0;
-int num_temp = 0;  // number of temporals in a method body
-
 // clang-format off
 extern Symbol
     *arg,
@@ -280,63 +97,137 @@ extern Symbol
     *val;
 // clang-format on
 
+// Whether Int and Bool values may be kept as raw words (see Expression::CodeGenUnboxed). The
+// collectors scan the stack conservatively and would mistake a raw word in a frame slot for a heap
+// pointer, so this is limited to programs compiled without GC.
+static bool cgen_unbox() {
+    return cgen_optimize && cgen_Memmgr == GC_NOGC;
+}
+
+
+// Whether method bodies use the register allocator. Like unboxed values, pointers held in registers
+// are invisible to the collectors.
+static bool cgen_regalloc() {
+    return cgen_optimize && !disable_reg_alloc && cgen_Memmgr == GC_NOGC;
+}
+
+
+// Whether Int objects are preallocated for small values, to be used in place of new boxes
+static bool cgen_int_cache() {
+    return cgen_int_cache_min <= cgen_int_cache_max;
+}
+
+
+// Registers that the last arguments of a call are passed in (-a), in order
+static const Register arg_registers[] = {A1, A2, A3};
+static const int max_reg_args = sizeof(arg_registers) / sizeof(arg_registers[0]);
+
+
+// Number of the arguments of a call with num_arg arguments that are passed in registers, the last
+// ones, the others are pushed on the stack. All methods agree on it, the predefined methods, which
+// take their arguments on the stack, are entered through a thunk that pushes them.
+static int num_reg_args(int num_arg) {
+    return cgen_optimize && cgen_reg_args ? std::min(num_arg, max_reg_args) : 0;
+}
+
+
+// Defined with the helper functions of code generation
+bool method_is_predefined(Symbol *class_name, Symbol *method_name);
+
+
+static bool is_unboxable(Symbol *type) {
+    return type == Int || type == Bool;
+}
+
+
 namespace {
 
-/// Emit label for prototype object of class
-std::ostream& emit_protobj_ref(Symbol* sym, std::ostream& os) {
-  return os << sym << PROTOBJ_SUFFIX;
+//////////////////////////////////////////////////////////////////////////////
+//
+//  emit_* procedures
+//
+//  The instructions are added to the MipsCode of a method with its builders,
+//  named after the opcodes (see mips.h). emit_X adds the call to support
+//  function "X" defined in the trap handler, and the emit_ and _label
+//  functions generate names according to the naming conventions (see emit.h).
+//
+//////////////////////////////////////////////////////////////////////////////
+
+/// Label for prototype object of class
+std::string protobj_label(Symbol* sym) { return sym->value().str() + PROTOBJ_SUFFIX; }
+
+/// Label for dispatch table of class
+std::string disptable_label(Symbol* sym) { return sym->value().str() + DISPTAB_SUFFIX; }
+
+/// Label for method of a class
+std::string method_label(Symbol* classname, Symbol* methodname) {
+  return classname->value().str() + METHOD_SEP + methodname->value().str();
 }
 
+/// Label for initialization code for a class
+std::string init_label(Symbol* sym) { return sym->value().str() + CLASSINIT_SUFFIX; }
+
+/// Label of a method in the dispatch tables, the method or the thunk of a predefined one (-a)
+std::string call_label(Symbol* classname, Symbol* methodname, int num_arg) {
+  if (num_reg_args(num_arg) > 0 && method_is_predefined(classname, methodname)) {
+    return method_label(classname, methodname) + THUNK_SUFFIX;
+  }
+  return method_label(classname, methodname);
+}
+
+/// Emit label for prototype object of class
+std::ostream& emit_protobj_ref(Symbol* sym, std::ostream& os) { return os << protobj_label(sym); }
+
 /// Emit label for dispatch table of class
 std::ostream& emit_disptable_ref(Symbol* sym, std::ostream& os) {
-  return os << sym << DISPTAB_SUFFIX;
+  return os << disptable_label(sym);
 }
 
 /// Emit label for method of a class
 std::ostream& emit_method_ref(Symbol* classname, Symbol* methodname, std::ostream& os) {
-  return os << classname << METHOD_SEP << methodname;
+  return os << method_label(classname, methodname);
 }
 
 /// Emit label for initialization code for a class
-std::ostream& emit_init_ref(Symbol* sym, std::ostream& os) { return os << sym << CLASSINIT_SUFFIX; }
+std::ostream& emit_init_ref(Symbol* sym, std::ostream& os) { return os << init_label(sym); }
 
-/// Emit JAL to class initialization code
-std::ostream& emit_init(Symbol* classname, std::ostream& os) {
-  os << JAL;
-  return emit_init_ref(classname, os) << std::endl;
-}
+/// Call a support function of the runtime
+void emit_jal_to_label(const char* label, MipsCode& code) { code.Jal(label, MipsSpacing::kSpace); }
+
+void emit_equality_test(MipsCode& code) { emit_jal_to_label("equality_test", code); }
+
+void emit_case_abort(MipsCode& code) { emit_jal_to_label("_case_abort", code); }
 
 /**
  * Generate reference to label for String constant
- * @param os std::ostream to write generated code to
  * @param entry String constant
- * @return os
+ * @return Label
  */
-std::ostream& CgenRef(std::ostream& os, const StringEntry* entry) {
-  os << STRCONST_PREFIX << entry->id();
-  return os;
-}
+std::string CgenRef(const StringEntry* entry) { return STRCONST_PREFIX + std::to_string(entry->id()); }
 
 /**
  * Generate reference to label for Int constant
- * @param os std::ostream to write generated code to
  * @param entry Int constant
- * @return os
+ * @return Label
  */
-std::ostream& CgenRef(std::ostream& os, const Int32Entry* entry) {
-  os << INTCONST_PREFIX << entry->id();
-  return os;
-}
+std::string CgenRef(const Int32Entry* entry) { return INTCONST_PREFIX + std::to_string(entry->id()); }
 
 /**
  * Generate reference to label for Bool constant
- * @param os std::ostream to write generated code to
  * @param entry Bool constant
+ * @return Label
+ */
+std::string CgenRef(bool entry) { return BOOLCONST_PREFIX + std::to_string(entry ? 1 : 0); }
+
+/**
+ * Emit reference to label for a String, Int or Bool constant
+ * @param os std::ostream to write generated code to
+ * @param entry Constant
  * @return os
  */
-std::ostream& CgenRef(std::ostream& os, bool entry) {
-  os << BOOLCONST_PREFIX << ((entry) ? 1 : 0);
-  return os;
+template <class Entry>
+std::ostream& CgenRef(std::ostream& os, Entry entry) {
+  return os << CgenRef(entry);
 }
 
 
@@ -348,7 +239,7 @@ std::ostream& CgenRef(std::ostream& os, bool entry) {
  * @return os
  */
 std::ostream& CgenDef(std::ostream& os, const StringEntry* entry, std::size_t class_tag) {
-  const std::string& value = entry->value();
+  const StringRef& value = entry->value();
   auto length_entry = gIntTable.emplace(value.size());
 
   // Add -1 eye catcher
@@ -360,7 +251,7 @@ std::ostream& CgenDef(std::ostream& os, const StringEntry* entry, std::size_t cl
   emit_disptable_ref(String, os) << std::endl;
   os << WORD;
   CgenRef(os, length_entry) << std::endl;
-  emit_string_constant(os, value.c_str());
+  emit_string_constant(os, entry->c_str());
   os << ALIGN;
   return os;
 }
@@ -412,14 +303,10 @@ std::ostream& CgenDef(std::ostream& os, bool entry, std::size_t class_tag) {
  */
 template <class Elem>
 std::ostream& CgenDef(std::ostream& os, const SymbolTable<Elem>& table, size_t class_tag) {
-  std::vector<Elem*> values;
-  for (const auto& value : table) {
-    values.push_back(value.second.get());
-  }
-  // Reverse sort by index to maintain backward compatibility with cool
-  std::sort(values.begin(), values.end(),
-            [](const Elem* lhs, const Elem* rhs) { return lhs->id() > rhs->id(); });
-  for (const auto& value : values) {
+  // The table iterates in index order, emit in reverse to maintain backward compatibility with cool
+  std::vector<Elem*> values(table.begin(), table.end());
+  for (auto it = values.rbegin(); it != values.rend(); ++it) {
+    const auto& value = *it;
     CgenDef(os, value, class_tag);
   }
   return os;
@@ -512,10 +399,21 @@ void CgenKlassTable::CgenConstants(std::ostream& os) const {
   // Make sure "default" values are in their respective tables
   gStringTable.emplace("");
   gIntTable.emplace(0);
+  for (int value = cgen_int_cache_min; value <= cgen_int_cache_max; value++) {
+    gIntTable.emplace(value);
+  }
 
   std::size_t string_tag = TagFind(String), int_tag = TagFind(Int), bool_tag = TagFind(Bool);
   CgenDef(os, gStringTable, string_tag);
   CgenDef(os, gIntTable, int_tag);
+  // Table of the preallocated Int objects, indexed by value - cgen_int_cache_min
+  if (cgen_int_cache()) {
+    os << INTCACHE << LABEL;
+    for (int value = cgen_int_cache_min; value <= cgen_int_cache_max; value++) {
+      os << WORD;
+      CgenRef(os, gIntTable.lookup(value)) << std::endl;
+    }
+  }
   CgenDef(os, false, bool_tag);
   CgenDef(os, true, bool_tag);
 }
@@ -541,35 +439,52 @@ void CgenKlassTable::CgenGlobalText(std::ostream& os) const {
 // While it would seem natural for this to be a const method, the process of code generation
 // modifies the nodes in the KlassTable.
 void CgenKlassTable::CodeGen(std::ostream& os) {
-  CgenGlobalData(os);
-  CgenSelectGC(os);
-  CgenConstants(os);
+  TimePhase("CgenGlobalData", [&]() { CgenGlobalData(os); });
+  TimePhase("CgenSelectGC", [&]() { CgenSelectGC(os); });
+  TimePhase("CgenConstants", [&]() { CgenConstants(os); });
 
   // Do all the varBinding
-  allBinding();
+  TimePhase("allBinding", [&]() { allBinding(); });
 
   // Add your code to emit:
   // 1. Prototype objects
-  CgenProtobj(os);
+  TimePhase("CgenProtobj", [&]() { CgenProtobj(os); });
   // 2. class_nameTab and class_objTab
-  CgenClassNameTable(os);
-  CgenClassObjTable(os);
+  TimePhase("CgenClassNameTable", [&]() { CgenClassNameTable(os); });
+  TimePhase("CgenClassObjTable", [&]() { CgenClassObjTable(os); });
   // 3. Dispatch tables for each class
-  CgenDispTable(os);
+  TimePhase("CgenDispTable", [&]() { CgenDispTable(os); });
 
-  CgenGlobalText(os);
+  TimePhase("CgenGlobalText", [&]() { CgenGlobalText(os); });
 
   // Add your code to emit:
-  // 1. Object initializers for each class  (xxx.init())
-  CgenObjInit(os);
-  // 2. Class methods
-  CgenMethBody(os);
-
+  // 1. Object initializers for each class  (xxx.init()) and class methods
+  TimePhase("CgenUnits", [&]() { CgenUnits(os); });
+  // 2. Abort stubs shared by the void checks
+  TimePhase("CgenAbortStubs", [&]() { CgenAbortStubs(os); });
+  // 3. Thunks of the predefined methods taking arguments in registers
+  TimePhase("CgenThunks", [&]() { CgenThunks(os); });
 }
 
 
 void Cgen(Program* program, std::ostream& os) {
+  PhaseTimer cgen_timer("cgen");
+  if (cgen_optimize) {
+    PhaseTimer timer("FoldConstants");
+    // The first pass finds the assigned variables, the second propagates the others
+    for (auto klass : *program->klasses()) {
+      for (auto feature : *klass->features()) {
+        ConstantFolder folder;
+        feature->FoldConstants(folder);
+        folder.propagate = true;
+        feature->FoldConstants(folder);
+      }
+    }
+  }
+
+  PhaseTimer klass_table_timer("CgenKlassTable");
   CgenKlassTable klass_table(program->klasses());
+  klass_table_timer.Stop();
   klass_table.CodeGen(os);
 }
 
@@ -650,7 +565,7 @@ void CgenKlassTable::CgenProtobj(std::ostream& os) const {
 
         // Object size, offset 4
         // components: attributes, tag, dispatch pointer, garbage collector
-        os << WORD << node->evector_attr_.size() + 3 << std::endl;
+        os << WORD << node->num_attr_ + 3 << std::endl;
 
         // Dispatch pointer, offset 8
         os << WORD;
@@ -658,39 +573,64 @@ void CgenKlassTable::CgenProtobj(std::ostream& os) const {
         os << std::endl;
 
         // Attributes, offset 12+
-        for (auto attr_name : node->evector_attr_) {
-            os << WORD;
-            auto entry = node->etable_var_.Lookup(attr_name);
+        CgenProtobjAttrs(node, os);
+    } // end for
+} // end void CgenKlassTable::CgenProtobj(std::ostream& os) const
 
-            if (entry->decl_type_ == String) {
-                CgenRef(os, gStringTable.emplace(""));
-            }
-            else if (entry->decl_type_ == Int) {
-                CgenRef(os, gIntTable.emplace(0));
-            }
-            else if (entry->decl_type_ == Bool) {
-                CgenRef(os, false);
-            }
-            else {
-                os << 0;
-            }
 
-            os << std::endl;
-        } // end for
+// Emit the default values of the attributes defined in node and its ancestors (in offset order)
+void CgenKlassTable::CgenProtobjAttrs(const CgenNode *node, std::ostream& os) const {
+    if (node != root_) {
+        CgenProtobjAttrs(node->parent(), os);
+    }
+
+    for (auto attr_name : node->evector_attr_) {
+        os << WORD;
+        // Attributes can't be redefined, so the binding is in the class scope of the defining class
+        auto entry = node->etable_var_.Probe(attr_name);
+
+        if (entry->decl_type_ == String) {
+            CgenRef(os, gStringTable.emplace(""));
+        }
+        else if (entry->decl_type_ == Int) {
+            CgenRef(os, gIntTable.emplace(0));
+        }
+        else if (entry->decl_type_ == Bool) {
+            CgenRef(os, false);
+        }
+        else {
+            os << 0;
+        }
+
+        os << std::endl;
     } // end for
-} // end void CgenKlassTable::CgenProtobj(std::ostream& os) const
+} // end void CgenKlassTable::CgenProtobjAttrs
 
 
 // Emit dispatch table
 void CgenKlassTable::CgenDispTable(std::ostream& os) const {
+    std::vector<const MethBinding *> entries;
     for (auto node : nodes_) {
         os << node->name() << DISPTAB_SUFFIX << LABEL;
 
-        for (auto meth_name : node->evector_meth_) {
-            auto entry = node->etable_meth_[meth_name];
-            os << WORD << entry->class_name_ << "." << meth_name << std::endl;
+        // Fill in the table from the most derived class up, so that overriding methods take precedence
+        entries.assign(node->num_meth_, NULL);
+        for (const CgenNode *ancestor = node; ; ancestor = ancestor->parent()) {
+            for (auto feature : *ancestor->klass()->features()) {
+                if (!feature->attr()) {
+                    // Only the class scope has been entered in the etable_meth_
+                    auto entry = ancestor->etable_meth_.Probe(feature->name());
+                    if (!entries[entry->offset_ / 4]) {
+                        entries[entry->offset_ / 4] = entry;
+                    }
+                }
+            }
+            if (ancestor == root_) break;
         }
 
+        for (auto entry : entries) {
+            os << WORD << call_label(entry->class_name_, entry->meth_name_, entry->num_arg_) << std::endl;
+        }
     } // end for
 } // end void CgenKlassTable::CgenDispTable(std::ostream& os) const
 
@@ -708,17 +648,19 @@ void CgenKlassTable::doBinding(CgenNode *node, CgenNode *parent) {
     // Offset for methods in dispatch table
     int meth_offset = 0;
 
-    // Inheritance: duplicate the etables and evectors from parent to node
+    // Inheritance: extend the etables from parent to node, the parent's scopes are shared not copied.
+    // The evectors only hold the features added by node, the inherited features precede them.
     if (parent) {
         node->etable_var_ = parent->etable_var_;
-        node->evector_attr_ = parent->evector_attr_;
+        node->num_attr_ = parent->num_attr_;
         node->etable_meth_ = parent->etable_meth_;
-        node->evector_meth_ = parent->evector_meth_;
-        attr_offset += 4 * node->evector_attr_.size();
-        meth_offset += 4 * node->etable_meth_.size();
+        node->num_meth_ = parent->num_meth_;
+        attr_offset += 4 * node->num_attr_;
+        meth_offset += 4 * node->num_meth_;
     }
 
     node->etable_var_.EnterScope();
+    node->etable_meth_.EnterScope();
 
     // traverse each feature of this CgenNode
     for (auto feature : *node->klass()->features()) {
@@ -726,6 +668,7 @@ void CgenKlassTable::doBinding(CgenNode *node, CgenNode *parent) {
         // operation if feature is attribute
         {
             node->evector_attr_.push_back(feature->name());
+            node->num_attr_++;
 
             VarBinding *vb = new VarBinding();
             vb->class_name_ = node->name();
@@ -751,18 +694,19 @@ void CgenKlassTable::doBinding(CgenNode *node, CgenNode *parent) {
 
             // only insert meth_name into vector and bind a new offset
             // if the method was not defined in a parent class
-            if (node->etable_meth_[meth->name()] == NULL) {
-                node->evector_meth_.push_back(meth->name());
+            MethBinding *inherited = node->etable_meth_.Lookup(meth->name());
+            if (inherited == NULL) {
+                node->num_meth_++;
                 mb->offset_ = meth_offset;
                 meth_offset += 4;
             }
             // if a method is redefined, the offset does not change
             else {
-                mb->offset_ = node->etable_meth_[meth->name()]->offset_;
+                mb->offset_ = inherited->offset_;
             }
 
-            // Bind method to etable_meth_
-            node->etable_meth_[feature->name()] = mb;
+            // Bind method to etable_meth_, shadowing any inherited binding
+            node->etable_meth_.AddToScope(feature->name(), mb);
         }
     } // end for
 
@@ -773,13 +717,53 @@ void CgenKlassTable::doBinding(CgenNode *node, CgenNode *parent) {
 } // end void CgenKlassTable::doBinding(CgenNode *node, CgenNode *parent)
 
 
+// The bindings are shared with the subclasses that do not redefine the method, so the call is
+// monomorphic when every class in the subtree finds the same binding
+const MethBinding *CgenKlassTable::MonomorphicMeth(const CgenNode *node, Symbol *name) const {
+    const MethBinding *mb = node->etable_meth_.Lookup(name);
+    for (auto child : node->children_) {
+        if (MonomorphicMeth(child, name) != mb) {
+            return NULL;
+        }
+    }
+    return mb;
+}
+
+
 // Constructor of CgenEnv
-CgenEnv::CgenEnv(CgenKlassTable *klass_table_arg,
-        CgenNode *curr_cgen_node_arg,
-        std::ostream &os_arg) :
+CgenEnv::CgenEnv(CgenKlassTable *klass_table_arg, CgenUnit &unit_arg) :
         klass_table(klass_table_arg),
-        curr_cgen_node(curr_cgen_node_arg),
-        os(os_arg) {}
+        curr_cgen_node(unit_arg.node),
+        unit(unit_arg),
+        code(unit_arg.code) {}
+
+// Find the VarBinding for a variable, searching the method-local scopes and then the class attributes
+VarBinding *CgenEnv::LookupVar(Symbol *name) const {
+    VarBinding *target = etable_local.Lookup(name);
+    return target ? target : curr_cgen_node->etable_var_.Lookup(name);
+}
+
+
+void VarBinding::EmitLoad(MipsCode &code) const {
+    if (reg_) {
+        code.Move(ACC, reg_);
+    } else if (origin_ == ATTR) {
+        code.Lw(ACC, offset_, SELF);
+    } else {
+        code.Lw(ACC, offset_, FP);
+    }
+}
+
+
+void VarBinding::EmitStore(MipsCode &code) const {
+    if (reg_) {
+        code.Move(reg_, ACC);
+    } else if (origin_ == ATTR) {
+        code.Sw(ACC, offset_, SELF);
+    } else {
+        code.Sw(ACC, offset_, FP);
+    }
+}
 
 
 
@@ -789,74 +773,268 @@ CgenEnv::CgenEnv(CgenKlassTable *klass_table_arg,
  */
 // Prologue before the codegen for attribute init
 // Keep a similar structure that allows to store temporals
-void prologue_weird(std::ostream &os, int max_temp) {
+void prologue_weird(MipsCode &code, int max_temp) {
     // move stack pointer 3 words down
-    os << ADDIU << SP << " " << SP << " " << (-12 - 4 * max_temp) << "\n";
+    code.Addiu(SP, SP, -12 - 4 * max_temp);
     // store the address of the old framepointer as the first record
-    os << SW << FP << " 12(" << SP << ")\n" ;
+    code.Sw(FP, 12, SP);
     // create the new framepointer
-    os << ADDIU << FP << " " << SP << " 4\n";
+    code.Addiu(FP, SP, 4);
 }
 
 
 // Epilogue after the codegen for attribute init
 // Keep a similar structure that allows to store temporals
-void epilogue_weird(std::ostream &os, int max_temp) {
+void epilogue_weird(MipsCode &code, int max_temp) {
     // Restore the old framepointer
-    os << LW << FP << " 12(" << SP << ")\n";
+    code.Lw(FP, 12, SP);
     // Pop stackframe (both callee's save and callee's arguments)
-    os << ADDIU << SP << " " << SP << " " << 12 + 4 * max_temp << "\n";
+    code.Addiu(SP, SP, 12 + 4 * max_temp);
 }
 
 
 // Callee prologue
-void prologue(std::ostream &os, int max_temp) {
+void prologue(MipsCode &code, int max_temp) {
     // move stack pointer 3 words down
-    os << ADDIU << SP << " " << SP << " " << (-12 - 4 * max_temp) << "\n";
+    code.Addiu(SP, SP, -12 - 4 * max_temp);
     // store the address of the old framepointer as the first record
-    os << SW << FP << " 12(" << SP << ")\n" ;
+    code.Sw(FP, 12, SP);
     // store the address of caller's self as the second record
-    os << SW << SELF << " 8(" << SP << ")\n";
+    code.Sw(SELF, 8, SP);
     // store the caller's return address as the third record
-    os << SW << RA << " 4(" << SP << ")\n";
+    code.Sw(RA, 4, SP);
     // create the new framepointer
-    os << ADDIU << FP << " " << SP << " 4\n";
+    code.Addiu(FP, SP, 4);
     // place callee's self in $s0
     // callee's self is already in $a0 at some point
-    os << MOVE << SELF << " " << ACC << "\n";
-} // end void prologue(std::ostream &os)
+    code.Move(SELF, ACC);
+} // end void prologue(MipsCode &code)
 
 
 // Callee epilogue for object initializer
-void epilogue_init(std::ostream &os) {
+void epilogue_init(MipsCode &code) {
     // Place callee's self in the accumulator
-    os << MOVE << ACC << " " << SELF << "\n";
+    code.Move(ACC, SELF);
     // Restore the old framepointer
-    os << LW << FP << " 12(" << SP << ")\n";
+    code.Lw(FP, 12, SP);
     // Restore the caller's self
-    os << LW << SELF << " 8(" << SP << ")\n";
+    code.Lw(SELF, 8, SP);
     // Place the return address in $ra
-    os << LW << RA << " 4(" << SP << ")\n";
+    code.Lw(RA, 4, SP);
     // Pop stackframe
-    os << ADDIU << SP << " " << SP << " 12\n";
+    code.Addiu(SP, SP, 12);
     // Jump to the return address
-    os << RET << "\n";
-} // void epilogue(std::ostream &os)
+    code.Jr(RA);
+} // void epilogue(MipsCode &code)
 
 
 // General epilogue
-void epilogue_general(std::ostream &os, int num_arg, int max_temp) {
+void epilogue_general(MipsCode &code, int num_arg, int max_temp) {
     // Restore the old framepointer
-    os << LW << FP << " 12(" << SP << ")\n";
+    code.Lw(FP, 12, SP);
     // Restore the caller's self
-    os << LW << SELF << " 8(" << SP << ")\n";
+    code.Lw(SELF, 8, SP);
     // Place the return address in $ra
-    os << LW << RA << " 4(" << SP << ")\n";
+    code.Lw(RA, 4, SP);
     // Pop stackframe (both callee's save and callee's arguments)
-    os << ADDIU << SP << " " << SP << " " << 12 + 4 * num_arg + 4 * max_temp << "\n";
+    code.Addiu(SP, SP, 12 + 4 * num_arg + 4 * max_temp);
+    // Jump to the return address
+    code.Jr(RA);
+} // end void epilogue_general(MipsCode &code)
+
+
+// Epilogue of a method or object initializer without a frame (-O)
+void epilogue_leaf(MipsCode &code, int num_arg) {
+    // Pop the callee's arguments
+    if (num_arg > 0) {
+        code.Addiu(SP, SP, 4 * num_arg);
+    }
     // Jump to the return address
-    os << RET << "\n";
-} // end void epilogue_general(std::ostream &os)
+    code.Jr(RA);
+}
+
+
+// True if an instruction of code from begin on reads or writes reg
+bool code_mentions(const MipsCode &code, std::size_t begin, Register reg) {
+    const auto &instrs = code.instrs();
+    for (std::size_t i = begin; i < instrs.size(); i++) {
+        if (instrs[i].Mentions(reg)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+// Remove the frame of leaf code, which makes no calls, pushes nothing and keeps nothing in its
+// frame but the arguments, e.g. getters and setters. Self is then kept in $t3 instead of the
+// callee-saved $s0 and the arguments are addressed relative to $sp. The prologue starts at
+// frame_begin and the body at body_begin, the body is left as is and false returned if it is not
+// leaf code. uses_self is set if the body refers to self.
+bool elide_frame(MipsCode &code, std::size_t frame_begin, std::size_t body_begin, int max_temp,
+                 bool &uses_self) {
+    auto &instrs = code.instrs();
+    // Offsets of $fp above the last argument are arguments, below are the saved registers and temporals
+    int arg_offset = 12 + 4 * max_temp;
+    uses_self = false;
+    for (std::size_t i = body_begin; i < instrs.size(); i++) {
+        const MipsInstr &instr = instrs[i];
+        switch (instr.op) {
+        case MipsOp::kJ:
+        case MipsOp::kJal:
+        case MipsOp::kJalr:
+        case MipsOp::kJr:
+            return false;
+        default:
+            break;
+        }
+        if (instr.Mentions(SP)) {
+            return false;
+        }
+        if (instr.Mentions(FP)) {
+            bool is_arg = (instr.op == MipsOp::kLw || instr.op == MipsOp::kSw) &&
+                          SameRegister(instr.rs, FP) && !SameRegister(instr.rd, FP) &&
+                          instr.symbol.empty() && instr.imm >= arg_offset;
+            if (!is_arg) {
+                return false;
+            }
+        }
+        uses_self = uses_self || instr.Mentions(SELF);
+    }
+
+    for (std::size_t i = body_begin; i < instrs.size(); i++) {
+        MipsInstr &instr = instrs[i];
+        if (SameRegister(instr.rs, FP)) {
+            // $fp would have been 8 + 4 * max_temp bytes below $sp
+            instr.rs = SP;
+            instr.imm -= 8 + 4 * max_temp;
+        }
+        for (Register *reg : {&instr.rd, &instr.rs, &instr.rt}) {
+            if (SameRegister(*reg, SELF)) {
+                *reg = T3;
+            }
+        }
+    }
+    instrs.erase(instrs.begin() + frame_begin, instrs.begin() + body_begin);
+    if (uses_self) {
+        MipsInstr move(MipsOp::kMove);
+        move.rd = T3;
+        move.rs = ACC;
+        instrs.insert(instrs.begin() + frame_begin, std::move(move));
+    }
+    return true;
+}
+
+
+// Index of the first instruction of code that may run once the one at index from has, which is
+// from itself unless a branch at or after it jumps back to an earlier label, e.g. in a loop
+std::size_t first_reachable(const MipsCode &code, std::size_t from) {
+    const auto &instrs = code.instrs();
+    std::unordered_map<int, std::size_t> defined;
+    for (std::size_t i = 0; i < instrs.size(); i++) {
+        if (instrs[i].op == MipsOp::kLabel && instrs[i].label != kNoLabel) {
+            defined.emplace(instrs[i].label, i);
+        }
+    }
+    std::size_t first = from;
+    for (std::size_t i = instrs.size(); i-- > first;) {
+        const MipsInstr &instr = instrs[i];
+        if (instr.op != MipsOp::kLabel && instr.IsControl() && instr.label != kNoLabel) {
+            auto found = defined.find(instr.label);
+            if (found != defined.end() && found->second < first) {
+                // Scan again from the end, the code from the label on may run as well
+                first = found->second;
+                i = instrs.size();
+            }
+        }
+    }
+    return first;
+}
+
+
+// Keep the arguments passed in registers (-a) there rather than in the temporals they are saved in,
+// if the body only accesses them before it makes a call or writes their register. That is the
+// whole body of leaf code, and the code up to the first call otherwise, where an argument is often
+// only passed on. Each slot is the offset of such a temporal and the register of its argument.
+// Removing the saves from the prologue moves body_begin.
+void keep_reg_args(MipsCode &code, std::size_t frame_begin, std::size_t &body_begin,
+                   const std::vector<std::pair<int, Register>> &slots) {
+    auto &instrs = code.instrs();
+
+    // Register of the argument saved in the temporal that a lw or sw accesses, null if none
+    auto slot_register = [&slots](const MipsInstr &instr) {
+        if ((instr.op == MipsOp::kLw || instr.op == MipsOp::kSw) && SameRegister(instr.rs, FP) &&
+            instr.symbol.empty()) {
+            for (auto &slot : slots) {
+                if (slot.first == instr.imm) {
+                    return slot.second;
+                }
+            }
+        }
+        return kNullRegister;
+    };
+
+    std::vector<Register> kept;
+    for (auto &slot : slots) {
+        // The register is clobbered by a call or a write, the argument is then only in the temporal
+        std::size_t clobber = body_begin;
+        for (; clobber < instrs.size(); clobber++) {
+            const MipsInstr &instr = instrs[clobber];
+            if (instr.op == MipsOp::kJ || instr.op == MipsOp::kJal || instr.op == MipsOp::kJalr ||
+                SameRegister(instr.Written(), slot.second)) {
+                break;
+            }
+        }
+        std::size_t end = clobber < instrs.size() ? first_reachable(code, clobber) : instrs.size();
+        bool keep = true;
+        for (std::size_t i = end; i < instrs.size() && keep; i++) {
+            keep = !SameRegister(slot_register(instrs[i]), slot.second);
+        }
+        if (keep) {
+            kept.push_back(slot.second);
+        }
+    }
+    auto is_kept = [&kept](Register reg) {
+        return std::any_of(kept.begin(), kept.end(),
+                           [reg](Register k) { return SameRegister(k, reg); });
+    };
+
+    for (std::size_t i = body_begin; i < instrs.size(); i++) {
+        MipsInstr &instr = instrs[i];
+        Register arg_reg = slot_register(instr);
+        if (!is_kept(arg_reg)) {
+            continue;
+        }
+        MipsInstr move(MipsOp::kMove);
+        if (instr.op == MipsOp::kLw) {
+            move.rd = instr.rd;
+            move.rs = arg_reg;
+        } else {
+            move.rd = arg_reg;
+            move.rs = instr.rd;
+        }
+        instr = std::move(move);
+    }
+    for (std::size_t i = body_begin; i-- > frame_begin;) {
+        if (instrs[i].op == MipsOp::kSw && is_kept(slot_register(instrs[i]))) {
+            instrs.erase(instrs.begin() + i);
+            body_begin--;
+        }
+    }
+}
+
+
+// True if neither the object initializer of node nor those of its ancestors initialize an attribute
+bool init_is_empty(CgenNode *node) {
+    for (; node->name() != No_class; node = node->parent()) {
+        for (auto feature : *node->klass()->features()) {
+            if (feature->attr() && ((Attr *)feature)->init()->IsCode()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
 
 
 // Check whether a method of a class is already predefined
@@ -905,6 +1083,7 @@ void Loop::CountTemporal(int &num_temp, int &max_temp) {
 
 // Count temporals of a LET AST node
 void Let::CountTemporal(int &num_temp, int &max_temp) {
+    init_->CountTemporal(num_temp, max_temp);
     num_temp++;
     if (num_temp > max_temp) {max_temp = num_temp; }
     body_->CountTemporal(num_temp, max_temp);
@@ -913,6 +1092,7 @@ void Let::CountTemporal(int &num_temp, int &max_temp) {
 
 
 void Kase::CountTemporal(int &num_temp, int &max_temp) {
+    input_->CountTemporal(num_temp, max_temp);
     for (auto branch : *cases_) {
         branch->CountTemporal(num_temp, max_temp);
     }
@@ -951,23 +1131,513 @@ void BinaryOperator::CountTemporal(int &num_temp, int &max_temp) {
 }
 
 
-// Sort kasebranches by topological order of each type
-void Kase::SortBranches(CgenEnv &env) {
-    env.klass_table->SortSearch(this, env.klass_table->root_);
+// Report the live intervals of a method body, in the order the code is generated. Each formal,
+// let and case variable lives for its scope, the lhs of a binary operator while the rhs is
+// evaluated. The weight of a value counts the frame accesses a register saves, estimating that a
+// loop body runs 8 times.
+void Method::CollectIntervals(LiveIntervals &intervals) {
+    intervals.vars.EnterScope();
+    for (auto formal : *formals_) {
+        intervals.regs.Begin(formal);
+        // The argument is loaded into its register once
+        intervals.regs.AddWeight(formal, -1);
+        intervals.vars.AddToScope(formal->name(), formal);
+    }
+    body_->CollectIntervals(intervals);
+    for (auto formal : *formals_) {
+        intervals.regs.End(formal);
+    }
+    intervals.vars.ExitScope();
 }
 
 
-// Depth first search of inheritance graph that helps sort kasebranches
-void CgenKlassTable::SortSearch(Kase *caseexpr, CgenNode *node) {
-    // Traver all the children
-    for (auto child : node->children_) {
-        SortSearch(caseexpr, child);
+void Block::CollectIntervals(LiveIntervals &intervals) {
+    for (auto expr : *body_) {
+        expr->CollectIntervals(intervals);
     }
-    // Check whether find node->name() exists in a branch
-    // If yes, append that branch to caseexpr->sorted_cases_
-    for (auto branch : *caseexpr->cases_) {
-        if (node->name() == branch->decl_type_) {
-            caseexpr->sorted_cases_.push_back(branch);
+}
+
+
+void Cond::CollectIntervals(LiveIntervals &intervals) {
+    pred_->CollectIntervals(intervals);
+    then_branch_->CollectIntervals(intervals);
+    else_branch_->CollectIntervals(intervals);
+}
+
+
+void Loop::CollectIntervals(LiveIntervals &intervals) {
+    int frequency = intervals.frequency;
+    intervals.frequency = std::min(frequency * 8, 1 << 20);
+    pred_->CollectIntervals(intervals);
+    body_->CollectIntervals(intervals);
+    intervals.frequency = frequency;
+}
+
+
+void Let::CollectIntervals(LiveIntervals &intervals) {
+    init_->CollectIntervals(intervals);
+    intervals.regs.Begin(this);
+    intervals.regs.AddWeight(this, intervals.frequency);
+    intervals.vars.EnterScope();
+    intervals.vars.AddToScope(name_, this);
+    body_->CollectIntervals(intervals);
+    intervals.vars.ExitScope();
+    intervals.regs.End(this);
+}
+
+
+void Kase::CollectIntervals(LiveIntervals &intervals) {
+    input_->CollectIntervals(intervals);
+    for (auto branch : *cases_) {
+        intervals.regs.Begin(branch);
+        intervals.regs.AddWeight(branch, intervals.frequency);
+        intervals.vars.EnterScope();
+        intervals.vars.AddToScope(branch->name_, branch);
+        branch->body_->CollectIntervals(intervals);
+        intervals.vars.ExitScope();
+        intervals.regs.End(branch);
+    }
+}
+
+
+void Ref::CollectIntervals(LiveIntervals &intervals) {
+    const ASTNode *var = intervals.vars.Lookup(name_);
+    if (var) {
+        intervals.regs.AddWeight(var, intervals.frequency);
+    }
+}
+
+
+void Assign::CollectIntervals(LiveIntervals &intervals) {
+    value_->CollectIntervals(intervals);
+    const ASTNode *var = intervals.vars.Lookup(name_);
+    if (var) {
+        intervals.regs.AddWeight(var, intervals.frequency);
+    }
+}
+
+
+void Dispatch::CollectIntervals(LiveIntervals &intervals) {
+    // An argument passed in a register (-a) is held while the following arguments and the receiver
+    // are evaluated, unless they are pure and cannot clobber the argument registers
+    int num_arg = actuals_->size();
+    int first_reg_arg = num_arg - NumRegArgs(intervals.env);
+    // Whether the arguments from index i on and the receiver are pure
+    std::vector<bool> pure_from(num_arg + 1, receiver_->IsPure());
+    for (int i = num_arg - 1; i >= 0; i--) {
+        pure_from[i] = pure_from[i + 1] && actuals_->at(i)->IsPure();
+    }
+    std::vector<int> held;
+    for (int i = 0; i < num_arg; i++) {
+        actuals_->at(i)->CollectIntervals(intervals);
+        if (i >= first_reg_arg && !pure_from[i + 1]) {
+            intervals.regs.Begin(this, i);
+            // Saves a push and a pop
+            intervals.regs.AddWeight(this, 2 * intervals.frequency, i);
+            held.push_back(i);
+        }
+    }
+    receiver_->CollectIntervals(intervals);
+    for (auto i = held.rbegin(); i != held.rend(); ++i) {
+        intervals.regs.End(this, *i);
+    }
+}
+
+
+void UnaryOperator::CollectIntervals(LiveIntervals &intervals) {
+    input_->CollectIntervals(intervals);
+}
+
+
+void BinaryOperator::CollectIntervals(LiveIntervals &intervals) {
+    lhs_->CollectIntervals(intervals);
+    // The lhs is held while a pure rhs is evaluated without a register (see CodeGenOperands), and
+    // equality on other types than Int and Bool always uses the stack
+    bool holds_lhs = !rhs_->IsPure() && (kind_ != BO_EQ || is_unboxable(lhs_->type()));
+    if (holds_lhs) {
+        intervals.regs.Begin(this);
+        // Saves a push and a pop
+        intervals.regs.AddWeight(this, 2 * intervals.frequency);
+    }
+    rhs_->CollectIntervals(intervals);
+    if (holds_lhs) {
+        intervals.regs.End(this);
+    }
+}
+
+
+// Find the method arguments, let and case temporaries that never hold void. A variable is assumed to
+// be non-void until the pass sees a value that may be void stored in it, the pass is repeated until
+// the assumptions hold. Arguments may be void, a case temporary holds the non-void case input.
+VarBinding *NonVoidVars::Bind(const ASTNode *node, Symbol *name, bool non_void) {
+    auto inserted = vars_.emplace(node, VarBinding());
+    VarBinding *vb = &inserted.first->second;
+    if (inserted.second) {
+        vb->var_name_ = name;
+        vb->origin_ = ARG;
+        vb->non_void_ = non_void;
+    }
+    return vb;
+}
+
+
+void NonVoidVars::Store(VarBinding *vb, const Expression *expr) {
+    if (vb->non_void_ && !expr->NonVoid(env)) {
+        vb->non_void_ = false;
+        changed = true;
+    }
+}
+
+
+void Method::CollectNonVoid(NonVoidVars &vars) {
+    vars.env.etable_local.EnterScope();
+    for (auto formal : *formals_) {
+        vars.env.etable_local.AddToScope(formal->name(), vars.Bind(formal, formal->name(), false));
+    }
+    body_->CollectNonVoid(vars);
+    vars.env.etable_local.ExitScope();
+}
+
+
+void Assign::CollectNonVoid(NonVoidVars &vars) {
+    value_->CollectNonVoid(vars);
+    // Attributes are not tracked
+    VarBinding *target = vars.env.etable_local.Lookup(name_);
+    if (target) {
+        vars.Store(target, value_);
+    }
+}
+
+
+void Dispatch::CollectNonVoid(NonVoidVars &vars) {
+    for (auto actual : *actuals_) {
+        actual->CollectNonVoid(vars);
+    }
+    receiver_->CollectNonVoid(vars);
+}
+
+
+void Cond::CollectNonVoid(NonVoidVars &vars) {
+    pred_->CollectNonVoid(vars);
+    then_branch_->CollectNonVoid(vars);
+    else_branch_->CollectNonVoid(vars);
+}
+
+
+void Loop::CollectNonVoid(NonVoidVars &vars) {
+    pred_->CollectNonVoid(vars);
+    body_->CollectNonVoid(vars);
+}
+
+
+void Block::CollectNonVoid(NonVoidVars &vars) {
+    for (auto expr : *body_) {
+        expr->CollectNonVoid(vars);
+    }
+}
+
+
+void Let::CollectNonVoid(NonVoidVars &vars) {
+    init_->CollectNonVoid(vars);
+    VarBinding *vb = vars.Bind(this, name_);
+    // Without an initializer only the basic classes have a non-void default value
+    if (init_->IsCode() || !(decl_type_ == Int || decl_type_ == Bool || decl_type_ == String)) {
+        vars.Store(vb, init_);
+    }
+    vars.env.etable_local.EnterScope();
+    vars.env.etable_local.AddToScope(name_, vb);
+    body_->CollectNonVoid(vars);
+    vars.env.etable_local.ExitScope();
+}
+
+
+void Kase::CollectNonVoid(NonVoidVars &vars) {
+    input_->CollectNonVoid(vars);
+    for (auto branch : *cases_) {
+        vars.env.etable_local.EnterScope();
+        vars.env.etable_local.AddToScope(branch->name_, vars.Bind(branch, branch->name_));
+        branch->body_->CollectNonVoid(vars);
+        vars.env.etable_local.ExitScope();
+    }
+}
+
+
+void UnaryOperator::CollectNonVoid(NonVoidVars &vars) {
+    input_->CollectNonVoid(vars);
+}
+
+
+void BinaryOperator::CollectNonVoid(NonVoidVars &vars) {
+    lhs_->CollectNonVoid(vars);
+    rhs_->CollectNonVoid(vars);
+}
+
+
+bool Expression::NonVoid(const CgenEnv &env) const {
+    return type_ == Int || type_ == Bool || type_ == String;
+}
+
+
+bool Assign::NonVoid(const CgenEnv &env) const {
+    return value_->NonVoid(env);
+}
+
+
+bool Block::NonVoid(const CgenEnv &env) const {
+    return body_->back()->NonVoid(env);
+}
+
+
+bool Cond::NonVoid(const CgenEnv &env) const {
+    return then_branch_->NonVoid(env) && else_branch_->NonVoid(env);
+}
+
+
+bool Ref::NonVoid(const CgenEnv &env) const {
+    return name_ == self || Expression::NonVoid(env) || env.LookupVar(name_)->non_void_;
+}
+
+
+// Fold the constant expressions of the features before the constants are emitted, so that the
+// folded values are added to gIntTable and gStringTable. The arithmetic follows the generated code:
+// addition, subtraction and negation trap on overflow, and those as well as the division by zero are
+// left to run, while the multiplication keeps the low 32 bits. A let variable bound to a literal
+// that is never assigned is replaced by the literal, and the let by its body. An expression is only
+// replaced by one of the same static type, e.g. an Object variable bound to 1 is not replaced by the
+// Int literal, which the code for `=` and the unboxed arithmetic would treat as a raw value.
+
+// Literal for value truncated to 32 bits
+static Expression *fold_int(int64_t value, SourceLoc loc) {
+    Expression *literal = IntLiteral::Create(static_cast<int32_t>(value), loc);
+    literal->set_type(Int);
+    return literal;
+}
+
+
+static Expression *fold_bool(bool value, SourceLoc loc) {
+    Expression *literal = BoolLiteral::Create(value, loc);
+    literal->set_type(Bool);
+    return literal;
+}
+
+
+static Expression *fold_string(const std::string &value, SourceLoc loc) {
+    Expression *literal = StringLiteral::Create(value, loc);
+    literal->set_type(String);
+    return literal;
+}
+
+
+static bool fits_int(int64_t value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+
+static bool is_literal(Expression *expr) {
+    return dynamic_cast<IntLiteral *>(expr) || dynamic_cast<BoolLiteral *>(expr) ||
+           dynamic_cast<StringLiteral *>(expr);
+}
+
+
+void Method::FoldConstants(ConstantFolder &folder) {
+    body_ = body_->FoldConstants(folder);
+}
+
+
+void Attr::FoldConstants(ConstantFolder &folder) {
+    init_ = init_->FoldConstants(folder);
+}
+
+
+Expression *Assign::FoldConstants(ConstantFolder &folder) {
+    value_ = value_->FoldConstants(folder);
+    folder.assigned.insert(name_);
+    return this;
+}
+
+
+Expression *Dispatch::FoldConstants(ConstantFolder &folder) {
+    for (std::size_t i = 0; i < actuals_->size(); i++) {
+        actuals_->set(i, actuals_->at(i)->FoldConstants(folder));
+    }
+    receiver_ = receiver_->FoldConstants(folder);
+
+    // String can not be inherited, the methods of a String literal are the predefined ones
+    auto receiver = dynamic_cast<StringLiteral *>(receiver_);
+    if (!receiver) {
+        return this;
+    }
+    std::string value = receiver->value();
+    if (name_ == length) {
+        return fold_int(value.size(), loc());
+    } else if (name_ == concat) {
+        auto arg = dynamic_cast<StringLiteral *>(actuals_->at(0));
+        if (arg) {
+            return fold_string(value + arg->value().str(), loc());
+        }
+    } else if (name_ == substr) {
+        // An index out of range aborts at runtime
+        auto start = dynamic_cast<IntLiteral *>(actuals_->at(0));
+        auto count = dynamic_cast<IntLiteral *>(actuals_->at(1));
+        if (start && count && start->value() >= 0 && count->value() >= 0 &&
+            int64_t(start->value()) + count->value() <= int64_t(value.size())) {
+            return fold_string(value.substr(start->value(), count->value()), loc());
+        }
+    }
+    return this;
+}
+
+
+Expression *Cond::FoldConstants(ConstantFolder &folder) {
+    pred_ = pred_->FoldConstants(folder);
+    then_branch_ = then_branch_->FoldConstants(folder);
+    else_branch_ = else_branch_->FoldConstants(folder);
+
+    auto pred = dynamic_cast<BoolLiteral *>(pred_);
+    if (pred) {
+        Expression *branch = pred->value() ? then_branch_ : else_branch_;
+        return branch->type() == type() ? branch : this;
+    }
+    return this;
+}
+
+
+Expression *Loop::FoldConstants(ConstantFolder &folder) {
+    pred_ = pred_->FoldConstants(folder);
+    body_ = body_->FoldConstants(folder);
+    return this;
+}
+
+
+Expression *Block::FoldConstants(ConstantFolder &folder) {
+    for (std::size_t i = 0; i < body_->size(); i++) {
+        body_->set(i, body_->at(i)->FoldConstants(folder));
+    }
+    return this;
+}
+
+
+Expression *Let::FoldConstants(ConstantFolder &folder) {
+    init_ = init_->FoldConstants(folder);
+
+    Expression *value = NULL;
+    if (folder.propagate && !folder.assigned.count(name_)) {
+        if (is_literal(init_) && init_->type() == decl_type_) {
+            value = init_;
+        } else if (!init_->IsCode()) {
+            // The default values of the basic classes
+            if (decl_type_ == Int) {
+                value = fold_int(0, loc());
+            } else if (decl_type_ == Bool) {
+                value = fold_bool(false, loc());
+            } else if (decl_type_ == String) {
+                value = fold_string("", loc());
+            }
+        }
+    }
+
+    folder.consts.EnterScope();
+    folder.consts.AddToScope(name_, value);
+    body_ = body_->FoldConstants(folder);
+    folder.consts.ExitScope();
+    return value ? body_ : this;
+}
+
+
+Expression *Kase::FoldConstants(ConstantFolder &folder) {
+    input_ = input_->FoldConstants(folder);
+    for (auto branch : *cases_) {
+        folder.consts.EnterScope();
+        folder.consts.AddToScope(branch->name_, NULL);
+        branch->body_ = branch->body_->FoldConstants(folder);
+        folder.consts.ExitScope();
+    }
+    return this;
+}
+
+
+Expression *Ref::FoldConstants(ConstantFolder &folder) {
+    Expression *value = folder.consts.Lookup(name_);
+    return value && value->type() == type() ? value : this;
+}
+
+
+Expression *UnaryOperator::FoldConstants(ConstantFolder &folder) {
+    input_ = input_->FoldConstants(folder);
+
+    auto int_input = dynamic_cast<IntLiteral *>(input_);
+    auto bool_input = dynamic_cast<BoolLiteral *>(input_);
+    if (kind_ == UO_Neg && int_input && fits_int(-int64_t(int_input->value()))) {
+        return fold_int(-int64_t(int_input->value()), loc());
+    } else if (kind_ == UO_Not && bool_input) {
+        return fold_bool(!bool_input->value(), loc());
+    }
+    return this;
+}
+
+
+Expression *BinaryOperator::FoldConstants(ConstantFolder &folder) {
+    lhs_ = lhs_->FoldConstants(folder);
+    rhs_ = rhs_->FoldConstants(folder);
+
+    auto lhs_int = dynamic_cast<IntLiteral *>(lhs_);
+    auto rhs_int = dynamic_cast<IntLiteral *>(rhs_);
+    if (lhs_int && rhs_int) {
+        int64_t lhs = lhs_int->value(), rhs = rhs_int->value();
+        switch (kind_) {
+            case BO_Add:
+                return fits_int(lhs + rhs) ? fold_int(lhs + rhs, loc()) : this;
+            case BO_Sub:
+                return fits_int(lhs - rhs) ? fold_int(lhs - rhs, loc()) : this;
+            case BO_Mul:
+                return fold_int(lhs * rhs, loc());
+            case BO_Div:
+                return rhs != 0 && fits_int(lhs / rhs) ? fold_int(lhs / rhs, loc()) : this;
+            case BO_LT:
+                return fold_bool(lhs < rhs, loc());
+            case BO_LE:
+                return fold_bool(lhs <= rhs, loc());
+            case BO_EQ:
+                return fold_bool(lhs == rhs, loc());
+        }
+    }
+
+    // Equal Bool and String constants are the same objects
+    if (kind_ == BO_EQ) {
+        auto lhs_bool = dynamic_cast<BoolLiteral *>(lhs_);
+        auto rhs_bool = dynamic_cast<BoolLiteral *>(rhs_);
+        auto lhs_string = dynamic_cast<StringLiteral *>(lhs_);
+        auto rhs_string = dynamic_cast<StringLiteral *>(rhs_);
+        if (lhs_bool && rhs_bool) {
+            return fold_bool(lhs_bool->value() == rhs_bool->value(), loc());
+        } else if (lhs_string && rhs_string) {
+            return fold_bool(lhs_string->entry() == rhs_string->entry(), loc());
+        }
+    }
+    return this;
+}
+
+
+// Sort kasebranches by topological order of each type
+std::vector<KaseBranch *> Kase::SortBranches(CgenEnv &env) const {
+    std::vector<KaseBranch *> sorted_cases;
+    env.klass_table->SortSearch(this, env.klass_table->root_, sorted_cases);
+    return sorted_cases;
+}
+
+
+// Depth first search of inheritance graph that helps sort kasebranches
+void CgenKlassTable::SortSearch(const Kase *caseexpr, CgenNode *node,
+                                std::vector<KaseBranch *> &sorted_cases) const {
+    // Traver all the children
+    for (auto child : node->children_) {
+        SortSearch(caseexpr, child, sorted_cases);
+    }
+    // Check whether find node->name() exists in a branch
+    // If yes, append that branch to sorted_cases
+    for (auto branch : *caseexpr->cases_) {
+        if (node->name() == branch->decl_type_) {
+            sorted_cases.push_back(branch);
         }
     }
 }
@@ -981,140 +1651,536 @@ void CgenKlassTable::SortSearch(Kase *caseexpr, CgenNode *node) {
  * Code generation
  */
 
-// Emite all object initializers
-void CgenKlassTable::CgenObjInit(std::ostream &os) {
-    for (auto node : nodes_) {
-        os << node->name() << CLASSINIT_SUFFIX << LABEL;
-        prologue(os, 0); // callee prologue
-
-        // initialze parent object
-        if (node->parent()->name() != No_class) {
-            os << JAL << node->parent()->name() << CLASSINIT_SUFFIX << "\n";
+// Load the preallocated Int object for the raw value in register `value` into ACC and continue at
+// label `done`. Falls through with ACC unchanged when the value is outside the cache.
+static void emit_int_cache_lookup(MipsCode &code, Register value, int done) {
+    int miss_label = code.NewLabel();
+    code.Addiu(T2, value, -cgen_int_cache_min);
+    code.Branch(MipsOp::kBgeu, T2, cgen_int_cache_max - cgen_int_cache_min + 1, miss_label);
+    code.Sll(T2, T2, LOG_WORD_SIZE);
+    code.Lw(ACC, INTCACHE, T2);
+    code.B(done);
+    code.Label(miss_label);
+}
+
+
+// Box the raw value of type `type` in ACC. An Int gets a fresh copy of the prototype object, unless
+// it is preallocated, a Bool selects one of the two bool constants.
+static void emit_box(MipsCode &code, Symbol *type) {
+    if (type == Bool) {
+        int merge_label = code.NewLabel();
+        code.Move(T1, ACC);
+        code.La(ACC, CgenRef(true));
+        code.Bne(T1, ZERO, merge_label);
+        code.La(ACC, CgenRef(false));
+        code.Label(merge_label);
+    } else {
+        int done_label = kNoLabel;
+        if (cgen_int_cache()) {
+            done_label = code.NewLabel();
+            emit_int_cache_lookup(code, ACC, done_label);
         }
+        // Keep the raw value on the stack across Object.copy
+        code.Sw(ACC, 0, SP);
+        code.Addiu(SP, SP, -4);
+        code.La(ACC, protobj_label(Int));
+        code.Jal("Object.copy");
+        code.Lw(T1, 4, SP);
+        code.Addiu(SP, SP, 4);
+        code.Sw(T1, 12, ACC);
+        if (cgen_int_cache()) {
+            code.Label(done_label);
+        }
+    }
+}
 
-        // Create Cgen for a specific class
-        CgenEnv envnow(this, node, os);
 
-        // If an attribute is initialized, we need to store the value in the stackframe
-        for (auto feature : *node->klass()->features()) {
-            // Do nothing for a method
-            if (feature->method()) {continue; }
-
-            Attr *attr = (Attr *)feature;
-            // Do nothing if an attribute is not initialized
-            if (!attr->init()->IsCode()) {continue; }
-
-            // Count how many temporals we need for attribute init
-            int num_temp = 0, max_temp = 0;
-            attr->init()->CountTemporal(num_temp, max_temp);
-            // Fake prologue that leaves space for temporals
-            prologue_weird(os, max_temp);
-            // Codegen for the initialized value
-            attr->init()->CodeGen(envnow);
-            // Fake epilogue that restores the stack 
-            epilogue_weird(os, max_temp);
-            // Store the value at the correct offset
-            os << SW << ACC << " " << node->etable_var_.Lookup(feature->name())->offset_
-               << "(" << SELF << ")\n";
+// Abort through the runtime routine `abort` with the file name and line number when ACC is void,
+// otherwise continue at label `label`, which must follow. With -Os the file name is loaded by a
+// stub shared by the file and the check falls through.
+static void emit_void_check(CgenEnv &env, int label, int line, const char *abort) {
+    const StringEntry *filename = gStringTable.lookup(env.curr_cgen_node->filename()->value());
+    if (cgen_optimize_size) {
+        env.code.Li(T1, line);
+        env.code.Beqz(ACC, env.klass_table->AbortStub(abort, filename));
+        return;
+    }
+
+    env.code.Bne(ACC, ZERO, label);
+    // Load filename into ACC
+    env.code.La(ACC, CgenRef(filename));
+    // Load line number into T1
+    env.code.Li(T1, line);
+    // Abort
+    emit_jal_to_label(abort, env.code);
+}
+
+
+
+
+// Generate an expression whose value is discarded. The unboxed form never allocates more than
+// the boxed one, so it is preferred for Int and Bool expressions.
+static void CodeGenDiscarded(Expression *expr, CgenEnv &env) {
+    if (cgen_unbox() && is_unboxable(expr->type())) {
+        expr->CodeGenUnboxed(env);
+    } else {
+        expr->CodeGen(env);
+    }
+}
+
+
+// Hold the value in ACC, the lhs of binary operator `op` or argument `index` of dispatch `op`,
+// while the rest of `op` is evaluated, in the register allocated to it or pushed on the stack
+static void emit_save_operand(CgenEnv &env, const ASTNode *op, int index = 0) {
+    Register reg = env.RegisterOf(op, index);
+    if (reg) {
+        env.code.Move(reg, ACC);
+    } else {
+        env.code.Sw(ACC, 0, SP);
+        env.code.Addiu(SP, SP, -4);
+    }
+}
+
+
+// Retrieve the value held by emit_save_operand into dest, or return the register holding it when
+// dest is not given
+static Register emit_restore_operand(CgenEnv &env, const ASTNode *op, int index = 0,
+                                     Register dest = kNullRegister) {
+    Register reg = env.RegisterOf(op, index);
+    if (reg) {
+        if (dest) {
+            env.code.Move(dest, reg);
+            return dest;
         }
+        return reg;
+    }
+    dest = dest ? dest : T1;
+    env.code.Lw(dest, 4, SP);
+    env.code.Addiu(SP, SP, 4);
+    return dest;
+}
 
-        epilogue_init(os); // callee epilogue
-    } // end for
-} // end CgenKlassTable::CgenObjInit(std::ostream &os) const
+
+// Evaluate the arguments of a call in order, they are pushed except those passed in registers
+// (-a) that are held in an allocated register (see Dispatch::CollectIntervals)
+static void CodeGenActuals(const ASTNode *dispatch, Expressions *actuals, CgenEnv &env) {
+    for (std::size_t i = 0; i < actuals->size(); i++) {
+        actuals->at(i)->CodeGen(env);
+        emit_save_operand(env, dispatch, i);
+    }
+}
+
+
+// Load the last num_reg of the arguments saved by CodeGenActuals into the argument registers
+// (-a). The registers are only loaded once all arguments and the receiver are evaluated, which may
+// make calls, and the peephole optimizer turns the pushes and pops into moves where nothing comes
+// in between.
+static void emit_load_reg_args(CgenEnv &env, const ASTNode *dispatch, int num_arg, int num_reg) {
+    for (int i = num_arg - 1; i >= num_arg - num_reg; i--) {
+        emit_restore_operand(env, dispatch, i, arg_registers[i - (num_arg - num_reg)]);
+    }
+}
 
 
-// Code generation for all class attributes and methods
-void CgenKlassTable::CgenMethBody(std::ostream &os) {
+// Evaluate a Bool predicate and branch to a new label if it is false. Returns the label, which the
+// caller has to define.
+static int CgenPredicate(Expression *pred, CgenEnv &env) {
+    int false_label;
+    if (cgen_optimize) {
+        false_label = env.code.NewLabel();
+        pred->CodeGenBranch(env, false_label, false);
+    } else {
+        pred->CodeGen(env);
+        // Load the value of the evaluated boolean (at offset 12)
+        env.code.Lw(T1, 12, ACC);
+        false_label = env.code.NewLabel();
+        env.code.Beqz(T1, false_label);
+    }
+    return false_label;
+}
+
+
+// Number of units lowered before they are printed, bounds the memory held by the lowered code while
+// leaving enough units to balance the threads
+static const std::size_t kCgenBatchSize = 4096;
+
+// Lower all object initializers and methods on multiple threads, and print them in order
+void CgenKlassTable::CgenUnits(std::ostream &os) {
+    std::vector<CgenUnit> units;
+    for (auto node : nodes_) {
+        units.emplace_back(node, nullptr);
+    }
     for (auto node : nodes_) {
         for (auto feature : *node->klass()->features()) {
-            // Generate code only for method bodies
-            // Do nothing for an attribute
-            if (feature->attr()) {continue; }
+            // Bypass the attributes and all the internally defined methods
+            if (feature->attr() || method_is_predefined(node->name(), feature->name())) {continue; }
+            units.emplace_back(node, (Method *)feature);
+        }
+    }
 
-            Method *meth = (Method *)feature;
+    int num_label = 0;
+    std::size_t num_dispatch = 0, num_devirtualized = 0;
+    PeepholeOptimizer peephole;
+    for (std::size_t begin = 0; begin < units.size(); begin += kCgenBatchSize) {
+        std::size_t end = std::min(begin + kCgenBatchSize, units.size());
+        ParallelFor(end - begin, [&](std::size_t i) {
+            CgenUnit &unit = units[begin + i];
+            if (unit.meth) {
+                CgenMethBody(unit);
+            } else {
+                CgenObjInit(unit);
+            }
+        });
 
-            // Bypass all the internally defined methods
-            if (method_is_predefined(node->name(), meth->name())) {continue; }
-
-            // Count number of words we need to store temporals
-            int max_temp = 0;
-            meth->CountTemporal(num_temp, max_temp);
-
-            // Enter a temporary scope for method arguments
-            node->etable_var_.EnterScope();
-
-            // Create a new VarBindings in the new scope for each method arg
-            // Calculate the offset of each argument relative to framepointer
-            // offset of 1st arg: 8 + 4 * num_arg + 4 * max_temp
-            // offset of 2nd arg: 8 + 4 * (num_arg - 1) + 4 * max_temp
-            // ...
-            // offset of the last arg: 12 + 4 * max_temp
-            int arg_offset = 8 + 4 * meth->formals()->size() + 4 * max_temp;
-            for (auto formal : *meth->formals()) {
-                VarBinding *vb = new VarBinding();
-                vb->class_name_ = node->name();
-                vb->var_name_ = formal->name();
-                vb->decl_type_ = formal->decl_type();
-                vb->origin_ = ARG;
-                vb->offset_ = arg_offset;
-                arg_offset -= 4;
-                node->etable_var_.AddToScope(formal->name(), vb);
+        // Number the labels as if the units were lowered one after another
+        std::vector<int> label_base(end - begin);
+        for (std::size_t i = begin; i < end; i++) {
+            label_base[i - begin] = num_label;
+            num_label += units[i].code.num_labels();
+        }
+        ParallelFor(end - begin, [&](std::size_t i) {
+            CgenUnit &unit = units[begin + i];
+            unit.code.RebaseLabels(label_base[i]);
+            std::ostringstream text;
+            text << unit.code;
+            unit.text = text.str();
+            unit.code = MipsCode();
+        });
+
+        for (std::size_t i = begin; i < end; i++) {
+            os << units[i].text;
+            units[i].text = std::string();
+            num_dispatch += units[i].num_dispatch;
+            num_devirtualized += units[i].num_devirtualized;
+            peephole.Merge(units[i].peephole);
+        }
+    }
+
+    if (cgen_optimize) {
+        spdlog::info("Devirtualized {} of {} dynamic dispatch sites", num_devirtualized, num_dispatch);
+        for (std::size_t i = 0; i < kNumPeepholeRules; i++) {
+            auto rule = static_cast<PeepholeRule>(i);
+            spdlog::info("Peephole rule {} rewrote {} times", PeepholeOptimizer::RuleName(rule), peephole.hits(rule));
+        }
+    }
+} // end CgenKlassTable::CgenUnits(std::ostream &os)
+
+
+// Lower the object initializer of a class
+void CgenKlassTable::CgenObjInit(CgenUnit &unit) {
+    CgenNode *node = unit.node;
+    MipsCode &code = unit.code;
+    code.Label(init_label(node->name()));
+    std::size_t frame_begin = code.instrs().size();
+    prologue(code, 0); // callee prologue
+    std::size_t body_begin = code.instrs().size();
+
+    // initialze parent object, unless there is nothing to initialize (-O)
+    if (node->parent()->name() != No_class && !(cgen_optimize && init_is_empty(node->parent()))) {
+        code.Jal(init_label(node->parent()->name()));
+    }
+
+    // Create Cgen for a specific class
+    CgenEnv envnow(this, unit);
+
+    // If an attribute is initialized, we need to store the value in the stackframe
+    for (auto feature : *node->klass()->features()) {
+        // Do nothing for a method
+        if (feature->method()) {continue; }
+
+        Attr *attr = (Attr *)feature;
+        // Do nothing if an attribute is not initialized
+        if (!attr->init()->IsCode()) {continue; }
+
+        // Count how many temporals we need for attribute init
+        int num_temp = 0, max_temp = 0;
+        attr->init()->CountTemporal(num_temp, max_temp);
+        // Fake prologue that leaves space for temporals
+        std::size_t init_frame = code.instrs().size();
+        prologue_weird(code, max_temp);
+        std::size_t init_begin = code.instrs().size();
+        // Codegen for the initialized value
+        attr->init()->CodeGen(envnow);
+        if (cgen_optimize && !code_mentions(code, init_begin, FP)) {
+            // The value needs no temporals, remove the fake prologue
+            code.instrs().erase(code.instrs().begin() + init_frame,
+                                code.instrs().begin() + init_begin);
+        } else {
+            // Fake epilogue that restores the stack
+            epilogue_weird(code, max_temp);
+        }
+        // Store the value at the correct offset
+        code.Sw(ACC, node->etable_var_.Lookup(feature->name())->offset_, SELF);
+    }
+
+    bool uses_self;
+    if (cgen_optimize && elide_frame(code, frame_begin, body_begin, 0, uses_self)) {
+        // Leaf initializer, self is returned in the accumulator
+        if (uses_self) {
+            code.Move(ACC, T3);
+        }
+        epilogue_leaf(code, 0);
+    } else {
+        epilogue_init(code); // callee epilogue
+    }
+    if (cgen_optimize) {
+        unit.peephole.Run(code);
+    }
+} // end CgenKlassTable::CgenObjInit(CgenUnit &unit)
+
+
+// Lower a method body
+void CgenKlassTable::CgenMethBody(CgenUnit &unit) {
+    CgenNode *node = unit.node;
+    Method *meth = unit.meth;
+
+    // Create Cgen environment for the method, which is lowered into its own code
+    MipsCode &code = unit.code;
+    CgenEnv envnow(this, unit);
+
+    // Count number of words we need to store temporals
+    int num_temp = 0, max_temp = 0;
+    meth->CountTemporal(num_temp, max_temp);
+
+    // Allocate registers for the method, the callee-saved registers it uses are saved in
+    // additional temporals
+    // A register is worth it when it saves more than saving and restoring it costs
+    RegisterAllocator regs({S1, S2, S3, S4, S5, S6}, 3);
+    if (cgen_regalloc()) {
+        LiveIntervals intervals(envnow, regs);
+        meth->CollectIntervals(intervals);
+        regs.Allocate();
+        envnow.regs = &regs;
+    }
+    int saved_base = max_temp;
+    max_temp += regs.used().size();
+
+    // The last arguments are passed in registers (-a), those not allocated a register are
+    // saved in additional temporals
+    int num_arg = meth->formals()->size();
+    int num_stack_arg = num_arg - num_reg_args(num_arg);
+    std::vector<std::pair<int, Register>> reg_arg_slots;
+    int arg_index = 0;
+    for (auto formal : *meth->formals()) {
+        if (arg_index >= num_stack_arg && !envnow.RegisterOf(formal)) {
+            max_temp++;
+            reg_arg_slots.emplace_back(8 + 4 * max_temp, arg_registers[arg_index - num_stack_arg]);
+        }
+        arg_index++;
+    }
+
+    // Find the variables that never hold void, their dispatches need no void check
+    NonVoidVars non_void(envnow);
+    if (cgen_optimize) {
+        do {
+            non_void.changed = false;
+            meth->CollectNonVoid(non_void);
+        } while (non_void.changed);
+        envnow.non_void = &non_void;
+    }
+
+    // Enter a temporary scope for method arguments
+    envnow.etable_local.EnterScope();
+
+    // Create a new VarBindings in the new scope for each method arg
+    // Calculate the offset of each argument relative to framepointer
+    // offset of 1st arg: 8 + 4 * num_arg + 4 * max_temp
+    // offset of 2nd arg: 8 + 4 * (num_arg - 1) + 4 * max_temp
+    // ...
+    // offset of the last arg: 12 + 4 * max_temp
+    // where num_arg only counts the arguments on the stack
+    int arg_offset = 8 + 4 * num_stack_arg + 4 * max_temp;
+    auto reg_arg_slot = reg_arg_slots.begin();
+    arg_index = 0;
+    for (auto formal : *meth->formals()) {
+        VarBinding *vb = new VarBinding();
+        vb->class_name_ = node->name();
+        vb->var_name_ = formal->name();
+        vb->decl_type_ = formal->decl_type();
+        vb->origin_ = ARG;
+        vb->reg_ = envnow.RegisterOf(formal);
+        if (arg_index < num_stack_arg) {
+            vb->offset_ = arg_offset;
+            arg_offset -= 4;
+        } else if (!vb->reg_) {
+            vb->offset_ = (reg_arg_slot++)->first;
+        }
+        envnow.etable_local.AddToScope(formal->name(), vb);
+        arg_index++;
+    }
+
+    // title label
+    code.Label(method_label(node->name(), meth->name()));
+    std::size_t frame_begin = code.instrs().size();
+
+    // Prologue
+    prologue(code, max_temp);
+    // Save the callee-saved registers, and load the arguments that live in registers
+    for (std::size_t i = 0; i < regs.used().size(); i++) {
+        int offset = 8 + 4 * (saved_base + i + 1);
+        code.Sw(regs.used()[i], offset, FP);
+    }
+    arg_index = 0;
+    for (auto formal : *meth->formals()) {
+        VarBinding *vb = envnow.etable_local.Lookup(formal->name());
+        if (arg_index >= num_stack_arg) {
+            Register arg_reg = arg_registers[arg_index - num_stack_arg];
+            if (vb->reg_) {
+                code.Move(vb->reg_, arg_reg);
+            } else {
+                code.Sw(arg_reg, vb->offset_, FP);
             }
+        } else if (vb->reg_) {
+            code.Lw(vb->reg_, vb->offset_, FP);
+        }
+        arg_index++;
+    }
+
+    std::size_t body_begin = code.instrs().size();
+    meth->body_->CodeGen(envnow);
+
+    if (!reg_arg_slots.empty()) {
+        keep_reg_args(code, frame_begin, body_begin, reg_arg_slots);
+    }
+    bool uses_self;
+    if (cgen_optimize && regs.used().empty() &&
+        elide_frame(code, frame_begin, body_begin, max_temp, uses_self)) {
+        // Leaf method
+        epilogue_leaf(code, num_stack_arg);
+    } else {
+        // Restore the callee-saved registers
+        for (std::size_t i = 0; i < regs.used().size(); i++) {
+            int offset = 8 + 4 * (saved_base + i + 1);
+            code.Lw(regs.used()[i], offset, FP);
+        }
+        // epilogue
+        epilogue_general(code, num_stack_arg, max_temp);
+    }
+
+    // Exit the temporary scope for method args
+    envnow.etable_local.ExitScope();
+
+    if (cgen_optimize) {
+        unit.peephole.Run(code);
+    }
+} // end CgenKlassTable::CgenMethBody(CgenUnit &unit)
+
+std::string CgenKlassTable::AbortStub(const char *abort, const StringEntry *filename) {
+    std::string label = std::string(abort) + "_" + STRCONST_PREFIX + std::to_string(filename->id());
+    std::lock_guard<std::mutex> lock(abort_stubs_mutex_);
+    abort_stubs_.emplace(label, std::make_pair(abort, filename));
+    return label;
+}
+
 
-            // Create Cgen environment for a specific class
-            CgenEnv envnow(this, node, os);
+void CgenKlassTable::CgenAbortStubs(std::ostream &os) const {
+    MipsCode code;
+    for (auto &stub : abort_stubs_) {
+        code.Label(stub.first);
+        code.La(ACC, CgenRef(stub.second.second));
+        code.J(stub.second.first);
+    }
+    os << code;
+}
 
-            // title label
-            os << node->name() << "." << meth->name() << LABEL;
 
-            // Prologue
-            prologue(os, max_temp);
+// The predefined methods take all their arguments on the stack, their thunks push the arguments
+// passed in registers and jump to the method, which returns to the caller
+void CgenKlassTable::CgenThunks(std::ostream &os) const {
+    MipsCode code;
+    for (auto node : nodes_) {
+        for (auto feature : *node->klass()->features()) {
+            if (feature->attr() || !method_is_predefined(node->name(), feature->name())) {continue; }
+
+            int num_arg = ((Method *)feature)->formals()->size();
+            int num_reg = num_reg_args(num_arg);
+            if (num_reg == 0) {continue; }
+            code.Label(call_label(node->name(), feature->name(), num_arg));
+            for (int i = 0; i < num_reg; i++) {
+                code.Sw(arg_registers[i], 0, SP);
+                code.Addiu(SP, SP, -4);
+            }
+            code.J(method_label(node->name(), feature->name()));
+        }
+    }
+    os << code;
+}
 
-            meth->body_->CodeGen(envnow);
 
-            // epilogue
-            epilogue_general(os, node->etable_meth_[meth->name()]->num_arg_, max_temp);
+void Expression::CodeGenUnboxed(CgenEnv &env) {
+    CodeGen(env);
+    env.code.Lw(ACC, 12, ACC);
+}
+
 
-            // Exit the temporary scope for method args
-            node->etable_var_.ExitScope();
+void Expression::CodeGenBranch(CgenEnv &env, int label, bool branch_if) {
+    Register value;
+    if (cgen_unbox()) {
+        CodeGenUnboxed(env);
+        value = ACC;
+    } else {
+        CodeGen(env);
+        env.code.Lw(T1, 12, ACC);
+        value = T1;
+    }
+
+    if (branch_if) {
+        env.code.Bne(value, ZERO, label);
+    } else {
+        env.code.Beqz(value, label);
+    }
+}
 
-        } // end for feature
-    } // end for node
-} // end CgenKlassTable::CgenMethBody(std::ostream &os) const
 
 void NoExpr::CodeGen(CgenEnv &env) {}
 
 
 void IntLiteral::CodeGen(CgenEnv &env) {
-    env.os << LA << ACC << " ";
-    CgenRef(env.os, gIntTable.emplace(value()));
-    env.os << std::endl;
+    env.code.La(ACC, CgenRef(gIntTable.lookup(value())));
+}
+
+
+void IntLiteral::CodeGenUnboxed(CgenEnv &env) {
+    env.code.Li(ACC, value());
 }
 
 
 void StringLiteral::CodeGen(CgenEnv &env) {
-    env.os << LA << ACC << " ";
-    CgenRef(env.os, gStringTable.emplace(value()));
-    env.os << std::endl;
+    env.code.La(ACC, CgenRef(gStringTable.lookup(value())));
 }
 
 
 void BoolLiteral::CodeGen(CgenEnv &env) {
-    env.os << LA << ACC << " ";
-    CgenRef(env.os, value());
-    env.os << std::endl;
+    env.code.La(ACC, CgenRef(value()));
+}
+
+
+void BoolLiteral::CodeGenUnboxed(CgenEnv &env) {
+    env.code.Li(ACC, value() ? 1 : 0);
+}
+
+
+void BoolLiteral::CodeGenBranch(CgenEnv &env, int label, bool branch_if) {
+    if (value() == branch_if) {
+        env.code.B(label, MipsSpacing::kTabSpace);
+    }
+}
+
+
+int Dispatch::NumRegArgs(const CgenEnv &env) const {
+    CgenNode *receiver_cgen_node = receiver_->type() == SELF_TYPE
+        ? env.curr_cgen_node : env.klass_table->ClassFind(receiver_->type());
+    const MethBinding *mb =
+        cgen_optimize ? env.klass_table->MonomorphicMeth(receiver_cgen_node, name_) : NULL;
+    return mb && method_is_predefined(mb->class_name_, name_) ? 0 : num_reg_args(actuals_->size());
 }
 
 
 void Dispatch::CodeGen(CgenEnv &env) {
     CgenNode *receiver_cgen_node;
 
-    // Evaluate each argument and push it into current stackframe
-    for (auto actual : *actuals_) {
-        actual->CodeGen(env);
-        env.os << SW << ACC << " 0(" << SP << ")\n";
-        env.os << ADDIU << SP << " " << SP << " -4\n";
-    }
+    // Evaluate each argument and push it into current stackframe, or hold it in a register (-a)
+    CodeGenActuals(this, actuals_, env);
 
     receiver_->CodeGen(env);
 
@@ -1125,218 +2191,277 @@ void Dispatch::CodeGen(CgenEnv &env) {
         receiver_cgen_node = env.klass_table->ClassFind(receiver_->type());
     }
 
-    // Check whether the receiver object is NULL, and then branch
-    env.os << BNE << ACC << " " << ZERO << " label" << num_label << "\n";
+    // No subclass of the static receiver class overrides the method, call it directly. A
+    // predefined method is then called with all its arguments on the stack, without its thunk.
+    const MethBinding *mb = cgen_optimize ? env.klass_table->MonomorphicMeth(receiver_cgen_node, name_) : NULL;
+    emit_load_reg_args(env, this, actuals_->size(), NumRegArgs(env));
 
-    // Abort if receiver is NULL
-    // Load filename into ACC
-    env.os << LA << ACC << " ";
-    CgenRef(env.os, gStringTable.lookup(env.curr_cgen_node->filename()->value()));
-    env.os << "\n";
-    // Load line number into T1
-    env.os << LI << T1 << " " << loc() << "\n";
-    // Abort
-    emit_dispatch_abort(env.os);
+    // Check whether the receiver object is NULL, and then branch, unless it is never void
+    if (!(cgen_optimize && receiver_->NonVoid(env))) {
+        // Abort if receiver is NULL
+        int label = env.code.NewLabel();
+        emit_void_check(env, label, loc(), "_dispatch_abort");
+
+        // Jump
+        env.code.Label(label);
+    }
+
+    env.unit.num_dispatch++;
+    if (mb) {
+        env.unit.num_devirtualized++;
+        env.code.Jal(method_label(mb->class_name_, name_));
+        return;
+    }
 
-    // Jump
-    env.os << "label" << num_label << LABEL;
-    num_label++;
     // Load the dispatch pointer into $t1
-    env.os << LW << T1 << " 8(" << ACC << ")\n";
+    env.code.Lw(T1, 8, ACC);
     // Find the offset of the method and load into $t1
-    env.os << LW << T1 << " " << receiver_cgen_node->etable_meth_[name_]->offset_ << "(" << T1 << ")\n";
+    env.code.Lw(T1, receiver_cgen_node->etable_meth_.Lookup(name_)->offset_, T1);
     // execute dispatch
-    env.os << JALR << T1 << "\n";
+    env.code.Jalr(T1);
 
 } // end void Dispatch::CodeGen(CgenEnv &env)
 
 
+int StaticDispatch::NumRegArgs(const CgenEnv &env) const {
+    const MethBinding *mb = env.klass_table->ClassFind(dispatch_type_)->etable_meth_.Lookup(name_);
+    return method_is_predefined(mb->class_name_, name_) ? 0 : num_reg_args(actuals_->size());
+}
+
+
 void StaticDispatch::CodeGen(CgenEnv &env) {
     CgenNode *dispatch_cgen_node;
 
-    // Evaluate each argument and push it into current stackframe
-    for (auto actual : *actuals_) {
-        actual->CodeGen(env);
-        env.os << SW << ACC << " 0(" << SP << ")\n";
-        env.os << ADDIU << SP << " " << SP << " -4\n";
-    }
+    // Evaluate each argument and push it into current stackframe, or hold it in a register (-a)
+    CodeGenActuals(this, actuals_, env);
 
     // Evaluate the receiver object and load it into accumulator
     receiver_->CodeGen(env);
 
     dispatch_cgen_node = env.klass_table->ClassFind(dispatch_type_);
 
-    // Check whether the receiver object is NULL, and then branch
-    env.os << BNE << ACC << " " << ZERO << " label" << num_label << "\n";
+    // A predefined method is called directly with all its arguments on the stack, without its thunk
+    const MethBinding *mb = dispatch_cgen_node->etable_meth_.Lookup(name_);
+    bool stack_args = num_reg_args(mb->num_arg_) > 0 && method_is_predefined(mb->class_name_, name_);
+    emit_load_reg_args(env, this, actuals_->size(), NumRegArgs(env));
 
-    // Abort if receiver is NULL
-    // Load filename into ACC
-    env.os << LA << ACC << " ";
-    CgenRef(env.os, gStringTable.lookup(env.curr_cgen_node->filename()->value()));
-    env.os << "\n";
-    // Load line number into T1
-    env.os << LI << T1 << " " << loc() << "\n";
-    // Abort
-    emit_dispatch_abort(env.os);
+    // Check whether the receiver object is NULL, and then branch, unless it is never void
+    if (!(cgen_optimize && receiver_->NonVoid(env))) {
+        // Abort if receiver is NULL
+        int label = env.code.NewLabel();
+        emit_void_check(env, label, loc(), "_dispatch_abort");
 
-    // Jump
-    env.os << "label" << num_label << LABEL;
-    num_label++;
+        // Jump
+        env.code.Label(label);
+    }
+    if (stack_args) {
+        env.code.Jal(method_label(mb->class_name_, name_));
+        return;
+    }
     // Load the dispatch pointer into $t1
-    env.os << LA << T1 << " " << dispatch_type_ << DISPTAB_SUFFIX << "\n";
+    env.code.La(T1, disptable_label(dispatch_type_));
     // Find the offset of the method and load into $t1
-    env.os << LW << T1 << " " << dispatch_cgen_node->etable_meth_[name_]->offset_ << "(" << T1 << ")\n";
+    env.code.Lw(T1, mb->offset_, T1);
     // execute dispatch
-    env.os << JALR << T1 << "\n";
+    env.code.Jalr(T1);
 }
 
 
 void Ref::CodeGen(CgenEnv &env) {
     // if ID is the "self" key word
     if (name_ == self) {
-        env.os << MOVE << ACC << " " << SELF << "\n";
+        env.code.Move(ACC, SELF);
     }
     // if ID is anything else
     else {
-        VarBinding *target = env.curr_cgen_node->etable_var_.Lookup(name_);
-        int origin  = target->origin_;
-        int offset = target->offset_;
+        VarBinding *target = env.LookupVar(name_);
+        target->EmitLoad(env.code);
 
-        switch (origin) {
-            case ATTR:
-                env.os << LW << ACC << " " << offset << "(" << SELF << ")\n";
-                break;
-            case ARG:
-                env.os << LW << ACC << " " << offset << "(" << FP << ")\n";
-                break;
-            default:
-                break;
-        } // end switch
+        // An unboxed temporary escapes, box it
+        if (target->unboxed_) {
+            emit_box(env.code, target->decl_type_);
+        }
     } // end else
 
 } // end void Ref::CodeGen(CgenEnv &env)
 
 
+Register Ref::UnboxedRegister(CgenEnv &env) {
+    VarBinding *target = name_ == self ? nullptr : env.LookupVar(name_);
+    return target && target->unboxed_ ? target->reg_ : kNullRegister;
+}
+
+
+void Ref::CodeGenUnboxed(CgenEnv &env) {
+    VarBinding *target = name_ == self ? nullptr : env.LookupVar(name_);
+    if (target && target->unboxed_) {
+        target->EmitLoad(env.code);
+    } else {
+        Expression::CodeGenUnboxed(env);
+    }
+}
+
+
 void Block::CodeGen(CgenEnv &env) {
     for (auto expr : *body_) {
-        expr->CodeGen(env);
+        if (expr == body_->back()) {
+            expr->CodeGen(env);
+        } else {
+            CodeGenDiscarded(expr, env);
+        }
     }
 } // end void Block::CodeGen(CgenEnv &env)
 
 
+void Block::CodeGenUnboxed(CgenEnv &env) {
+    for (auto expr : *body_) {
+        if (expr == body_->back()) {
+            expr->CodeGenUnboxed(env);
+        } else {
+            CodeGenDiscarded(expr, env);
+        }
+    }
+}
+
+
+void Block::CodeGenBranch(CgenEnv &env, int label, bool branch_if) {
+    for (auto expr : *body_) {
+        if (expr == body_->back()) {
+            expr->CodeGenBranch(env, label, branch_if);
+        } else {
+            CodeGenDiscarded(expr, env);
+        }
+    }
+}
+
+
 void Knew::CodeGen(CgenEnv &env) {
     if (name_ == SELF_TYPE) {
         // Load the pointer to Object Table into $t1
-        env.os << LA << T1 << " " << CLASSOBJTAB << "\n";
+        env.code.La(T1, CLASSOBJTAB);
         // Load the tag of the class (referred to by self) into $t2
         // Tag is at offset 0 of prototype object
-        env.os << LW << T2 << " 0(" << SELF << ")\n";
+        env.code.Lw(T2, 0, SELF);
         // In class Object Table, the offset of a prototype object pointer
         // = 8 * tag_number
         // Increament $t1 by this number, so that $t1 points to the prototype object we want
-        env.os << SLL << T2 << " " << T2 << " 3\n";
-        env.os << ADD << T1 << " " << T1 << " " << T2 << "\n";
+        env.code.Sll(T2, T2, 3);
+        env.code.Add(T1, T1, T2);
         // Push the address of prototype object we want temporarily onto Stack
-        env.os << SW << T1 << " 0(" << SP << ")\n";
-        env.os << ADDIU << SP << " " << SP << " -4\n";
+        env.code.Sw(T1, 0, SP);
+        env.code.Addiu(SP, SP, -4);
         // Load the tag value of the prototype object into ACC (at offset 0)
         // Prepare for copying and creating new object
-        env.os << LW << ACC << " 0(" << T1 << ")\n";
+        env.code.Lw(ACC, 0, T1);
         // Copy and create new object
-        env.os << JAL << "Object.copy\n";
+        env.code.Jal("Object.copy");
         // Load the pointer to the prototype object into $t1
-        env.os << LW << T1 << " 4(" << SP << ")\n";
+        env.code.Lw(T1, 4, SP);
         // Load the pointer to object initializer (offset 4) into t1
         // !! I don't buy this
-        env.os << LW << T1 << " 4(" << T1 << ")\n";
+        env.code.Lw(T1, 4, T1);
         // Jump to init
-        env.os << JALR << T1 << "\n";
+        env.code.Jalr(T1);
 
         // Pop the temporary from the stack
-        env.os << ADDIU << SP << " " << SP << " 4\n";
+        env.code.Addiu(SP, SP, 4);
     } else {
         // Load the prototype object into accumulator
-        env.os << LA << ACC << " " << name_ << PROTOBJ_SUFFIX << "\n";
+        env.code.La(ACC, protobj_label(name_));
         // Copy Object
-        env.os << JAL << "Object.copy\n";
+        env.code.Jal("Object.copy");
         // Init itself
-        env.os << JAL << name_ << CLASSINIT_SUFFIX << "\n";
+        env.code.Jal(init_label(name_));
     }
 } // end void Knew::CodeGen(CgenEnv &env)
 
 
 void Assign::CodeGen(CgenEnv &env) {
+    VarBinding *target = env.LookupVar(name_);
+
+    // Store the raw value into an unboxed temporary, the value of the assignment escapes
+    if (target->unboxed_) {
+        CodeGenUnboxed(env);
+        emit_box(env.code, target->decl_type_);
+        return;
+    }
+
     value_->CodeGen(env);
+    target->EmitStore(env.code);
+} // end void Assign::CodeGen(CgenEnv &env)
 
-    VarBinding *target = env.curr_cgen_node->etable_var_.Lookup(name_);
-    int origin  = target->origin_;
-    int offset = target->offset_;
 
-    switch (origin) {
-        case ATTR:
-            env.os << SW << ACC << " " << offset << "(" << SELF << ")\n";
-            break;
-        case ARG:
-            env.os << SW << ACC << " " << offset << "(" << FP << ")\n";
-            break;
-        default:
-            break;
+void Assign::CodeGenUnboxed(CgenEnv &env) {
+    VarBinding *target = env.LookupVar(name_);
+    if (target->unboxed_) {
+        value_->CodeGenUnboxed(env);
+        target->EmitStore(env.code);
+    } else {
+        Expression::CodeGenUnboxed(env);
     }
-} // end void Assign::CodeGen(CgenEnv &env)
+}
 
 
 void UnaryOperator::CodeGen(CgenEnv &env) {
+    // Compute the raw value and box the result only once
+    if (cgen_unbox() && kind_ != UO_IsVoid) {
+        CodeGenUnboxed(env);
+        emit_box(env.code, type());
+        return;
+    }
+
     int merge_label;
     input_->CodeGen(env);
 
     switch (kind_) {
         case UO_Neg:
+            // Look up the result in the Int cache first (see BinaryOperator::CodeGen)
+            merge_label = kNoLabel;
+            if (cgen_int_cache()) {
+                merge_label = env.code.NewLabel();
+                env.code.Lw(T1, 12, ACC);
+                env.code.Neg(T1, T1);
+                emit_int_cache_lookup(env.code, T1, merge_label);
+            }
             // copy object
-            env.os << JAL << "Object.copy\n";
+            env.code.Jal("Object.copy");
             // load actual value in $t1
-            env.os << LW << T1 << " 12(" << ACC << ")\n";
+            env.code.Lw(T1, 12, ACC);
             // negate $t1
-            env.os << NEG << T1 << " " << T1 << "\n";
+            env.code.Neg(T1, T1);
             // store the new $t1 as the actual value
-            env.os << SW << T1 << " 12(" << ACC << ")\n";
+            env.code.Sw(T1, 12, ACC);
+            if (cgen_int_cache()) {
+                env.code.Label(merge_label);
+            }
             break;
 
         case UO_Not:
-            merge_label = num_label;
-            num_label++;
+            merge_label = env.code.NewLabel();
             // load actual value in $t1
-            env.os << LW << T1 << " 12(" << ACC << ")\n";
+            env.code.Lw(T1, 12, ACC);
             // Assume true
-            env.os << LA << ACC << " ";
-            CgenRef(env.os, true);
-            env.os << "\n";
+            env.code.La(ACC, CgenRef(true));
             // check the actual value
-            env.os << BEQZ << T1 << " label" << merge_label << "\n";
+            env.code.Beqz(T1, merge_label);
             // Set to false
-            env.os << LA << ACC << " ";
-            CgenRef(env.os, false);
-            env.os << "\n";
+            env.code.La(ACC, CgenRef(false));
             // Conclude with label
-            env.os << "label" << merge_label << LABEL;
+            env.code.Label(merge_label);
             break;
 
         case UO_IsVoid:
-            merge_label = num_label;
-            num_label++;
+            merge_label = env.code.NewLabel();
             // move result to $t1
-            env.os << MOVE << T1 << " " << ACC << "\n";
+            env.code.Move(T1, ACC);
             // Assume true
-            env.os << LA << ACC << " ";
-            CgenRef(env.os, true);
-            env.os << "\n";
+            env.code.La(ACC, CgenRef(true));
             // Check void
-            env.os << BEQZ << T1 << " label" << merge_label << "\n";
+            env.code.Beqz(T1, merge_label);
             // Set to false
-            env.os << LA << ACC << " ";
-            CgenRef(env.os, false);
-            env.os << "\n";
+            env.code.La(ACC, CgenRef(false));
             // Conclude with label
-            env.os << "label" << merge_label << LABEL;
+            env.code.Label(merge_label);
             break;
 
         default:
@@ -1345,210 +2470,409 @@ void UnaryOperator::CodeGen(CgenEnv &env) {
 } // end UnaryOperator::CodeGen(CgenEnv &env)
 
 
+void UnaryOperator::CodeGenUnboxed(CgenEnv &env) {
+    switch (kind_) {
+        case UO_Neg:
+            input_->CodeGenUnboxed(env);
+            env.code.Neg(ACC, ACC);
+            break;
+
+        case UO_Not:
+            input_->CodeGenUnboxed(env);
+            env.code.Xori(ACC, ACC, 1);
+            break;
+
+        case UO_IsVoid:
+            if (is_unboxable(input_->type())) {
+                // Int and Bool values are never void
+                input_->CodeGenUnboxed(env);
+                env.code.Li(ACC, 0);
+            } else {
+                input_->CodeGen(env);
+                env.code.Seq(ACC, ACC, ZERO);
+            }
+            break;
+
+        default:
+            break;
+    } // end switch
+}
+
+
+void UnaryOperator::CodeGenBranch(CgenEnv &env, int label, bool branch_if) {
+    switch (kind_) {
+        case UO_Not:
+            input_->CodeGenBranch(env, label, !branch_if);
+            break;
+
+        case UO_IsVoid:
+            if (is_unboxable(input_->type())) {
+                // Int and Bool values are never void
+                CodeGenDiscarded(input_, env);
+                if (!branch_if) {
+                    env.code.B(label, MipsSpacing::kTabSpace);
+                }
+            } else {
+                input_->CodeGen(env);
+                if (branch_if) {
+                    env.code.Beqz(ACC, label);
+                } else {
+                    env.code.Bne(ACC, ZERO, label);
+                }
+            }
+            break;
+
+        default:
+            Expression::CodeGenBranch(env, label, branch_if);
+            break;
+    } // end switch
+}
+
+
 void BinaryOperator::CodeGen(CgenEnv &env) {
+    // Compute the raw value and box the result only once. Equality on other types compares
+    // objects and keeps the generic path.
+    if (cgen_unbox() && (kind_ != BO_EQ || is_unboxable(lhs_->type()))) {
+        CodeGenUnboxed(env);
+        emit_box(env.code, type());
+        return;
+    }
+
     int merge_label;
     // eval lhs
     lhs_->CodeGen(env);
     // store the result of lhs temporarily on the stack
-    env.os << SW << ACC << " 0(" << SP << ")\n";
-    env.os << ADDIU << SP << " " << SP << " -4\n";
+    env.code.Sw(ACC, 0, SP);
+    env.code.Addiu(SP, SP, -4);
     // eval rhs
     rhs_->CodeGen(env);
 
+    // Compute an arithmetic result first to look it up in the Int cache, a new object is only copied
+    // on a miss. The raw value can not be kept across Object.copy, the collectors would see it.
+    int cached_label = kNoLabel;
+    bool cached = cgen_int_cache() && kind_ != BO_LT && kind_ != BO_LE && kind_ != BO_EQ;
+    if (cached) {
+        cached_label = env.code.NewLabel();
+        env.code.Lw(T1, 4, SP);
+        env.code.Lw(T1, 12, T1);
+        env.code.Lw(T2, 12, ACC);
+        MipsOp op = kind_ == BO_Add ? MipsOp::kAdd
+                  : kind_ == BO_Sub ? MipsOp::kSub
+                  : kind_ == BO_Mul ? MipsOp::kMul : MipsOp::kDiv;
+        env.code.Arith(op, T1, T1, T2);
+        emit_int_cache_lookup(env.code, T1, cached_label);
+    }
+
     switch (kind_) {
         // Plus
         case BO_Add:
             // Make a copy object that will store the new calculated result
-            env.os << JAL << "Object.copy\n";
+            env.code.Jal("Object.copy");
             // Load the reference of lhs into $t1
-            env.os << LW << T1 << " 4(" << SP << ")\n";
+            env.code.Lw(T1, 4, SP);
             // Load the actual value of lhs into $t1. The value is at offset 12
-            env.os << LW << T1 << " 12(" << T1 << ")\n";
+            env.code.Lw(T1, 12, T1);
             // Load the actual value of rhs into $t2.
-            env.os << LW << T2 << " 12(" << ACC << ")\n";
+            env.code.Lw(T2, 12, ACC);
             // perform addition
-            env.os << ADD << T1 << " " << T1 << " " << T2 << "\n";
+            env.code.Add(T1, T1, T2);
             // store the new result in the copied object, at offset 12
-            env.os << SW << T1 << " 12(" << ACC << ")\n";
+            env.code.Sw(T1, 12, ACC);
             break;
 
         // minus
         case BO_Sub:
             // Make a copy object that will store the new calculated result
-            env.os << JAL << "Object.copy\n";
+            env.code.Jal("Object.copy");
             // Load the reference of lhs into $t1
-            env.os << LW << T1 << " 4(" << SP << ")\n";
+            env.code.Lw(T1, 4, SP);
             // Load the actual value of lhs into $t1. The value is at offset 12
-            env.os << LW << T1 << " 12(" << T1 << ")\n";
+            env.code.Lw(T1, 12, T1);
             // Load the actual value of rhs into $t2.
-            env.os << LW << T2 << " 12(" << ACC << ")\n";
+            env.code.Lw(T2, 12, ACC);
             // perform subtraction
-            env.os << SUB << T1 << " " << T1 << " " << T2 << "\n";
+            env.code.Sub(T1, T1, T2);
             // store the new result in the copied object, at offset 12
-            env.os << SW << T1 << " 12(" << ACC << ")\n";
+            env.code.Sw(T1, 12, ACC);
             break;
 
         // multiply
         case BO_Mul:
             // Make a copy object that will store the new calculated result
-            env.os << JAL << "Object.copy\n";
+            env.code.Jal("Object.copy");
             // Load the reference of lhs into $t1
-            env.os << LW << T1 << " 4(" << SP << ")\n";
+            env.code.Lw(T1, 4, SP);
             // Load the actual value of lhs into $t1. The value is at offset 12
-            env.os << LW << T1 << " 12(" << T1 << ")\n";
+            env.code.Lw(T1, 12, T1);
             // Load the actual value of rhs into $t2.
-            env.os << LW << T2 << " 12(" << ACC << ")\n";
+            env.code.Lw(T2, 12, ACC);
             // perform multiplication
-            env.os << MUL << T1 << " " << T1 << " " << T2 << "\n";
+            env.code.Mul(T1, T1, T2);
             // store the new result in the copied object, at offset 12
-            env.os << SW << T1 << " 12(" << ACC << ")\n";
+            env.code.Sw(T1, 12, ACC);
             break;
 
         // divide
         case BO_Div:
             // Make a copy object that will store the new calculated result
-            env.os << JAL << "Object.copy\n";
+            env.code.Jal("Object.copy");
             // Load the reference of lhs into $t1
-            env.os << LW << T1 << " 4(" << SP << ")\n";
+            env.code.Lw(T1, 4, SP);
             // Load the actual value of lhs into $t1. The value is at offset 12
-            env.os << LW << T1 << " 12(" << T1 << ")\n";
+            env.code.Lw(T1, 12, T1);
             // Load the actual value of rhs into $t2.
-            env.os << LW << T2 << " 12(" << ACC << ")\n";
+            env.code.Lw(T2, 12, ACC);
             // perform division
-            env.os << DIV << T1 << " " << T1 << " " << T2 << "\n";
+            env.code.Div(T1, T1, T2);
             // store the new result in the copied object, at offset 12
-            env.os << SW << T1 << " 12(" << ACC << ")\n";
+            env.code.Sw(T1, 12, ACC);
             break;
 
         // less than
         case BO_LT:
             // Load the reference of lhs into $t1
-            env.os << LW << T1 << " 4(" << SP << ")\n";
+            env.code.Lw(T1, 4, SP);
             // Load the actual value of lhs into $t1. The value is at offset 12
-            env.os << LW << T1 << " 12(" << T1 << ")\n";
+            env.code.Lw(T1, 12, T1);
             // Load the actual value of rhs into $t2.
-            env.os << LW << T2 << " 12(" << ACC << ")\n";
+            env.code.Lw(T2, 12, ACC);
             // Assume true
-            env.os << LA << ACC << " ";
-            CgenRef(env.os, true);
-            env.os << "\n";
+            env.code.La(ACC, CgenRef(true));
             // If really true, jump away
-            merge_label = num_label;
-            num_label++;
-            env.os << BLT << T1 << " " << T2 << " label" << merge_label << "\n";
+            merge_label = env.code.NewLabel();
+            env.code.Blt(T1, T2, merge_label);
             // Set the boolean to be false
-            env.os << LA << ACC << " ";
-            CgenRef(env.os, false);
-            env.os << "\n";
+            env.code.La(ACC, CgenRef(false));
             // Conclude with the merging label
-            env.os << "label" << merge_label << LABEL;
+            env.code.Label(merge_label);
             break;
 
         // less or equal to
         case BO_LE:
             // Load the reference of lhs into $t1
-            env.os << LW << T1 << " 4(" << SP << ")\n";
+            env.code.Lw(T1, 4, SP);
             // Load the actual value of lhs into $t1. The value is at offset 12
-            env.os << LW << T1 << " 12(" << T1 << ")\n";
+            env.code.Lw(T1, 12, T1);
             // Load the actual value of rhs into $t2.
-            env.os << LW << T2 << " 12(" << ACC << ")\n";
+            env.code.Lw(T2, 12, ACC);
             // Assume true
-            env.os << LA << ACC << " ";
-            CgenRef(env.os, true);
-            env.os << "\n";
+            env.code.La(ACC, CgenRef(true));
             // If really true, jump away
-            merge_label = num_label;
-            num_label++;
-            env.os << BLEQ << T1 << " " << T2 << " label" << merge_label << "\n";
+            merge_label = env.code.NewLabel();
+            env.code.Ble(T1, T2, merge_label);
             // Set the boolean to be false
-            env.os << LA << ACC << " ";
-            CgenRef(env.os, false);
-            env.os << "\n";
+            env.code.La(ACC, CgenRef(false));
             // Conclude with the merging label
-            env.os << "label" << merge_label << LABEL;
+            env.code.Label(merge_label);
             break;
 
         // equal to
         case BO_EQ:
             // Load the reference of lhs into $t1
-            env.os << LW << T1 << " 4(" << SP << ")\n";
+            env.code.Lw(T1, 4, SP);
             // Load the reference of rhs into $t2
-            env.os << MOVE << T2 << " " << ACC << "\n";
+            env.code.Move(T2, ACC);
             // Load the reference of "true" into $a0
-            env.os << LA << ACC << " ";
-            CgenRef(env.os, true);
-            env.os << "\n";
+            env.code.La(ACC, CgenRef(true));
             // jump if the pointers to lhs and rhs are equal
-            merge_label = num_label;
-            num_label++;
-            env.os << BEQ << T1 << " " << T2 << " label" << merge_label << "\n";
+            merge_label = env.code.NewLabel();
+            env.code.Beq(T1, T2, merge_label);
             // Load the reference of "false" into $a1
-            env.os << LA << A1 << " ";
-            CgenRef(env.os, false);
-            env.os << "\n";
+            env.code.La(A1, CgenRef(false));
             // Jump to equality test
             // There is some magic going on in equality_test
-            emit_equality_test(env.os);
+            emit_equality_test(env.code);
             // Conclude with the merge label
-            env.os << "label" << merge_label << LABEL;
+            env.code.Label(merge_label);
     } // end switch
 
+    if (cached) {
+        env.code.Label(cached_label);
+    }
     // Pop the lhs result off the stack
-    env.os << ADDIU << SP << " " << SP << " 4\n";
+    env.code.Addiu(SP, SP, 4);
 } // end void BinaryOperator::CodeGen(CgenEnv &env)
 
 
+void BinaryOperator::CodeGenUnboxed(CgenEnv &env) {
+    if (kind_ == BO_EQ && !is_unboxable(lhs_->type())) {
+        Expression::CodeGenUnboxed(env);
+        return;
+    }
+
+    Register lhs, rhs;
+    CodeGenOperands(env, lhs, rhs);
+
+    switch (kind_) {
+        case BO_Add:
+            env.code.Add(ACC, lhs, rhs);
+            break;
+        case BO_Sub:
+            env.code.Sub(ACC, lhs, rhs);
+            break;
+        case BO_Mul:
+            env.code.Mul(ACC, lhs, rhs);
+            break;
+        case BO_Div:
+            env.code.Div(ACC, lhs, rhs);
+            break;
+        case BO_LT:
+            env.code.Slt(ACC, lhs, rhs);
+            break;
+        case BO_LE:
+            env.code.Sle(ACC, lhs, rhs);
+            break;
+        case BO_EQ:
+            env.code.Seq(ACC, lhs, rhs);
+            break;
+    } // end switch
+}
+
+
+void BinaryOperator::CodeGenOperands(CgenEnv &env, Register &lhs, Register &rhs) {
+    // With the register allocator a pure rhs, which only writes ACC and cannot assign a variable,
+    // needs no copy of the lhs in memory. An operand already in a register is used in place.
+    if (cgen_regalloc() && rhs_->IsPure()) {
+        lhs = lhs_->UnboxedRegister(env);
+        if (!lhs) {
+            lhs_->CodeGenUnboxed(env);
+            lhs = ACC;
+        }
+        rhs = rhs_->UnboxedRegister(env);
+        if (!rhs) {
+            if (lhs == ACC) {
+                env.code.Move(T1, ACC);
+                lhs = T1;
+            }
+            rhs_->CodeGenUnboxed(env);
+            rhs = ACC;
+        }
+        return;
+    }
+
+    // eval lhs and hold its raw value while the rhs is evaluated
+    lhs_->CodeGenUnboxed(env);
+    emit_save_operand(env, this);
+    rhs_->CodeGenUnboxed(env);
+    lhs = emit_restore_operand(env, this);
+    rhs = ACC;
+}
+
+
+void BinaryOperator::CodeGenBranch(CgenEnv &env, int label, bool branch_if) {
+    // Only comparisons of Int and Bool values are fused with the branch
+    if (!(kind_ == BO_LT || kind_ == BO_LE || (kind_ == BO_EQ && is_unboxable(lhs_->type())))) {
+        Expression::CodeGenBranch(env, label, branch_if);
+        return;
+    }
+
+    // Leave the values of lhs and rhs in registers
+    Register lhs, rhs;
+    if (cgen_unbox()) {
+        CodeGenOperands(env, lhs, rhs);
+    } else {
+        lhs_->CodeGen(env);
+        emit_save_operand(env, this);
+        rhs_->CodeGen(env);
+        lhs = emit_restore_operand(env, this);
+        env.code.Lw(T1, 12, lhs);
+        env.code.Lw(ACC, 12, ACC);
+        lhs = T1;
+        rhs = ACC;
+    }
+
+    // Branch on the comparison, or on its negation
+    MipsOp branch;
+    switch (kind_) {
+        case BO_LT:
+            branch = branch_if ? MipsOp::kBlt : MipsOp::kBge;
+            break;
+        case BO_LE:
+            branch = branch_if ? MipsOp::kBle : MipsOp::kBgt;
+            break;
+        default:
+            branch = branch_if ? MipsOp::kBeq : MipsOp::kBne;
+            break;
+    }
+    env.code.Branch(branch, lhs, rhs, label);
+}
+
+
 void Cond::CodeGen(CgenEnv &env) {
-    pred_->CodeGen(env);
-    // Load the value of the evaluated boolean (at offset 12)
-    env.os << LW << T1 << " 12(" << ACC << ")\n";
     // If false, jump to a false label
-    int false_label = num_label;
-    env.os << BEQZ << T1 << " label" << false_label << "\n";
-    num_label++;
+    int false_label = CgenPredicate(pred_, env);
     // CodeGen for true
     then_branch_->CodeGen(env);
     // Merge into master flow
-    int merge_label = num_label;
-    env.os << BRANCH << " label" << merge_label << "\n";
-    num_label++;
+    int merge_label = env.code.NewLabel();
+    env.code.B(merge_label, MipsSpacing::kTabSpace);
     // CodeGen for flase
-    env.os << "label" << false_label << LABEL;
+    env.code.Label(false_label);
     else_branch_->CodeGen(env);
     // Conclude with a merge label
-    env.os << "label" << merge_label << LABEL;
+    env.code.Label(merge_label);
 } // end void Cond::CodeGen(CgenEnv &env)
 
 
+void Cond::CodeGenUnboxed(CgenEnv &env) {
+    int false_label = CgenPredicate(pred_, env);
+    then_branch_->CodeGenUnboxed(env);
+    int merge_label = env.code.NewLabel();
+    env.code.B(merge_label, MipsSpacing::kTabSpace);
+    env.code.Label(false_label);
+    else_branch_->CodeGenUnboxed(env);
+    env.code.Label(merge_label);
+}
+
+
 void Loop::CodeGen(CgenEnv &env) {
-    int loop_label = num_label;
-    num_label++;
-    env.os << "label" << loop_label << LABEL;
-    // evaluate predicate
-    pred_->CodeGen(env);
-    // Load the value of the evaluated boolean (at offset 12)
-    env.os << LW << T1 << " 12(" << ACC << ")\n";
-    // If false quit loop
-    int merge_label = num_label;
-    num_label++;
-    env.os << BEQZ << T1 << " label" << merge_label << "\n";
+    int loop_label = env.code.NewLabel();
+    env.code.Label(loop_label);
+    // evaluate predicate, if false quit loop
+    int merge_label = CgenPredicate(pred_, env);
     // Loop body
-    body_->CodeGen(env);
+    CodeGenDiscarded(body_, env);
     // To the next iteration
-    env.os << BRANCH << " label" << loop_label << "\n";
+    env.code.B(loop_label, MipsSpacing::kTabSpace);
     // Conclude with a merge label
-    env.os << "label" << merge_label << LABEL;
+    env.code.Label(merge_label);
+    // A fused predicate leaves a raw value behind, the value of a loop is void
+    if (cgen_optimize) {
+        env.code.Move(ACC, ZERO);
+    }
 } // end void Loop::CodeGen(CgenEnv &env)
 
 
 void Let::CodeGen(CgenEnv &env) {
+    CodeGenLet(env, false);
+}
+
+
+void Let::CodeGenUnboxed(CgenEnv &env) {
+    CodeGenLet(env, true);
+}
+
+
+void Let::CodeGenLet(CgenEnv &env, bool unboxed_body) {
+    // Int and Bool temporaries keep the raw value in their frame slot
+    bool unboxed = cgen_unbox() && is_unboxable(decl_type_);
+
     // evaluate initializer
-    init_->CodeGen(env);
+    if (unboxed) {
+        if (init_->IsCode()) {
+            init_->CodeGenUnboxed(env);
+        } else {
+            // 0 and false
+            env.code.Li(ACC, 0);
+        }
+    } else {
+        init_->CodeGen(env);
+    }
 
     // Enter scope
-    ScopedTable<Symbol *, VarBinding *> &curr_etable = env.curr_cgen_node->etable_var_;
+    FlatScopedTable<Symbol *, VarBinding *> &curr_etable = env.etable_local;
     curr_etable.EnterScope();
-    num_temp++;
+    env.num_temp++;
 
     // Create VarBinding for the temporal
     // offset is relative to fp
@@ -1558,75 +2882,66 @@ void Let::CodeGen(CgenEnv &env) {
     vb->var_name_ = name_;
     vb->decl_type_ = decl_type_;
     vb->origin_ = ARG;
-    vb->offset_ = 8 + 4 * num_temp;
+    vb->offset_ = 8 + 4 * env.num_temp;
+    vb->unboxed_ = unboxed;
+    vb->reg_ = env.RegisterOf(this);
+    vb->non_void_ = env.NonVoidVar(this);
     curr_etable.AddToScope(name_, vb);
 
     // Store the initialized value at the correct address
     // If no initialization, then store the default value of each type
-    if (!init_->IsCode()) {
+    if (!init_->IsCode() && !unboxed) {
         if (decl_type_ == Int) {
-            env.os << LA << ACC << " ";
-            CgenRef(env.os, gIntTable.lookup(0));
-            env.os << "\n";
+            env.code.La(ACC, CgenRef(gIntTable.lookup(0)));
         }
         else if (decl_type_ == String) {
-            env.os << LA << ACC << " ";
-            CgenRef(env.os, gStringTable.lookup(""));
-            env.os << "\n";
+            env.code.La(ACC, CgenRef(gStringTable.lookup("")));
         }
         else if (decl_type_ == Bool) {
-            env.os << LA << ACC << " ";
-            CgenRef(env.os, false);
-            env.os << "\n";
+            env.code.La(ACC, CgenRef(false));
         }
         else {
-            env.os << LI << ACC << " 0\n";
+            env.code.Li(ACC, 0);
         }
     }
-    env.os << SW << ACC << " " << vb->offset_ << "(" << FP << ")\n";
+    vb->EmitStore(env.code);
 
     // evaluate body
-    body_->CodeGen(env);
+    if (unboxed_body) {
+        body_->CodeGenUnboxed(env);
+    } else {
+        body_->CodeGen(env);
+    }
 
     // Exit scope
     curr_etable.ExitScope();
-    num_temp--;
-} // void Let::CodeGen(SemantEnv &env)
+    env.num_temp--;
+} // void Let::CodeGenLet(CgenEnv &env, bool unboxed_body)
 
 
 void Kase::CodeGen(CgenEnv &env) {
     // Sort branches by topological order
-    SortBranches(env);
+    std::vector<KaseBranch *> sorted_cases = SortBranches(env);
     // CodeGen for input
     input_->CodeGen(env);
 
     // The first branch label
     int merge_label;
     // handle case match on void
-    merge_label = num_label;
-    num_label++;
-    env.os << BNE << ACC << " " << ZERO << " label" << merge_label << "\n";
-    // Load filename into ACC
-    env.os << LA << ACC << " ";
-    CgenRef(env.os, gStringTable.lookup(env.curr_cgen_node->filename()->value()));
-    env.os << "\n";
-    // Load line number into T1
-    env.os << LI << T1 << " " << loc() << "\n";
-    // Abort
-    emit_case_abort2(env.os);
+    merge_label = env.code.NewLabel();
+    emit_void_check(env, merge_label, loc(), "_case_abort2");
 
     // the label after all branches are done with
-    int master_label = num_label;
-    num_label++;
+    int master_label = env.code.NewLabel();
 
     int i = 0;
     // Deal with each branch
-    for (auto branch : sorted_cases_) {
+    for (auto branch : sorted_cases) {
         /* Branch prologue */
         // Enter scope
-        ScopedTable<Symbol *, VarBinding *> &curr_etable = env.curr_cgen_node->etable_var_;
+        FlatScopedTable<Symbol *, VarBinding *> &curr_etable = env.etable_local;
         curr_etable.EnterScope();
-        num_temp++;
+        env.num_temp++;
 
         // Create VarBinding for the temporal
         // offset is relative to fp
@@ -1636,43 +2951,44 @@ void Kase::CodeGen(CgenEnv &env) {
         vb->var_name_ = branch->name_;
         vb->decl_type_ = branch->decl_type_;
         vb->origin_ = ARG;
-        vb->offset_ = 8 + 4 * num_temp;
+        vb->offset_ = 8 + 4 * env.num_temp;
+        vb->reg_ = env.RegisterOf(branch);
+        vb->non_void_ = env.NonVoidVar(branch);
         curr_etable.AddToScope(branch->name_, vb);
 
 
 
         /* Branch body */
-        env.os << "label" << merge_label << LABEL;
+        env.code.Label(merge_label);
         // Store the input object as a temporal
-        env.os << SW << ACC << " " << vb->offset_ << "(" << FP << ")\n";
+        vb->EmitStore(env.code);
         // Load the tag number of input object into $t2
-        env.os << LW << T2 << " 0(" << ACC << ")\n";
+        env.code.Lw(T2, 0, ACC);
         // Find the tag number of the current branch type
         int lower_bound = env.klass_table->TagFind(branch->decl_type_);
         int upper_bound = env.klass_table->NextSibTagFind(branch->decl_type_);
         // If the input tag does not fall between the bound, jump to the next branch
-        merge_label = num_label;
-        num_label++;
-        env.os << BLT << T2 << " " << lower_bound << " label" << merge_label << "\n";
-        env.os << BGT << T2 << " " << upper_bound - 1 << " label" << merge_label << "\n";
+        merge_label = env.code.NewLabel();
+        env.code.Branch(MipsOp::kBlt, T2, lower_bound, merge_label);
+        env.code.Branch(MipsOp::kBgt, T2, upper_bound - 1, merge_label);
         // CodeGen for each branch
         branch->body_->CodeGen(env);
         // Jump out of branch
-        env.os << BRANCH << "label" << master_label << "\n";
+        env.code.B(master_label);
 
 
         /* Branch epilogue */
         // Exit scope
         curr_etable.ExitScope();
-        num_temp--;
+        env.num_temp--;
         i++;
     } // end for
 
     // Case abort: no match
-    env.os << "label" << merge_label << LABEL;
-    emit_case_abort(env.os);
+    env.code.Label(merge_label);
+    emit_case_abort(env.code);
     // Conclude with the master label
-    env.os << "label" << master_label << LABEL;
+    env.code.Label(master_label);
 } // end void Kase::CodeGen(CgenEnv &env)
 
 
@@ -39,56 +39,56 @@ limitations under the License.
 #include "cgen_supp.h"
 
 namespace {
-int ascii = 0;
-
-void ascii_mode(std::ostream& os) {
+// Whether an .ascii directive is open, local to each string so that constants may be emitted
+// concurrently
+void ascii_mode(std::ostream& os, bool& ascii) {
   if (!ascii) {
     os << "\t.ascii\t\"";
-    ascii = 1;
+    ascii = true;
   }
 }
 
-void byte_mode(std::ostream& os) {
+void byte_mode(std::ostream& os, bool& ascii) {
   if (ascii) {
     os << "\"\n";
-    ascii = 0;
+    ascii = false;
   }
 }
 }
 
 void cool::emit_string_constant(std::ostream& os, const char* str) {
-  ascii = 0;
+  bool ascii = false;
 
   while (*str) {
     switch (*str) {
       case '\n':
-        ascii_mode(os);
+        ascii_mode(os, ascii);
         os << "\\n";
         break;
       case '\t':
-        ascii_mode(os);
+        ascii_mode(os, ascii);
         os << "\\t";
         break;
       case '\\':
-        byte_mode(os);
+        byte_mode(os, ascii);
         os << "\t.byte\t" << (int)((unsigned char)'\\') << std::endl;
         break;
       case '"':
-        ascii_mode(os);
+        ascii_mode(os, ascii);
         os << "\\\"";
         break;
       default:
         if (*str >= ' ' && ((unsigned char)*str) < 128) {
-          ascii_mode(os);
+          ascii_mode(os, ascii);
           os << *str;
         } else {
-          byte_mode(os);
+          byte_mode(os, ascii);
           os << "\t.byte\t" << (int)((unsigned char)*str) << std::endl;
         }
         break;
     }
     str++;
   }
-  byte_mode(os);
+  byte_mode(os, ascii);
   os << "\t.byte\t0\t" << std::endl;
 }
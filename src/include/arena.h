@@ -0,0 +1,149 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/**
+ * @file
+ *
+ * @brief Bump-pointer arena allocator
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace cool {
+
+/**
+ * @brief Bump-pointer allocator
+ *
+ * Allocations are carved sequentially out of large blocks, so objects allocated one after the other
+ * are adjacent in memory. Individual allocations are never freed, all of the memory is released at
+ * once when the Arena is destroyed. The Arena does not run destructors.
+ */
+class Arena {
+ public:
+  static constexpr std::size_t kDefaultBlockSize = 64 * 1024;
+
+  explicit Arena(std::size_t block_size = kDefaultBlockSize) : block_size_(block_size) {}
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  /**
+   * @brief Allocate uninitialized memory
+   *
+   * @param size Size in bytes
+   * @param align Alignment, must be a power of 2
+   * @return void* Pointer to memory that remains valid for the lifetime of the Arena
+   */
+  void* Allocate(std::size_t size, std::size_t align = alignof(std::max_align_t)) {
+    auto aligned = (reinterpret_cast<std::uintptr_t>(ptr_) + align - 1) & ~(align - 1);
+    if (ptr_ && aligned + size <= reinterpret_cast<std::uintptr_t>(end_)) {
+      ptr_ = reinterpret_cast<char*>(aligned + size);
+      bytes_allocated_ += size;
+      return reinterpret_cast<void*>(aligned);
+    }
+    return AllocateBlock(size, align);
+  }
+
+  /// Total bytes returned by Allocate
+  std::size_t bytes_allocated() const { return bytes_allocated_; }
+
+  /// Total bytes in the blocks obtained from the system
+  std::size_t bytes_reserved() const { return bytes_reserved_; }
+
+ private:
+  std::size_t block_size_;
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  char* ptr_ = nullptr;
+  char* end_ = nullptr;
+  std::size_t bytes_allocated_ = 0;
+  std::size_t bytes_reserved_ = 0;
+
+  void* AllocateBlock(std::size_t size, std::size_t align) {
+    // Oversized requests get a dedicated block so the remainder of the current block isn't wasted
+    std::size_t block_size = std::max(block_size_, size + align);
+    blocks_.emplace_back(new char[block_size]);
+    bytes_reserved_ += block_size;
+
+    char* block = blocks_.back().get();
+    auto aligned = (reinterpret_cast<std::uintptr_t>(block) + align - 1) & ~(align - 1);
+    if (block_size == block_size_) {
+      ptr_ = reinterpret_cast<char*>(aligned + size);
+      end_ = block + block_size;
+    }
+    bytes_allocated_ += size;
+    return reinterpret_cast<void*>(aligned);
+  }
+};
+
+/**
+ * @brief Standard allocator that allocates from an Arena, e.g. for containers owned by objects in
+ * the same Arena
+ *
+ * Deallocation is a no-op, memory is only reclaimed when the Arena is destroyed. Thus containers
+ * using this allocator do not need to be destroyed (but memory released when they grow is wasted).
+ *
+ * @tparam T Element type
+ */
+template <class T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+
+  explicit ArenaAllocator(Arena& arena) : arena_(&arena) {}
+
+  template <class U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {}
+
+  T* allocate(std::size_t n) {
+    return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+  }
+  void deallocate(T*, std::size_t) {}
+
+  Arena* arena() const { return arena_; }
+
+  template <class U>
+  bool operator==(const ArenaAllocator<U>& rhs) const { return arena_ == rhs.arena(); }
+  template <class U>
+  bool operator!=(const ArenaAllocator<U>& rhs) const { return arena_ != rhs.arena(); }
+
+ private:
+  Arena* arena_;
+};
+
+}  // namespace cool
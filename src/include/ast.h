@@ -83,6 +83,10 @@ namespace cool {
 // Forward declare semantic analysis and code generation environments
 class SemantEnv;
 class CgenEnv;
+class LiveIntervals;
+class NonVoidVars;
+class ConstantFolder;
+class BinaryASTWriter;
 
 /**
  * @brief Abstract base class for all AST Nodes
@@ -101,9 +105,20 @@ public:
     * @param with_types Include Expression types
     */
     virtual void DumpTree(std::ostream& os, size_t level, bool with_types) const = 0;
+
+    /**
+    * @brief Dump AST in the binary interchange format (see ast_binary.h)
+    *
+    * @param writer Binary AST writer, fields are written in the same order as DumpTree
+    */
+    virtual void DumpBinary(BinaryASTWriter& writer) const = 0;
     virtual void Typecheck(SemantEnv &env) {}
     virtual void CodeGen(CgenEnv &env) {}
     virtual void CountTemporal(int &num_temp, int &max_temp) {}
+    /// Report the live intervals of the values the code generator may keep in registers
+    virtual void CollectIntervals(LiveIntervals &intervals) {}
+    /// Clear the non-void assumption of the local variables that may be assigned void
+    virtual void CollectNonVoid(NonVoidVars &vars) {}
 
 protected:
     SourceLoc loc_ = 0;
@@ -130,6 +145,7 @@ public:
 
     // C++11+ Note: override specifier ensures we are actually overriding a virtual function
     void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+    void DumpBinary(BinaryASTWriter& writer) const override;
 
 protected:
     Klasses* klasses_;
@@ -173,6 +189,7 @@ public:
     //@}
 
     void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+    void DumpBinary(BinaryASTWriter& writer) const override;
     void Typecheck(SemantEnv &env);
 
 protected:
@@ -195,6 +212,7 @@ public:
 
 
     void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+    void DumpBinary(BinaryASTWriter& writer) const override;
 
 protected:
     Symbol* name_;
@@ -223,6 +241,9 @@ class Feature : public ASTNode {
 
   void Typecheck(SemantEnv &env);
 
+  /// Fold the constant subexpressions of the method body or attribute initializer
+  virtual void FoldConstants(ConstantFolder &folder) {}
+
  protected:
   Symbol* name_;
   Symbol* decl_type_;
@@ -253,7 +274,11 @@ class Method : public Feature {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void CountTemporal(int &num_temp, int &max_temp);
+  void CollectIntervals(LiveIntervals &intervals);
+  void CollectNonVoid(NonVoidVars &vars);
+  void FoldConstants(ConstantFolder &folder);
 
  protected:
   friend class Feature;
@@ -281,6 +306,8 @@ class Attr : public Feature {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
+  void FoldConstants(ConstantFolder &folder);
 
  protected:
   Expression* init_;
@@ -304,9 +331,47 @@ class Expression : public ASTNode {
 
 
   void DumpType(std::ostream& os, size_t level, bool with_types) const;
+  void DumpBinaryType(BinaryASTWriter& writer) const;
 
   virtual bool IsCode() const { return true; }
 
+  /**
+   * @brief Generate code leaving the raw word of an Int or Bool expression in ACC
+   *
+   * Used by the optimizing code generator to keep intermediate values unboxed. The default
+   * generates the boxed value and loads its value slot.
+   */
+  virtual void CodeGenUnboxed(CgenEnv &env);
+
+  /**
+   * @brief Generate code for a Bool expression used as a branch condition
+   *
+   * Branches to label \p label when the value is \p branch_if and falls through otherwise, without
+   * materializing the Bool. Only used by the optimizing code generator.
+   */
+  virtual void CodeGenBranch(CgenEnv &env, int label, bool branch_if);
+
+  /// Register already holding the raw value of this expression, kNullRegister if code is needed
+  virtual Register UnboxedRegister(CgenEnv &env) { return kNullRegister; }
+
+  /// Whether the code for this expression has no side effects and only writes ACC
+  virtual bool IsPure() const { return false; }
+
+  /**
+   * @brief Whether the value of this expression is never void
+   *
+   * Int, Bool and String values are never void, the default is based on the static type.
+   */
+  virtual bool NonVoid(const CgenEnv &env) const;
+
+  /**
+   * @brief Fold the constant subexpressions of this expression
+   *
+   * Used by the optimizing code generator before the constants are emitted.
+   * @return The expression to use in place of this one, e.g. a literal with the value
+   */
+  virtual Expression* FoldConstants(ConstantFolder &folder) { return this; }
+
  protected:
   Symbol* type_;
 
@@ -320,9 +385,15 @@ class Assign : public Expression {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
+  void CodeGenUnboxed(CgenEnv &env);
   void CountTemporal(int &num_temp, int &max_temp);
+  void CollectIntervals(LiveIntervals &intervals);
+  void CollectNonVoid(NonVoidVars &vars);
+  Expression* FoldConstants(ConstantFolder &folder);
+  bool NonVoid(const CgenEnv &env) const;
 
  protected:
   Symbol* name_;
@@ -340,9 +411,17 @@ class Dispatch : public Expression {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
   void CountTemporal(int &num_temp, int &max_temp);
+  void CollectIntervals(LiveIntervals &intervals);
+  void CollectNonVoid(NonVoidVars &vars);
+  Expression* FoldConstants(ConstantFolder &folder);
+
+  /// Number of the last arguments passed in registers (-a), none for a predefined method called
+  /// directly
+  virtual int NumRegArgs(const CgenEnv &env) const;
 
  protected:
   Expression* receiver_;
@@ -361,8 +440,10 @@ class StaticDispatch : public Dispatch {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
+  int NumRegArgs(const CgenEnv &env) const;
 
  protected:
   Symbol* dispatch_type_;
@@ -380,9 +461,15 @@ class Cond : public Expression {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
+  void CodeGenUnboxed(CgenEnv &env);
   void CountTemporal(int &num_temp, int &max_temp);
+  void CollectIntervals(LiveIntervals &intervals);
+  void CollectNonVoid(NonVoidVars &vars);
+  Expression* FoldConstants(ConstantFolder &folder);
+  bool NonVoid(const CgenEnv &env) const;
 
  protected:
   Expression* pred_;
@@ -400,9 +487,13 @@ class Loop : public Expression {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
   void CountTemporal(int &num_temp, int &max_temp);
+  void CollectIntervals(LiveIntervals &intervals);
+  void CollectNonVoid(NonVoidVars &vars);
+  Expression* FoldConstants(ConstantFolder &folder);
 
  protected:
   Expression* pred_;
@@ -418,10 +509,17 @@ class Block : public Expression {
   static Block* Create(Expressions* body, SourceLoc loc = 0);
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
+  void CodeGenUnboxed(CgenEnv &env);
+  void CodeGenBranch(CgenEnv &env, int label, bool branch_if);
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void CountTemporal(int &num_temp, int &max_temp);
+  void CollectIntervals(LiveIntervals &intervals);
+  void CollectNonVoid(NonVoidVars &vars);
+  Expression* FoldConstants(ConstantFolder &folder);
+  bool NonVoid(const CgenEnv &env) const;
 
  protected:
   Expressions* body_;
@@ -437,9 +535,14 @@ class Let : public Expression {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
+  void CodeGenUnboxed(CgenEnv &env);
   void CountTemporal(int &num_temp, int &max_temp);
+  void CollectIntervals(LiveIntervals &intervals);
+  void CollectNonVoid(NonVoidVars &vars);
+  Expression* FoldConstants(ConstantFolder &folder);
 
  protected:
   Symbol* name_;
@@ -447,6 +550,9 @@ class Let : public Expression {
   Expression* init_;
   Expression* body_;
 
+  /// Shared by CodeGen and CodeGenUnboxed, which differ only in how the body is generated
+  void CodeGenLet(CgenEnv &env, bool unboxed_body);
+
   Let(Symbol* name, Symbol* decl_type, Expression* init, Expression* body, SourceLoc loc)
       : Expression(loc), name_(name), decl_type_(decl_type), init_(init), body_(body) {}
 };
@@ -458,15 +564,18 @@ class Kase : public Expression {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
-  void SortBranches(CgenEnv &env);
+  std::vector<KaseBranch*> SortBranches(CgenEnv &env) const;
   void CountTemporal(int &num_temp, int &max_temp);
+  void CollectIntervals(LiveIntervals &intervals);
+  void CollectNonVoid(NonVoidVars &vars);
+  Expression* FoldConstants(ConstantFolder &folder);
 
  protected:
   Expression* input_;
   KaseBranches* cases_;
-  std::vector<KaseBranch*> sorted_cases_;
 
   Kase(Expression* input, KaseBranches* cases, SourceLoc loc)
       : Expression(loc), input_(input), cases_(cases) {}
@@ -483,6 +592,7 @@ class KaseBranch : public Expression {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void CountTemporal(int &num_temp, int &max_temp);
 
  protected:
@@ -503,8 +613,10 @@ class Knew : public Expression {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
+  bool NonVoid(const CgenEnv &env) const { return true; }
 
  protected:
   Symbol* name_;
@@ -529,9 +641,15 @@ class UnaryOperator : public Expression {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void CodeGen(CgenEnv &env);
+  void CodeGenUnboxed(CgenEnv &env);
+  void CodeGenBranch(CgenEnv &env, int label, bool branch_if);
   void Typecheck(SemantEnv &env);
   void CountTemporal(int &num_temp, int &max_temp);
+  void CollectIntervals(LiveIntervals &intervals);
+  void CollectNonVoid(NonVoidVars &vars);
+  Expression* FoldConstants(ConstantFolder &folder);
 
  protected:
   UnaryKind kind_;
@@ -560,15 +678,24 @@ class BinaryOperator : public Expression {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
+  void CodeGenUnboxed(CgenEnv &env);
+  void CodeGenBranch(CgenEnv &env, int label, bool branch_if);
   void CountTemporal(int &num_temp, int &max_temp);
+  void CollectIntervals(LiveIntervals &intervals);
+  void CollectNonVoid(NonVoidVars &vars);
+  Expression* FoldConstants(ConstantFolder &folder);
 
  protected:
   BinaryKind kind_;
   Expression* lhs_;
   Expression* rhs_;
 
+  /// Evaluate both operands unboxed, setting the registers that hold their values
+  void CodeGenOperands(CgenEnv &env, Register &lhs, Register &rhs);
+
   BinaryOperator(BinaryKind kind, Expression* lhs, Expression* rhs, SourceLoc loc)
       : Expression(loc), kind_(kind), lhs_(lhs), rhs_(rhs) {}
 };
@@ -580,8 +707,15 @@ class Ref : public Expression {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
+  void CodeGenUnboxed(CgenEnv &env);
+  void CollectIntervals(LiveIntervals &intervals);
+  Register UnboxedRegister(CgenEnv &env);
+  bool IsPure() const { return true; }
+  bool NonVoid(const CgenEnv &env) const;
+  Expression* FoldConstants(ConstantFolder &folder);
 
  protected:
   Symbol* name_;
@@ -596,6 +730,7 @@ class NoExpr : public Expression {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
 
@@ -620,10 +755,14 @@ class StringLiteral : public Expression {
   static StringLiteral* Create(const char* value, std::size_t length, SourceLoc loc = 0);
   //@}
 
-  const std::string& value() const { return value_->value(); }
+  const StringRef& value() const { return value_->value(); }
+
+  /// The entry for this literal in \p cool::gStringTable
+  const StringEntry* entry() const { return value_; }
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
 
@@ -654,8 +793,11 @@ class IntLiteral : public Expression {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
+  void CodeGenUnboxed(CgenEnv &env);
+  bool IsPure() const { return true; }
 
  protected:
   const Int32Entry* value_;
@@ -672,8 +814,12 @@ class BoolLiteral : public Expression {
 
 
   void DumpTree(std::ostream& os, size_t level, bool with_types) const override;
+  void DumpBinary(BinaryASTWriter& writer) const override;
   void Typecheck(SemantEnv &env);
   void CodeGen(CgenEnv &env);
+  void CodeGenUnboxed(CgenEnv &env);
+  bool IsPure() const { return true; }
+  void CodeGenBranch(CgenEnv &env, int label, bool branch_if);
 
  protected:
   const bool value_;
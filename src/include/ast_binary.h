@@ -0,0 +1,178 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/**
+ * @file
+ *
+ * @brief Binary AST interchange format
+ *
+ * A compact alternative to the text produced by ASTNode::DumpTree for passing the AST between
+ * compiler phases. The format is:
+ *
+ * \code
+ * magic      8 bytes  "\x7f" "COOLAST"
+ * version    u32      kBinaryASTVersion
+ * symbols    u32 count, then for each symbol: u32 length, bytes
+ * strings    u32 count, then for each string: u32 length, bytes
+ * integers   u32 count, then for each integer: i32
+ * nodes      The Program node in preorder
+ * \endcode
+ *
+ * Each node starts with a u8 BinaryASTTag and u32 SourceLoc, followed by its fields in the same
+ * order as DumpTree. Symbols, strings and integers are written as u32 indices into the tables
+ * above, vectors of children as a u32 count followed by the children, and expressions end with
+ * their type (as a symbol). All multi-byte values are little-endian.
+ *
+ * The tables are written in order of first appearance in the tree, i.e. the order in which the
+ * text reader would intern those same values, so that both formats produce identical table ids
+ * (and thus identical generated code).
+ */
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast_fwd.h"
+#include "stringtab.h"
+
+namespace cool {
+
+/// Version of the binary AST format, increment on any incompatible change
+constexpr uint32_t kBinaryASTVersion = 1;
+
+/// Node tags in the binary AST format
+enum class BinaryASTTag : uint8_t {
+  Program = 1,
+  Klass,
+  Formal,
+  Method,
+  Attr,
+  Assign,
+  StaticDispatch,
+  Dispatch,
+  Cond,
+  Loop,
+  Block,
+  Let,
+  Kase,
+  KaseBranch,
+  Knew,
+  Neg,
+  Not,
+  IsVoid,
+  Add,
+  Sub,
+  Mul,
+  Div,
+  LessThan,
+  Equal,
+  LessOrEqual,
+  Ref,
+  NoExpr,
+  String,
+  Int,
+  Bool,
+};
+
+/**
+ * @brief Serialize the AST in the binary format
+ *
+ * Nodes are written to an internal buffer (via ASTNode::DumpBinary) while the tables are
+ * collected, the complete file is then emitted with Finish.
+ */
+class BinaryASTWriter {
+ public:
+  explicit BinaryASTWriter(bool with_types) : with_types_(with_types) {}
+
+  /// Include Expression types (otherwise all expressions are written as _no_type)
+  bool with_types() const { return with_types_; }
+
+  /**
+   * @name Node fields
+   * @{
+   */
+  void WriteNode(BinaryASTTag tag, SourceLoc loc);
+  void WriteSymbol(const Symbol* symbol);
+  void WriteString(const StringEntry* string);
+  void WriteInt(const Int32Entry* value);
+  void WriteCount(std::size_t count);
+  //@}
+
+  /// Write the header, tables and buffered nodes to \p os
+  void Finish(std::ostream& os) const;
+
+ private:
+  bool with_types_;
+  std::string nodes_;
+
+  // Table entries in order of first appearance
+  std::vector<const Symbol*> symbols_;
+  std::vector<const StringEntry*> strings_;
+  std::vector<const Int32Entry*> ints_;
+  std::unordered_map<const void*, uint32_t> indices_;
+
+  void WriteU8(uint8_t value) { nodes_.push_back(static_cast<char>(value)); }
+  void WriteU32(uint32_t value);
+
+  template <class Entry>
+  void WriteIndex(const Entry* entry, std::vector<const Entry*>& table);
+};
+
+/**
+ * @brief Write \p program to \p os in the binary AST format
+ *
+ * @param os Output stream
+ * @param program AST root
+ * @param with_types Include Expression types
+ */
+void DumpBinaryAST(std::ostream& os, const Program* program, bool with_types);
+
+/// Return true if the next bytes available in \p is start a binary AST (does not consume input)
+bool IsBinaryAST(std::istream& is);
+
+/**
+ * @brief Read a binary AST from \p is
+ *
+ * Symbols, strings and integers are interned in gIdentTable, gStringTable and gIntTable. Malformed
+ * input is reported to std::cerr and terminates the program (like the text AST parser).
+ *
+ * @param is Input stream
+ * @return Program* AST root
+ */
+Program* ReadBinaryAST(std::istream& is);
+
+}  // namespace cool
@@ -0,0 +1,112 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/**
+ * @file
+ *
+ * @brief Compilation context that owns the memory for the AST
+ */
+#pragma once
+
+#include <cstddef>
+
+#include "arena.h"
+
+namespace cool {
+
+/**
+ * @brief Owner of the AST for a compilation
+ *
+ * All AST nodes and ASTNodeVectors are bump-allocated in the Arena of the current context (see
+ * ASTContext::Current). The parsers build the tree bottom-up, so nodes are laid out in post-order
+ * with each subtree contiguous in memory. Destroying the context frees the entire tree at once (no
+ * destructors are run), so the AST must not be used after its context is destroyed.
+ *
+ * Example usage, freeing the AST after each compilation in a long-running process:
+ * \code{.cpp}
+ * {
+ *   ASTContext context;
+ *   ASTContext::Scope scope(context);
+ *   Program* program = ...;  // Parse
+ *   ...
+ * }  // AST is freed
+ * \endcode
+ */
+class ASTContext {
+ public:
+  ASTContext() = default;
+
+  ASTContext(const ASTContext&) = delete;
+  ASTContext& operator=(const ASTContext&) = delete;
+
+  /**
+   * @brief Context in which AST nodes are created by the calling thread
+   *
+   * This is the context of the innermost active ASTContext::Scope on this thread, or if there is
+   * none, a process-wide default context that is never freed.
+   */
+  static ASTContext& Current();
+
+  /// Allocate uninitialized memory for an object of type \p T, e.g. for use with placement new
+  template <class T>
+  void* Allocate() {
+    return arena_.Allocate(sizeof(T), alignof(T));
+  }
+
+  Arena& arena() { return arena_; }
+
+  /// Total bytes allocated for the AST
+  std::size_t bytes_allocated() const { return arena_.bytes_allocated(); }
+
+  /// Total bytes obtained from the system for the AST
+  std::size_t bytes_reserved() const { return arena_.bytes_reserved(); }
+
+  /// Make \p context the current context for the calling thread for the lifetime of the Scope
+  class Scope {
+   public:
+    explicit Scope(ASTContext& context);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    ASTContext* previous_;
+  };
+
+ private:
+  Arena arena_;
+};
+
+}  // namespace cool
@@ -39,21 +39,25 @@ limitations under the License.
  */
 #pragma once
 
+#include <new>
 #include <vector>
 
+#include "ast_context.h"
+
 namespace cool {
 
 /**
  * @brief Vector-like type for collections of ASTNode pointers
  *
  * A thin wrapper around std::vector for maintaining vectors of ASTNode pointers. Adds
- * factory methods to facilitate AST creation during parsing.
+ * factory methods to facilitate AST creation during parsing. The vector and its elements are
+ * allocated in the current ASTContext.
  *
  * @tparam Elem Underlying element type (not a pointer type)
  */
 template <class Elem>
 class ASTNodeVector {
-  typedef std::vector<Elem*> Data;
+  typedef std::vector<Elem*, ArenaAllocator<Elem*>> Data;
 
  public:
   typedef typename Data::size_type size_type;
@@ -67,14 +71,18 @@ class ASTNodeVector {
    * @name Factory methods
    * @{
    */
-  static ASTNodeVector* Create() { return new ASTNodeVector(); }
-  static ASTNodeVector* Create(Elem* elem) { return new ASTNodeVector({elem}); }
+  static ASTNodeVector* Create() { return Create({}); }
+  static ASTNodeVector* Create(Elem* elem) { return Create({elem}); }
   static ASTNodeVector* Create(std::initializer_list<Elem*> list) {
-    return new ASTNodeVector(list);
+    ASTContext& context = ASTContext::Current();
+    return new (context.Allocate<ASTNodeVector>()) ASTNodeVector(list, context.arena());
   }
 
   /// Return element at index \p i. See \ref std::vector::at for more information.
   Elem* at(size_type i) { return data_.at(i); }
+
+  /// Replace element at index \p i, e.g. with a simplified node
+  void set(size_type i, Elem* elem) { data_.at(i) = elem; }
   
   /// Return last element in the vector. See \ref std::vector::back for more information.
   Elem* back() { return data_.back(); }
@@ -105,10 +113,10 @@ class ASTNodeVector {
   }
 
  private:
-  std::vector<Elem*> data_;
+  Data data_;
 
   // ASTNodeVector should only be created with factory methods
-  ASTNodeVector() {}
-  ASTNodeVector(std::initializer_list<Elem*> list) : data_(list) {}
+  ASTNodeVector(std::initializer_list<Elem*> list, Arena& arena)
+      : data_(list, ArenaAllocator<Elem*>(arena)) {}
 };
 }  // namespace cool
@@ -40,9 +40,17 @@ limitations under the License.
 #include "ast.h"
 #include "ast_consumer.h"
 #include "emit.h"
+#include "mips.h"
+#include "peephole.h"
+#include "regalloc.h"
 #include "scopedtab.h"
 #include <assert.h>
 #include <stdio.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 // Possible values for VarBinding::origin_
 #define ATTR 0    // the variable comes from attribute definition
@@ -51,9 +59,19 @@ limitations under the License.
 /// Switch for optimizing code generator
 extern bool cgen_optimize;
 
+/// Switch for optimizing code size (-Os), implies cgen_optimize
+extern bool cgen_optimize_size;
+
 /// Switch to disable register allocator
 extern bool disable_reg_alloc;
 
+/// Switch to pass the last arguments of each call in $a1-$a3 (-a), only with cgen_optimize
+extern bool cgen_reg_args;
+
+/// Range of the Int values with a preallocated object (-i min:max), empty if min > max
+extern int cgen_int_cache_min;
+extern int cgen_int_cache_max;
+
 /**
  * @name Garbage collection options
  * {@}
@@ -88,6 +106,7 @@ class VarBinding {
     friend class Let;
     friend class Kase; 
     friend class KaseBranch;
+    friend class NonVoidVars;
     Symbol *class_name_;
     Symbol *var_name_;
     Symbol *decl_type_;
@@ -100,6 +119,21 @@ class VarBinding {
     // If origin_ == ARG, then the offset is relative to the framepointer (fp).
     // If origin_ == LETTEMP, then the offset is relative to XXX?
     int offset_;
+
+    // Set for Int and Bool let temporaries of the optimizing code generator, whose frame slot
+    // holds the raw value instead of a pointer to the boxed object.
+    bool unboxed_ = false;
+
+    // Register holding a method argument, let or case temporary placed by the register allocator,
+    // in place of the frame slot at offset_
+    Register reg_ = kNullRegister;
+
+    // Set for the method arguments, let and case temporaries that never hold void
+    bool non_void_ = false;
+
+    // Load the variable into ACC, or store ACC into the variable
+    void EmitLoad(MipsCode &code) const;
+    void EmitStore(MipsCode &code) const;
 };
 
 
@@ -140,13 +174,15 @@ class CgenNode : public InheritanceNode<CgenNode> {
   std::size_t tag_;
   std::size_t next_sib_tag_;
 
-  ScopedTable<Symbol *, VarBinding *> etable_var_; // hash table for lookup
-  std::vector<Symbol *> evector_attr_; // vector for maintaining order
-  std::unordered_map<Symbol *, MethBinding *> etable_meth_; // hash table for lookup
-  std::vector<Symbol *> evector_meth_; // vector for maintaining order
+  PersistentScopedTable<Symbol *, VarBinding *> etable_var_; // hash table for lookup, shares the parent's scopes
+  std::vector<Symbol *> evector_attr_; // vector for maintaining order, attributes defined in this class only
+  std::size_t num_attr_ = 0; // number of attributes, including inherited attributes
+  PersistentScopedTable<Symbol *, MethBinding *> etable_meth_; // hash table for lookup, shares the parent's scopes
+  std::size_t num_meth_ = 0; // number of dispatch table entries, including inherited methods (the offset_ order)
 
 
   friend class CgenKlassTable;
+  friend class CgenEnv;
   friend class Dispatch;
   friend class StaticDispatch;
   friend class Ref;
@@ -156,6 +192,28 @@ class CgenNode : public InheritanceNode<CgenNode> {
   friend class KaseBranch;
 };
 
+/**
+ * @brief Object initializer or method lowered independently of the others
+ *
+ * The units are lowered on multiple threads with their own label numbering, statistics and peephole
+ * optimizer, and then combined in order, so that the output does not depend on the threads.
+ */
+struct CgenUnit {
+  CgenNode *node;
+  Method *meth;  // nullptr for the object initializer of node
+  MipsCode code;
+  std::string text;  // Printed code, once the labels are rebased
+
+  // Dynamic dispatch sites generated and the number of those that were emitted as direct calls
+  std::size_t num_dispatch = 0;
+  std::size_t num_devirtualized = 0;
+
+  // Peephole optimizer run on the code (-O), it counts the rewrites
+  PeepholeOptimizer peephole;
+
+  CgenUnit(CgenNode *node_arg, Method *meth_arg) : node(node_arg), meth(meth_arg) {}
+};
+
 /// Class table for use in code generation
 class CgenKlassTable : public KlassTable<CgenNode> {
  public:
@@ -198,9 +256,33 @@ class CgenKlassTable : public KlassTable<CgenNode> {
   void doBinding(CgenNode *node, CgenNode *parent);
 
   // helper method for sorting kasebranches
-  void SortSearch(Kase *caseexpr, CgenNode *node);
+  void SortSearch(const Kase *caseexpr, CgenNode *node, std::vector<KaseBranch *> &sorted_cases) const;
+
+  /**
+   * @brief Find the single implementation of a method shared by a class and all its subclasses
+   *
+   * @param node Static class of the receiver
+   * @param name Method name
+   * @return Binding of the implementation, or NULL if a subclass overrides the method
+   */
+  const MethBinding *MonomorphicMeth(const CgenNode *node, Symbol *name) const;
+
+  /**
+   * @brief Label of the stub shared by the void checks of a file that abort through a runtime routine
+   *
+   * The stub loads the file name and jumps to the routine, each site only loads its line number.
+   *
+   * @param abort Runtime abort routine, e.g. _dispatch_abort
+   * @param filename File name string constant
+   * @return Stub label
+   */
+  std::string AbortStub(const char *abort, const StringEntry *filename);
 
  private:
+  // Abort stubs referenced by the generated code (-Os), by label, added to by all threads
+  std::map<std::string, std::pair<const char *, const StringEntry *>> abort_stubs_;
+  std::mutex abort_stubs_mutex_;
+
 
   /**
    * Emit code to the start the .data segment and declare global names
@@ -232,28 +314,124 @@ class CgenKlassTable : public KlassTable<CgenNode> {
   void CgenClassObjTable(std::ostream& os);
 
   void CgenProtobj(std::ostream& os) const;
+  void CgenProtobjAttrs(const CgenNode *node, std::ostream& os) const;
 
   void CgenDispTable(std::ostream& os) const;
 
-  void CgenObjInit(std::ostream& os);
+  /**
+   * Lower the object initializers and then the methods, in batches on NumThreads() threads, and
+   * print them in order with the labels numbered as if lowered one after another
+   * @param os std::ostream to write generated code to
+   */
+  void CgenUnits(std::ostream& os);
+
+  /**
+   * Lower an object initializer or method to the code of \p unit, may be called concurrently
+   * @param unit Object initializer or method
+   */
+  void CgenObjInit(CgenUnit &unit);
+
+  void CgenMethBody(CgenUnit &unit);
+
+  /**
+   * Lower the abort stubs and the argument thunks to MipsCode, printed once complete
+   * @param os std::ostream to write generated code to
+   */
+  void CgenAbortStubs(std::ostream &os) const;
 
-  void CgenMethBody(std::ostream &os);
+  void CgenThunks(std::ostream &os) const;
 
+  friend class Dispatch;
   friend class Kase;
   friend class KaseBranch;
 
 };
 
 
+/// State of the pass that reports the live intervals of a method body to the register allocator
+class LiveIntervals {
+  public:
+    const CgenEnv &env;
+    RegisterAllocator &regs;
+    // The formal, let or case node that introduces each variable in scope
+    FlatScopedTable<Symbol *, const ASTNode *> vars;
+    // Estimated number of executions of the current expression, relative to the method body
+    int frequency = 1;
+
+    LiveIntervals(const CgenEnv &env_arg, RegisterAllocator &regs_arg)
+        : env(env_arg), regs(regs_arg) {}
+};
+
+
+/// State of the constant folding pass over a method body or attribute initializer
+class ConstantFolder {
+  public:
+    // Literal value of each let variable in scope, nullptr for the variables that are not constant
+    FlatScopedTable<Symbol *, Expression *> consts;
+    // Variables assigned anywhere in the feature, recorded by the first pass
+    std::unordered_set<Symbol *> assigned;
+    // Set for the second pass, which propagates the let variables that are never assigned
+    bool propagate = false;
+};
+
+
+/// State of the pass that finds the method arguments, let and case temporaries that never hold void
+class NonVoidVars {
+  public:
+    CgenEnv &env;
+    // Set when a variable may hold void after all, the pass is repeated until nothing changes
+    bool changed = false;
+
+    explicit NonVoidVars(CgenEnv &env_arg) : env(env_arg) {}
+
+    /// Binding used during the pass for the variable introduced by node, the first pass sets
+    /// whether it is assumed non-void
+    VarBinding *Bind(const ASTNode *node, Symbol *name, bool non_void = true);
+
+    /// Record that the value of expr may be stored in the variable
+    void Store(VarBinding *vb, const Expression *expr);
+
+    /// Whether the variable introduced by node never holds void
+    bool Find(const ASTNode *node) const {
+        auto it = vars_.find(node);
+        return it != vars_.end() && it->second.non_void_;
+    }
+
+  private:
+    std::unordered_map<const ASTNode *, VarBinding> vars_;
+};
+
+
 class CgenEnv {
   public:
     CgenKlassTable *klass_table;
     CgenNode *curr_cgen_node;
-    std::ostream &os;
-
-    CgenEnv(CgenKlassTable *klass_table_arg,
-            CgenNode *curr_cgen_node_arg,
-            std::ostream &os_arg);
+    // Method or object initializer being generated, and its code
+    CgenUnit &unit;
+    MipsCode &code;
+    // Scoped table for the formals, let and case variables in the method being generated, the
+    // class attributes are in curr_cgen_node->etable_var_
+    FlatScopedTable<Symbol *, VarBinding *> etable_local;
+    // Registers of the method being generated, nullptr if the register allocator is disabled
+    const RegisterAllocator *regs = nullptr;
+    // Variables of the method being generated that never hold void, nullptr if not optimizing
+    const NonVoidVars *non_void = nullptr;
+    // Number of let and case temporaries in scope, the next one is stored in the following slot
+    int num_temp = 0;
+
+    CgenEnv(CgenKlassTable *klass_table_arg, CgenUnit &unit_arg);
+
+    VarBinding *LookupVar(Symbol *name) const;
+
+    /// Register allocated to value index of node, kNullRegister if it lives in memory
+    Register RegisterOf(const ASTNode *node, int index = 0) const {
+        return regs ? regs->Find(node, index) : kNullRegister;
+    }
+
+    /// Whether the variable introduced by node never holds void
+    bool NonVoidVar(const ASTNode *node) const {
+        return non_void && non_void->Find(node);
+    }
 };
 
 
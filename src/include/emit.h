@@ -63,11 +63,13 @@ typedef char const* Register;
 #define BOOLTAG              "_bool_tag"
 #define STRINGTAG            "_string_tag"
 #define HEAP_START           "heap_start"
+#define INTCACHE             "_int_cache"
 
 // Naming conventions
 #define DISPTAB_SUFFIX       "_dispTab"
 #define METHOD_SEP           "."
 #define CLASSINIT_SUFFIX     "_init"
+#define THUNK_SUFFIX         "_thunk"
 #define PROTOBJ_SUFFIX       "_protObj"
 #define OBJECTPROTOBJ        "Object_protObj"
 #define INTCONST_PREFIX      "int_const"
@@ -106,9 +108,18 @@ typedef char const* Register;
 Register const ZERO = "$zero";		// Zero register
 Register const ACC  = "$a0";		// Accumulator
 Register const A1   = "$a1";		// For arguments to prim functions
+Register const A2   = "$a2";		// Arguments passed in registers (-a), with $a1
+Register const A3   = "$a3";
 Register const SELF = "$s0";		// Pointer to self (callee saves)
+Register const S1   = "$s1";		// Callee saves, for the register allocator
+Register const S2   = "$s2";
+Register const S3   = "$s3";
+Register const S4   = "$s4";
+Register const S5   = "$s5";
+Register const S6   = "$s6";		// $s7 is the heap limit of the runtime
 Register const T1   = "$t1";		// Temporary 1
 Register const T2   = "$t2";		// Temporary 2
+Register const T3   = "$t3";		// Self in methods without a frame (-O)
 Register const SP   = "$sp";		// Stack pointer
 Register const FP   = "$fp";		// Frame pointer
 Register const RA   = "$ra";		// Return address
@@ -121,33 +132,3 @@ Register const RA   = "$ra";		// Return address
  * Assumes r1 and r2 are pointers to shared register labels, and so performs just checks for equal pointers
  */
 inline bool regEq(Register r1, Register r2) { return r1 == r2; }
-
-//
-// Opcodes
-//
-#define JALR  "\tjalr\t"
-#define JAL   "\tjal\t"
-#define RET   "\tjr\t$ra\t"
-
-#define SW    "\tsw\t"
-#define LW    "\tlw\t"
-#define LI    "\tli\t"
-#define LA    "\tla\t"
-
-#define MOVE  "\tmove\t"
-#define NEG   "\tneg\t"
-#define ADD   "\tadd\t"
-#define ADDI  "\taddi\t"
-#define ADDU  "\taddu\t"
-#define ADDIU "\taddiu\t"
-#define DIV   "\tdiv\t"
-#define MUL   "\tmul\t"
-#define SUB   "\tsub\t"
-#define SLL   "\tsll\t"
-#define BEQZ  "\tbeqz\t"
-#define BRANCH   "\tb\t"
-#define BEQ      "\tbeq\t"
-#define BNE      "\tbne\t"
-#define BLEQ     "\tble\t"
-#define BLT      "\tblt\t"
-#define BGT      "\tbgt\t"
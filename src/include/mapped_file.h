@@ -0,0 +1,86 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/**
+ * @file
+ *
+ * @brief Memory-mapped input files
+ */
+#pragma once
+
+#include <cstddef>
+
+namespace cool {
+
+/**
+ * @brief Source file mapped into memory, followed by zero padding
+ *
+ * The mapping is private and writable so that a scanner can modify the buffer in place (e.g. flex
+ * temporarily NUL-terminates each token) without copying the file or modifying it on disk. The
+ * file contents are followed by at least \p padding NUL bytes (flex's yy_scan_buffer requires
+ * two).
+ */
+class MappedFile {
+ public:
+  MappedFile() {}
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /**
+   * @brief Map file at \p path into memory
+   *
+   * @param path Path to file
+   * @param padding Number of NUL bytes required after the file contents
+   * @return true File mapped
+   * @return false File could not be opened or is not a regular file (e.g. a pipe)
+   */
+  bool Open(const char* path, std::size_t padding);
+
+  /// Start of file contents
+  char* data() { return data_; }
+
+  /// Size of file contents (excluding padding)
+  std::size_t size() const { return size_; }
+
+ private:
+  char* data_ = nullptr;
+  std::size_t size_ = 0;
+  std::size_t mapped_size_ = 0;
+
+  void Close();
+};
+
+}  // namespace cool
@@ -0,0 +1,234 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/**
+ * @file
+ *
+ * @brief In-memory MIPS code of the code generator
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include "ast_fwd.h"
+
+namespace cool {
+
+/// MIPS instructions and SPIM pseudo-instructions used by the code generator
+enum class MipsOp : std::uint8_t {
+  kLabel,  // Definition of a label, not an instruction
+  kLw,
+  kSw,
+  kLi,
+  kLa,
+  kMove,
+  kNeg,
+  kAdd,
+  kAddu,
+  kAddiu,
+  kSub,
+  kMul,
+  kDiv,
+  kSll,
+  kSlt,
+  kSle,
+  kSeq,
+  kXori,
+  kB,
+  kBeqz,
+  kBeq,
+  kBne,
+  kBlt,
+  kBle,
+  kBgt,
+  kBge,
+  kBgeu,
+  kJ,
+  kJal,
+  kJalr,
+  kJr,  // kB to kJr transfer control
+};
+
+/**
+ * @brief Whitespace after the mnemonic of an instruction in the assembly text
+ *
+ * The code generator used to write some instructions in more than one way, each instruction keeps
+ * its spelling so that the printed code does not change.
+ */
+enum class MipsSpacing : std::uint8_t {
+  kTab,       // "\tb\tlabel1"
+  kSpace,     // "\tjal _dispatch_abort"
+  kTabSpace,  // "\tb\t label1"
+};
+
+/// Number of a local label, printed as "label<number>"
+constexpr int kNoLabel = -1;
+
+/// Compare two registers by name, a null register is different from all registers
+bool SameRegister(Register a, Register b);
+
+/**
+ * @brief MIPS instruction, or label definition
+ *
+ * Operands that an instruction does not use are null, 0, kNoLabel or empty. Jump targets and label
+ * definitions are a local label or, when it is kNoLabel, the global label in symbol.
+ */
+struct MipsInstr {
+  MipsOp op;
+  MipsSpacing spacing = MipsSpacing::kTab;
+  Register rd = kNullRegister;  // Destination, or the register stored by sw
+  Register rs = kNullRegister;  // Source, or the base register of lw and sw
+  Register rt = kNullRegister;  // Second source, the immediate is the operand if null
+  int imm = 0;                  // Immediate, or the offset of lw and sw
+  int label = kNoLabel;         // Local label defined or targeted
+  std::string symbol;           // Global label defined or targeted, or the address of la, lw and sw
+
+  explicit MipsInstr(MipsOp op_arg) : op(op_arg) {}
+
+  /// True for label definitions, jumps and branches
+  bool IsControl() const { return op == MipsOp::kLabel || op >= MipsOp::kB; }
+
+  /// Register written by a straight-line instruction, kNullRegister if none
+  Register Written() const;
+
+  /// True if the instruction reads \p reg, registers that a call reads are not known
+  bool Reads(Register reg) const;
+
+  /// True if the instruction reads or writes \p reg
+  bool Mentions(Register reg) const { return Reads(reg) || SameRegister(Written(), reg); }
+};
+
+std::ostream& operator<<(std::ostream& os, const MipsInstr& instr);
+
+/**
+ * @brief Code of a method, object initializer or stub, as a list of instructions
+ *
+ * The code generator lowers each method with the builders, named after the mnemonics, and the
+ * assembly text is printed once the code is complete. Local labels are numbered from 0 in each
+ * code, so that methods can be lowered independently, and are rebased into the numbering of the
+ * whole program before printing.
+ *
+ * Example usage:
+ * \code{.cpp}
+ * MipsCode code;
+ * code.Label("Main.main");
+ * int label = code.NewLabel();
+ * code.Lw("$t1", 12, "$a0");
+ * code.Beqz("$t1", label);
+ * ...
+ * code.Label(label);
+ * code.RebaseLabels(base);
+ * os << code;
+ * \endcode
+ */
+class MipsCode {
+ public:
+  /// Allocate a local label, numbered in the order of allocation
+  int NewLabel() { return num_labels_++; }
+
+  /// Number of local labels allocated
+  int num_labels() const { return num_labels_; }
+
+  /// Add \p base to all local labels, e.g. the number of labels allocated by the preceding code
+  void RebaseLabels(int base);
+
+  void Label(int label);
+  void Label(std::string name);
+
+  void Lw(Register rd, int offset, Register base);
+  void Lw(Register rd, std::string address, Register base);
+  void Sw(Register rt, int offset, Register base);
+  void Li(Register rd, int imm);
+  void La(Register rd, std::string address);
+  void Move(Register rd, Register rs);
+  void Neg(Register rd, Register rs);
+
+  /// Three-register instruction: add, addu, sub, mul, div, slt, sle or seq
+  void Arith(MipsOp op, Register rd, Register rs, Register rt);
+  void Add(Register rd, Register rs, Register rt) { Arith(MipsOp::kAdd, rd, rs, rt); }
+  void Addu(Register rd, Register rs, Register rt) { Arith(MipsOp::kAddu, rd, rs, rt); }
+  void Sub(Register rd, Register rs, Register rt) { Arith(MipsOp::kSub, rd, rs, rt); }
+  void Mul(Register rd, Register rs, Register rt) { Arith(MipsOp::kMul, rd, rs, rt); }
+  void Div(Register rd, Register rs, Register rt) { Arith(MipsOp::kDiv, rd, rs, rt); }
+  void Slt(Register rd, Register rs, Register rt) { Arith(MipsOp::kSlt, rd, rs, rt); }
+  void Sle(Register rd, Register rs, Register rt) { Arith(MipsOp::kSle, rd, rs, rt); }
+  void Seq(Register rd, Register rs, Register rt) { Arith(MipsOp::kSeq, rd, rs, rt); }
+
+  /// Register and immediate instruction: addiu, sll or xori
+  void ArithImm(MipsOp op, Register rd, Register rs, int imm);
+  void Addiu(Register rd, Register rs, int imm) { ArithImm(MipsOp::kAddiu, rd, rs, imm); }
+  void Sll(Register rd, Register rs, int imm) { ArithImm(MipsOp::kSll, rd, rs, imm); }
+  void Xori(Register rd, Register rs, int imm) { ArithImm(MipsOp::kXori, rd, rs, imm); }
+
+  void B(int label, MipsSpacing spacing = MipsSpacing::kTab);
+  void Beqz(Register rs, int label);
+  void Beqz(Register rs, std::string target);
+
+  /// Conditional branch comparing two registers: beq, bne, blt, ble, bgt or bge
+  void Branch(MipsOp op, Register rs, Register rt, int label);
+  /// Conditional branch comparing a register with an immediate: blt, bgt or bgeu
+  void Branch(MipsOp op, Register rs, int imm, int label);
+  void Beq(Register rs, Register rt, int label) { Branch(MipsOp::kBeq, rs, rt, label); }
+  void Bne(Register rs, Register rt, int label) { Branch(MipsOp::kBne, rs, rt, label); }
+  void Blt(Register rs, Register rt, int label) { Branch(MipsOp::kBlt, rs, rt, label); }
+  void Ble(Register rs, Register rt, int label) { Branch(MipsOp::kBle, rs, rt, label); }
+
+  void J(std::string target);
+  void Jal(std::string target, MipsSpacing spacing = MipsSpacing::kTab);
+  void Jalr(Register rs);
+  void Jr(Register rs);
+
+  const std::vector<MipsInstr>& instrs() const { return instrs_; }
+  std::vector<MipsInstr>& instrs() { return instrs_; }
+
+  /// Number of instructions, label definitions excluded
+  std::size_t size() const;
+
+  friend std::ostream& operator<<(std::ostream& os, const MipsCode& code);
+
+ private:
+  MipsInstr& Append(MipsOp op) {
+    instrs_.emplace_back(op);
+    return instrs_.back();
+  }
+
+  std::vector<MipsInstr> instrs_;
+  int num_labels_ = 0;
+};
+
+}  // namespace cool
@@ -0,0 +1,70 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/**
+ * @file
+ *
+ * @brief Parallel loops for the phases that process independent classes or methods
+ */
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace cool {
+
+/// Number of threads of the parallel phases (-j), 0 for one per hardware thread
+extern int gNumThreads;
+
+/// Number of threads ParallelFor runs on, at least 1
+std::size_t NumThreads();
+
+/**
+ * @brief Call \p fn for each index in [0, \p n) on up to NumThreads() threads
+ *
+ * The calling thread is one of the threads. Indices are handed out in increasing order, but may
+ * complete in any order, so \p fn must only write state owned by its index, e.g. an element of a
+ * vector of results that the caller then combines in index order. Returns once all calls have
+ * completed, rethrowing the first exception thrown by \p fn, if any.
+ *
+ * Example usage:
+ * \code{.cpp}
+ * std::vector<std::string> text(codes.size());
+ * ParallelFor(codes.size(), [&](std::size_t i) { text[i] = Print(codes[i]); });
+ * for (auto& t : text) os << t;
+ * \endcode
+ */
+void ParallelFor(std::size_t n, const std::function<void(std::size_t)>& fn);
+
+}  // namespace cool
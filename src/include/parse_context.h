@@ -0,0 +1,130 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/**
+ * @file
+ *
+ * @brief State of the reentrant Cool lexer and parser for one source file
+ */
+#pragma once
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#include "ast_fwd.h"
+
+union YYSTYPE;
+
+namespace cool {
+
+/**
+ * @brief Lexer and parser state for one source file
+ *
+ * The lexer and parser keep all of their state in the context instead of in global variables, so
+ * different files can be lexed and parsed concurrently on different threads, each with its own
+ * context (and ASTContext, as the AST is allocated by the calling thread).
+ *
+ * Example usage:
+ * \code{.cpp}
+ * ParseContext context(filename);
+ * context.err = &errors;  // Buffer the errors instead of writing them to std::cerr
+ * cool_yy_scan_in_place(&context, base, size);
+ * cool_yyparse(&context);
+ * cool_yy_scan_end(&context);
+ * \endcode
+ */
+struct ParseContext {
+  explicit ParseContext(const char* filename) : filename(filename) {}
+
+  ParseContext(const ParseContext&) = delete;
+  ParseContext& operator=(const ParseContext&) = delete;
+
+  /// Lexing and parsing of a file stop after this many errors
+  static constexpr int kMaxErrors = 50;
+
+  const char* filename;          ///< Path to the file being lexed/parsed
+  SourceLoc line_no = 1;         ///< Line number of the current line read from the input
+  Program* program = nullptr;    ///< The result of the parsing
+  std::ostream* err = &std::cerr;  ///< Where lexing and parsing errors are reported
+  int errors = 0;                ///< Number of lexing and parsing errors
+
+  /**
+   * @name Lexer state
+   * @{
+   */
+  void* scanner = nullptr;         ///< Reentrant flex scanner (a yyscan_t)
+  std::istream* input = nullptr;   ///< Stream being lexed, unless lexing in place
+  bool scanning_in_place = false;  ///< True if the input was selected by cool_yy_scan_in_place
+  std::string string_buf;          ///< Buffer for assembling string constants
+  int comment_depth = 0;           ///< Nesting depth of the current comment
+  bool null_char_flag = false;     ///< True if the current string constant contains a NUL
+  //@}
+
+  /**
+   * @name Most recent token read by the parser, reported with parse errors
+   * @{
+   */
+  int token = 0;
+  const YYSTYPE* token_value = nullptr;
+  //@}
+};
+
+}  // namespace cool
+
+/**
+ * @name Lexer entry points (see pa2/cool.flex)
+ * @{
+ */
+
+/// Lex from \p input, discarding anything remaining from the previous input of \p context
+void cool_yy_scan_stream(cool::ParseContext* context, std::istream* input);
+
+/**
+ * @brief Lex the \p size bytes starting at \p base in place, without copying them into a flex buffer
+ *
+ * base[size] and base[size + 1] must be NUL, and base must remain valid (and writable, flex
+ * temporarily NUL-terminates each token) until the next input is selected.
+ */
+void cool_yy_scan_in_place(cool::ParseContext* context, char* base, std::size_t size);
+
+/// Release \p context's scanner and any buffered input
+void cool_yy_scan_end(cool::ParseContext* context);
+
+/// Lex the next token of \p context's input, returning the token and setting \p lval to its value
+int cool_yylex(YYSTYPE* lval, cool::ParseContext* context);
+//@}
+
+/// Parse \p context's input into context->program, returning non-zero if the parse was aborted
+int cool_yyparse(cool::ParseContext* context);
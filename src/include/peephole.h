@@ -0,0 +1,107 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/**
+ * @file
+ *
+ * @brief Peephole optimization of the lowered MIPS code
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "mips.h"
+
+namespace cool {
+
+/// Rewrite rules of the peephole optimizer
+enum class PeepholeRule : std::uint8_t {
+  kStoreLoad,      // lw from the address just stored to
+  kPushPop,        // Operand pushed and popped with no call or stack access in between
+  kStackAdjust,    // Consecutive adjustments of $sp
+  kRedundantMove,  // move to itself, or back to the register just copied from
+  kDeadWrite,      // Register overwritten by the next instruction before being read
+};
+
+constexpr std::size_t kNumPeepholeRules = static_cast<std::size_t>(PeepholeRule::kDeadWrite) + 1;
+
+/**
+ * @brief Windowed peephole optimizer
+ *
+ * The instructions are appended one at a time to the optimized code and the rules are matched
+ * against its last few instructions, so that the code left by one rewrite can be matched again
+ * (e.g. the stack adjustments left by a push and pop can then be collapsed). No rule matches across
+ * a label definition, and the push and pop rule gives up at any jump, branch or access to the
+ * stack. The optimizer counts the rewrites of each rule over all the code it has run on.
+ *
+ * Example usage:
+ * \code{.cpp}
+ * PeepholeOptimizer peephole;
+ * peephole.Run(code);
+ * std::size_t hits = peephole.hits(PeepholeRule::kStoreLoad);
+ * \endcode
+ */
+class PeepholeOptimizer {
+ public:
+  /// Rewrite \p code in place until no rule applies
+  void Run(MipsCode& code);
+
+  /// Number of rewrites by \p rule so far
+  std::size_t hits(PeepholeRule rule) const { return hits_[static_cast<std::size_t>(rule)]; }
+
+  /// Add the rewrites counted by \p other, e.g. an optimizer run on another thread
+  void Merge(const PeepholeOptimizer& other);
+
+  /// Name of \p rule for the report
+  static const char* RuleName(PeepholeRule rule);
+
+ private:
+  // Apply at most one rule to the end of code, returns true if it changed
+  bool Rewrite(std::vector<MipsInstr>& code);
+
+  bool RewriteStoreLoad(std::vector<MipsInstr>& code);
+  bool RewritePushPop(std::vector<MipsInstr>& code);
+  bool RewriteStackAdjust(std::vector<MipsInstr>& code);
+  bool RewriteRedundantMove(std::vector<MipsInstr>& code);
+  bool RewriteDeadWrite(std::vector<MipsInstr>& code);
+
+  void Hit(PeepholeRule rule) { hits_[static_cast<std::size_t>(rule)]++; }
+
+  std::array<std::size_t, kNumPeepholeRules> hits_{};
+};
+
+}  // namespace cool
@@ -0,0 +1,124 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/**
+ * @file
+ *
+ * @brief Linear-scan register allocation for the values of a method body
+ */
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "ast_fwd.h"
+
+namespace cool {
+
+/**
+ * @brief Linear-scan register allocator
+ *
+ * The values to allocate are the let and case variables, formals and intermediate operands of a
+ * method body, identified by the AST node that introduces them and an index among the values of
+ * that node, such as the arguments of a dispatch. A pass over the body, in the order
+ * the code is generated, reports the live interval of each value with Begin and End, after which
+ * Allocate assigns the registers. The intervals of a tree walk nest, so when the registers run out
+ * the value whose interval ends last is spilled (Poletto and Sarkar, "Linear Scan Register
+ * Allocation"). Spilled values have no register and keep their place in the frame or on the stack.
+ *
+ * Each value has a weight, the memory accesses a register would save, and values lighter than the
+ * minimum weight are not worth saving and restoring a callee-saved register for.
+ *
+ * Example usage:
+ * \code{.cpp}
+ * RegisterAllocator regs({"$s1", "$s2"});
+ * regs.Begin(let);
+ * ...  // Intervals of the let body
+ * regs.End(let);
+ * regs.Allocate();
+ * Register reg = regs.Find(let);  // kNullRegister if spilled
+ * \endcode
+ */
+class RegisterAllocator {
+ public:
+  /**
+   * @brief Construct an allocator
+   *
+   * @param registers Registers to allocate, assigned in that order of preference
+   * @param min_weight Minimum weight of a value to be allocated a register
+   */
+  explicit RegisterAllocator(std::vector<Register> registers, int min_weight = 0)
+      : registers_(std::move(registers)), min_weight_(min_weight) {}
+
+  /// Open the live interval of value \p index of \p node at the current position
+  void Begin(const ASTNode* node, int index = 0);
+
+  /// Close the live interval of value \p index of \p node at the current position
+  void End(const ASTNode* node, int index = 0);
+
+  /// Add \p weight to value \p index of \p node, whose interval must have begun
+  void AddWeight(const ASTNode* node, int weight, int index = 0);
+
+  /// Assign registers to all intervals, which must all have been closed
+  void Allocate();
+
+  /// Register assigned to value \p index of \p node, kNullRegister if it was spilled or never seen
+  Register Find(const ASTNode* node, int index = 0) const;
+
+  /// Registers assigned to at least one value, in order of preference
+  const std::vector<Register>& used() const { return used_; }
+
+  /// Number of values spilled for lack of registers
+  std::size_t num_spilled() const { return num_spilled_; }
+
+ private:
+  struct Interval {
+    std::size_t start;
+    std::size_t end;
+    int weight;
+    Register reg;
+  };
+
+  std::vector<Register> registers_;
+  int min_weight_;
+  std::vector<Interval> intervals_;  // Ordered by start
+  std::map<std::pair<const ASTNode*, int>, std::size_t> index_;
+  std::size_t position_ = 0;
+  std::vector<Register> used_;
+  std::size_t num_spilled_ = 0;
+};
+
+}  // namespace cool
@@ -41,8 +41,10 @@ limitations under the License.
 
 #include <stdexcept>
 #include <forward_list>
+#include <memory>
 #include <unordered_map>
 #include <string>
+#include <vector>
 #include <iostream>
 #include <type_traits>
 
@@ -174,4 +176,277 @@ namespace cool {
    private:
     ScopeStack scopes_;
   };
+
+  /**
+   * @brief Persistent (structure-sharing) variant of ScopedTable
+   *
+   * Scopes form a linked list from the current scope to the outermost scope. Copying the table
+   * copies just the pointer to the current scope, so the copy shares all of its scopes with the
+   * original, e.g. a derived class's table can extend its parent's table without duplicating the
+   * inherited scopes. A shared scope is only copied (on its own, not the scopes beneath it) if
+   * either table subsequently adds to it. Otherwise the interface and semantics match ScopedTable.
+   *
+   * Example usage extending a parent table:
+   * \code{.cpp}
+   * PersistentScopedTable<Symbol*,Symbol*> child_table(parent_table);  // Constant time
+   * child_table.EnterScope();
+   * child_table.AddToScope(name, type);  // Does not modify parent_table
+   * \endcode
+   *
+   * @tparam Key
+   * @tparam Value
+   */
+  template<class Key, class Value>
+  class PersistentScopedTable {
+    static_assert(std::is_pointer<Value>::value == true,  "ScopedTable Value must be a pointer type");
+
+    struct Scope {
+      std::unordered_map<Key, Value> entries;
+      std::shared_ptr<const Scope> next;  // Enclosing scope
+
+      explicit Scope(std::shared_ptr<const Scope> next) : next(std::move(next)) {}
+    };
+
+   public:
+    typedef Key key_type;
+    typedef Value value_type;
+
+    PersistentScopedTable() = default;
+
+    /**
+     * @brief Copy constructor, shares all scopes with \p other
+     * @param Other ScopedTable to copy
+     */
+    PersistentScopedTable(const PersistentScopedTable& other) = default;
+    PersistentScopedTable& operator=(const PersistentScopedTable& other) = default;
+
+    /// Push new scope onto the stack
+    void EnterScope() { top_ = std::make_shared<Scope>(std::move(top_)); }
+
+    /// Pop current scope off the stack
+    void ExitScope() {
+      if (top_)
+        top_ = top_->next;
+    }
+
+    /**
+     * @brief Add key and value to current scope on top of the stack
+     *
+     * Will create new scope if one does not currently exist. Will throw std::invalid_argument
+     * if key already exists in scope.
+     *
+     * @param key Key
+     * @param value Associated value
+     * @return Value Non-owning pointer to \p value
+     */
+    Value AddToScope(const Key& key, Value value) {
+      if (!top_) {
+        EnterScope();
+      } else if (top_.use_count() > 1) {
+        // Current scope is shared with another table, copy before modifying
+        top_ = std::make_shared<Scope>(*top_);
+      }
+      // Only this table references the current scope so it is safe to modify
+      auto r = const_cast<Scope&>(*top_).entries.emplace(key, value);
+      if (!r.second) {
+        throw std::invalid_argument("key already exists in scope");
+      }
+      return r.first->second;
+    }
+
+    /**
+     * @brief Return value associated key in nearest scope (examining all scopes)
+     *
+     * @param key Key to lookup
+     * @return Value  Non-owning pointer to value or nullptr if not present in any scope
+     */
+    Value Lookup(const Key& key) const {
+      for (const Scope* scope = top_.get(); scope; scope = scope->next.get()) {
+        auto found = scope->entries.find(key);
+        if (found != scope->entries.end())
+          return found->second;
+      }
+      return nullptr;
+    }
+
+    /**
+     * @brief Return value associated key in current scope
+     *
+     * @param key Key to lookup
+     * @return Value Non-owning pointer to value or nullptr if not present in current scope
+     */
+    Value Probe(const Key& key) const {
+      if (top_) {
+        auto found = top_->entries.find(key);
+        if (found != top_->entries.end())
+          return found->second;
+      }
+      return nullptr;
+    }
+
+    /**
+     * @brief Dump scoped to output stream
+     *
+     * Output is in search order, with scopes separated by dashed lines (see ScopedTable)
+     *
+     * @param os
+     * @param s
+     * @return std::ostream&
+     */
+    friend std::ostream& operator<<(std::ostream& os, const PersistentScopedTable& s) {
+      auto seperator = std::string(20, '-');
+      os << seperator << std::endl;
+      for (const Scope* scope = s.top_.get(); scope; scope = scope->next.get()) {
+        for (const auto& entry : scope->entries) {
+            os << entry.first << ": " << *entry.second << std::endl;
+        }
+        os << seperator << std::endl;
+      }
+      return os;
+    }
+
+   private:
+    std::shared_ptr<const Scope> top_;  // Current (innermost) scope
+  };
+
+  /**
+   * @brief Flat (undo-log) variant of ScopedTable
+   *
+   * All scopes share a single hash map from key to the index of the innermost binding in a log of
+   * all active bindings. Each binding records the index of the binding it shadows, so that
+   * ExitScope can roll back the bindings added since the matching EnterScope. Lookup is therefore
+   * a single probe regardless of nesting depth, and EnterScope/ExitScope do not allocate (once the
+   * table has reached its high water mark). Keys are never erased from the map, leaving unused keys
+   * mapped to a sentinel, so re-binding a key in a later scope doesn't allocate either.
+   *
+   * Otherwise the interface and semantics match ScopedTable, with the exception that operator<<
+   * reports the entries in a scope in reverse insertion order.
+   *
+   * @tparam Key
+   * @tparam Value
+   */
+  template<class Key, class Value>
+  class FlatScopedTable {
+    static_assert(std::is_pointer<Value>::value == true,  "ScopedTable Value must be a pointer type");
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    struct Binding {
+      Key key;
+      Value value;
+      std::size_t shadowed;  // Index of the binding for key in an enclosing scope (or npos)
+    };
+
+   public:
+    typedef Key key_type;
+    typedef Value value_type;
+
+    FlatScopedTable() = default;
+
+    /**
+     * @brief Copy constructor
+     * @param Other ScopedTable to copy
+     */
+    FlatScopedTable(const FlatScopedTable& other) = default;
+
+    /// Push new scope onto the stack
+    void EnterScope() { scope_starts_.push_back(bindings_.size()); }
+
+    /// Pop current scope off the stack
+    void ExitScope() {
+      if (scope_starts_.empty())
+        return;
+      for (std::size_t start = scope_starts_.back(); bindings_.size() > start; bindings_.pop_back()) {
+        const Binding& binding = bindings_.back();
+        index_.find(binding.key)->second = binding.shadowed;
+      }
+      scope_starts_.pop_back();
+    }
+
+    /**
+     * @brief Add key and value to current scope on top of the stack
+     *
+     * Will create new scope if one does not currently exist. Will throw std::invalid_argument
+     * if key already exists in scope.
+     *
+     * @param key Key
+     * @param value Associated value
+     * @return Value Non-owning pointer to \p value
+     */
+    Value AddToScope(const Key& key, Value value) {
+      if (scope_starts_.empty()) {
+        EnterScope();
+      }
+      auto found = index_.find(key);
+      if (found == index_.end()) {
+        found = index_.emplace(key, npos).first;
+      }
+      std::size_t& innermost = found->second;
+      if (innermost != npos && innermost >= scope_starts_.back()) {
+        throw std::invalid_argument("key already exists in scope");
+      }
+      bindings_.push_back(Binding{key, value, innermost});
+      innermost = bindings_.size() - 1;
+      return value;
+    }
+
+    /**
+     * @brief Return value associated key in nearest scope (examining all scopes)
+     *
+     * @param key Key to lookup
+     * @return Value  Non-owning pointer to value or nullptr if not present in any scope
+     */
+    Value Lookup(const Key& key) const {
+      auto found = index_.find(key);
+      if (found != index_.end() && found->second != npos)
+        return bindings_[found->second].value;
+      return nullptr;
+    }
+
+    /**
+     * @brief Return value associated key in current scope
+     *
+     * @param key Key to lookup
+     * @return Value Non-owning pointer to value or nullptr if not present in current scope
+     */
+    Value Probe(const Key& key) const {
+      if (!scope_starts_.empty()) {
+        auto found = index_.find(key);
+        if (found != index_.end() && found->second != npos && found->second >= scope_starts_.back())
+          return bindings_[found->second].value;
+      }
+      return nullptr;
+    }
+
+    /**
+     * @brief Dump scoped to output stream
+     *
+     * Output is in search order, with scopes separated by dashed lines (see ScopedTable)
+     *
+     * @param os
+     * @param s
+     * @return std::ostream&
+     */
+    friend std::ostream& operator<<(std::ostream& os, const FlatScopedTable& s) {
+      auto seperator = std::string(20, '-');
+      os << seperator << std::endl;
+      std::size_t end = s.bindings_.size();
+      for (auto start = s.scope_starts_.rbegin(); start != s.scope_starts_.rend(); ++start) {
+        for (; end > *start; end--) {
+            const Binding& binding = s.bindings_[end - 1];
+            os << binding.key << ": " << *binding.value << std::endl;
+        }
+        os << seperator << std::endl;
+      }
+      return os;
+    }
+
+   private:
+    std::unordered_map<Key, std::size_t> index_;  // Key to index of innermost binding in bindings_
+    std::vector<Binding> bindings_;  // Undo log of active bindings, from outermost to innermost
+    std::vector<std::size_t> scope_starts_;  // Index in bindings_ of the first binding in each scope
+  };
+
+  template<class Key, class Value>
+  constexpr std::size_t FlatScopedTable<Key, Value>::npos;
 }
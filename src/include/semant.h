@@ -52,6 +52,9 @@ limitations under the License.
 #define VISITING 1
 #define VISITED 2
 
+/// Switch for type checking the classes on multiple threads (-j)
+extern bool semant_parallel;
+
 namespace cool {
 
 /**
@@ -65,10 +68,12 @@ namespace cool {
  *  -# Pass 2: Build symbol tables for each class. This step is done separately because methods and
  * attributes have global scope; therefore, bindings for all methods and attributes must be known
  * before type checking can be done.
- *  -# Pass 3: Traverse the inheritance graph (which is known to be a tree if there are no cycles),
- * starting from the root class Object. For each class, typecheck each attribute and method.
- * Simultaneously, check identifiers for correct definition/use and for multiple definitions.
- * All parents of a class are checked before a class is checked.
+ *  -# Pass 3: For each class, typecheck each attribute and method. Simultaneously, check
+ * identifiers for correct definition/use and for multiple definitions. The classes are checked
+ * in the order of a traversal of the inheritance graph (which is known to be a tree if there are
+ * no cycles) starting from the root class Object, so that all parents of a class are checked
+ * before the class. With semant_parallel, the classes are checked concurrently (see ParallelFor),
+ * and the errors are reported in the same order.
  *
  * @param program Root of the AST
  */
@@ -150,6 +155,17 @@ class SemantError {
   }
   // @}
 
+  /**
+   * @brief Report the errors of another reporter, e.g. of a class checked on another thread
+   *
+   * @param messages Messages printed by the other reporter
+   * @param errors Number of errors reported by the other reporter
+   */
+  void Report(const std::string& messages, std::size_t errors) {
+    os_ << messages;
+    errors_ += errors;
+  }
+
  private:
   std::ostream& os_;
   std::size_t errors_;
@@ -170,6 +186,7 @@ class SemantNode : public InheritanceNode<SemantNode> {
 
     private:
         friend class SemantKlassTable;
+        friend class SemantEnv;
         friend class Ref;
         friend class Assign;
         friend class Let;
@@ -178,8 +195,12 @@ class SemantNode : public InheritanceNode<SemantNode> {
         friend class Dispatch;
         friend class StaticDispatch; 
         int track_visit_ = UNVISITED; // {UNVISITED, VISITING, VISITED}
-        ScopedTable<Symbol *, Method *> mtable_; // method-scoped-table of the klass represented by this SemantNode. Storing all the methods defined in this klass.
-        ScopedTable<Symbol *, Symbol *> otable_; // object-scoped-table of the klass represented by this SemantNode. Storing all the attributes defined in this klass.
+        std::size_t tag_ = 0; // preorder number of this klass in the inheritance tree
+        std::size_t next_sib_tag_ = 0; // one past the largest tag_ among this klass' descendants
+        std::size_t depth_ = 0; // distance from the root klass Object
+        std::size_t euler_index_ = 0; // index of the first visit to this klass in the Euler tour
+        PersistentScopedTable<Symbol *, Method *> mtable_; // method-scoped-table of the klass represented by this SemantNode. Storing all the methods defined in this klass. Shares the parent klass' scopes.
+        PersistentScopedTable<Symbol *, Symbol *> otable_; // object-scoped-table of the klass represented by this SemantNode. Storing all the attributes defined in this klass. Shares the parent klass' scopes.
 };
 
 /// Class table for use in semantic analysis
@@ -196,7 +217,10 @@ class SemantKlassTable : public KlassTable<SemantNode> {
         void make_all_sctables(SemantNode *klass_node);
 
         void Typecheck_all();
-        void Typecheck_subgraph(SemantNode *klass_node);
+        void Typecheck_klass(SemantNode *klass_node, SemantError &error);
+
+        void AssignAllTags();
+        void AssignTag(SemantNode *klass_node, std::size_t &val);
 
         bool SNLE(SemantNode *klass_node_1, SemantNode *klass_node_2);
         SemantNode *SNLUB(SemantNode *klass_node_1, SemantNode *klass_node_2);
@@ -205,6 +229,13 @@ class SemantKlassTable : public KlassTable<SemantNode> {
         /// Semantic error reporting class
         SemantError& error_;
 
+        /// Euler tour of the inheritance tree, i.e. each klass followed by each child subtree and then the klass again
+        std::vector<SemantNode *> euler_;
+        /// lca_table_[k][i] is the shallowest klass in euler_[i, i + 2^k), i.e. a sparse table for range-minimum queries
+        std::vector<std::vector<SemantNode *>> lca_table_;
+        /// floor_log2_[n] is floor(log2(n)), the lca_table_ level for a query over n entries of the tour
+        std::vector<std::size_t> floor_log2_;
+
 };
 
 // Implement your semantic environment here
@@ -213,11 +244,15 @@ class SemantEnv {
     SemantKlassTable *klass_table;
     SemantNode *curr_semant_node;
     SemantError &error_env;
+    // object-scoped-table for the self, formal, let and case bindings in the feature being checked.
+    // The scopes are entered and exited constantly, the klass' attributes are in curr_semant_node->otable_
+    FlatScopedTable<Symbol *, Symbol *> local_otable;
 
     SemantEnv(SemantKlassTable *klass_table_arg,
               SemantNode *curr_semant_node_arg,
               SemantError &error_env_arg);
 
+    Symbol *LookupObject(Symbol *name) const;
     bool type_LE(Symbol *type1, Symbol *type2);
     Symbol *type_LUB(Symbol *type1, Symbol *type2);
 };
@@ -43,12 +43,20 @@ limitations under the License.
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <iosfwd>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <string>
-#include <unordered_map>
+#include <type_traits>
+#include <unordered_set>
 #include <vector>
 
+#include "arena.h"
+
 namespace cool {
 
 class StringEntry;
@@ -69,10 +77,131 @@ class StringRef {
   StringRef(const StringEntry*);
 
   std::size_t size() const { return length_; }
+  bool empty() const { return length_ == 0; }
 
   const char* data() const { return data_; }
 
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + length_; }
+
+  /// Copy referenced string into a std::string
+  std::string str() const { return std::string(data_, length_); }
+  operator std::string() const { return str(); }
+
   bool operator==(const StringRef& rhs) const;
+  bool operator!=(const StringRef& rhs) const { return !(*this == rhs); }
+
+  friend std::ostream& operator<<(std::ostream& os, const StringRef& s);
+};
+
+/**
+ * @brief Hash \p length bytes starting at \p data
+ *
+ * Processes the input a word (8 bytes) at a time, finishing with the MurmurHash3 64-bit mixer so
+ * that the low bits (used to index the SymbolTable) depend on every input byte.
+ */
+inline std::size_t HashBytes(const char* data, std::size_t length) {
+  const uint64_t kMul = 0x9ddfea08eb382d69ULL;
+  uint64_t hash = length * kMul;
+  uint64_t word;
+  for (; length >= sizeof(word); data += sizeof(word), length -= sizeof(word)) {
+    std::memcpy(&word, data, sizeof(word));
+    hash = (hash ^ word) * kMul;
+    hash ^= hash >> 47;
+  }
+  if (length > 0) {
+    word = 0;
+    std::memcpy(&word, data, length);
+    hash = (hash ^ word) * kMul;
+    hash ^= hash >> 47;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return static_cast<std::size_t>(hash);
+}
+
+/**
+ * @name SymbolTable key hashes
+ * @{
+ */
+inline std::size_t HashKey(const StringRef& key) { return HashBytes(key.data(), key.size()); }
+
+inline std::size_t HashKey(int32_t key) {
+  uint64_t hash = static_cast<uint32_t>(key);
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  return static_cast<std::size_t>(hash);
+}
+//@}
+
+/**
+ * @brief Order in which a thread interned new entries, for assigning them deterministic ids
+ *
+ * SymbolTable entries are normally assigned ids in the order they are created, which for threads
+ * interning concurrently (e.g. the parsers of different files) depends on the scheduling. While an
+ * InternLog::Scope is active on a thread, the new entries interned by that thread (or found while
+ * still waiting for an id) are instead recorded in the log, and assigned their ids by AssignIds
+ * once all of the threads have finished. Calling AssignIds for the logs in a fixed order, e.g.
+ * that of the input files, assigns the same ids as interning serially in that order. Entries are
+ * not iterated or counted by their table until they have an id. All of the threads interning
+ * concurrently should use an InternLog, as a thread without one doesn't assign ids to the entries
+ * it finds that are waiting for one.
+ *
+ * Example usage:
+ * \code{.cpp}
+ * std::vector<InternLog> logs(files.size());
+ * ParallelFor(files.size(), [&](std::size_t i) {
+ *   InternLog::Scope scope(logs[i]);
+ *   Parse(files[i]);
+ * });
+ * for (auto& log : logs) log.AssignIds();
+ * \endcode
+ */
+class InternLog {
+ public:
+  /// Assign ids to the recorded entries that don't have one yet, in the order they were recorded
+  void AssignIds() {
+    for (auto& record : records_) {
+      record.assign(record.table, record.entry);
+    }
+    records_.clear();
+    recorded_.clear();
+  }
+
+  /// Number of entries recorded since the last AssignIds
+  std::size_t size() const { return records_.size(); }
+
+  /// Log of the innermost active Scope on the calling thread, or nullptr if there is none
+  static InternLog* Current();
+
+  /// Record the entries interned by the calling thread in \p log for the lifetime of the Scope
+  class Scope {
+   public:
+    explicit Scope(InternLog& log);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    InternLog* previous_;
+  };
+
+ private:
+  template <class Elem>
+  friend class SymbolTable;
+
+  struct Record {
+    void (*assign)(void* table, void* entry);
+    void* table;
+    void* entry;
+  };
+  std::vector<Record> records_;
+  std::unordered_set<const void*> recorded_;  // Entries in records_, each is recorded only once
 };
 
 /**
@@ -80,19 +209,38 @@ class StringRef {
  *
  * Maintains a single instance of \p Elem objects, e.g. of each identifier or string literal.
  *
+ * The table is split into shards by the high bits of the hash, each an open addressing table with
+ * linear probing (indexed by the low bits). Each slot stores the entry's hash alongside the pointer
+ * so that probing rarely touches the entries themselves and growing the table never re-hashes the
+ * keys. The entries (and for strings, their characters) are bump-allocated in an Arena owned by
+ * their shard, so pointers to entries remain valid for the lifetime of the table.
+ *
+ * emplace can be called concurrently from multiple threads, e.g. by the lexers and parsers of
+ * different files. New entries are inserted under their shard's lock, while lookups (including
+ * emplace of an existing entry) don't lock, so interning mostly-repeated identifiers doesn't
+ * contend. Iterating the table, and InternLog::AssignIds, must not be concurrent with emplace.
+ *
  * @tparam Elem
  */
 template <class Elem>
 class SymbolTable {
   typedef typename Elem::KeyType Key;
-  typedef std::unordered_map<Key, std::unique_ptr<Elem>> TableType;
+  typedef typename Elem::IdType IdType;
+  typedef std::vector<Elem*> EntriesType;
+
+  static_assert(std::is_trivially_destructible<Elem>::value,
+                "SymbolTable entries are allocated in an Arena and never destroyed");
 
  public:
-  typedef typename TableType::key_type key_type;
-  typedef typename TableType::mapped_type mapped_type;
-  typedef typename TableType::value_type value_type;
-  typedef typename TableType::size_type size_type;
-  typedef typename TableType::const_iterator const_iterator;
+  typedef Key key_type;
+  typedef Elem* value_type;
+  typedef typename EntriesType::size_type size_type;
+  typedef typename EntriesType::const_iterator const_iterator;
+
+  SymbolTable() = default;
+
+  SymbolTable(const SymbolTable&) = delete;
+  SymbolTable& operator=(const SymbolTable&) = delete;
 
   /**
    * @brief Query if key present in table
@@ -101,7 +249,7 @@ class SymbolTable {
    * @return true Elment in table
    * @return false Elment in table
    */
-  bool has(const Elem* elem) const { return entries_.find(elem->key()) != entries_.end(); }
+  bool has(const Elem* elem) const { return Find(elem->key(), elem->hash()) != nullptr; }
   
   /**
    * @brief Query if key present in table
@@ -110,7 +258,7 @@ class SymbolTable {
    * @return true Elment in table
    * @return false Elment in table
    */
-  bool has(Elem* elem) const { return entries_.find(elem->key()) != entries_.end(); }
+  bool has(Elem* elem) const { return Find(elem->key(), elem->hash()) != nullptr; }
 
   /**
    * @brief Query if key present in table
@@ -122,7 +270,8 @@ class SymbolTable {
    */
   template <class... Args>
   bool has(Args&&... args) const {
-    return entries_.find(Key(std::forward<Args>(args)...)) != entries_.end();
+    Key key(std::forward<Args>(args)...);
+    return Find(key, HashKey(key)) != nullptr;
   }
 
   /**
@@ -135,34 +284,170 @@ class SymbolTable {
    */
   template <class... Args>
   Elem* lookup(Args&&... args) const {
-    auto r = entries_.find(Key(std::forward<Args>(args)...));
-    return (r != entries_.end()) ? r->second.get() : nullptr;
+    Key key(std::forward<Args>(args)...);
+    return Find(key, HashKey(key));
   }
 
   /**
    * @brief Emplace element constructed from args in table
    *
+   * New elements are assigned the next id, unless an InternLog::Scope is active on the calling
+   * thread, in which case they are assigned an id by InternLog::AssignIds.
+   *
    * @tparam Args Types of \p Elem constructor arguments
    * @param args Arguments to forward to create \p Elem
    * @return Elem* Non-owned pointer to newly created or existing element
    */
   template <class... Args>
   Elem* emplace(Args&&... args) {
-    auto found = entries_.find(Key(std::forward<Args>(args)...));
-    if (found == entries_.end()) {
-      // Can't use make_unique because Elem constructor is not public
-      std::unique_ptr<Elem> entry(new Elem(entries_.size(), std::forward<Args>(args)...));
-      found = entries_.emplace(entry->key(), std::move(entry)).first;
+    Key key(std::forward<Args>(args)...);
+    std::size_t hash = HashKey(key);
+    Shard& shard = shards_[ShardIndex(hash)];
+    Elem* entry = Find(shard.slots.load(std::memory_order_acquire), key, hash);
+    if (!entry) {
+      entry = Insert(shard, key, hash);
+    } else if (entry->id_ == kPendingId) {
+      Record(entry);  // Created by another thread, the first use on this thread determines its id
     }
-    return found->second.get();
+    return entry;
   }
 
   size_type size() const { return entries_.size(); }
+
+  /**
+   * @name Iterators
+   * Iterate through the entries (as Elem*) in order of their ids
+   * @{
+   */
   const_iterator begin() const { return entries_.begin(); }
   const_iterator end() const { return entries_.end(); }
+  //@}
 
  private:
-  TableType entries_;
+  static constexpr std::size_t kShardBits = 4;
+  static constexpr std::size_t kInitialCapacity = 16;  // Per shard, must be a power of 2
+  static constexpr std::size_t kArenaBlockSize = 16 * 1024;
+  static constexpr IdType kPendingId = ~IdType(0);  // Entry is waiting for InternLog::AssignIds
+
+  struct Slot {
+    std::atomic<std::size_t> hash{0};
+    std::atomic<Elem*> entry{nullptr};  // nullptr if slot is empty
+  };
+
+  struct Slots {
+    explicit Slots(std::size_t capacity) : mask(capacity - 1), slots(new Slot[capacity]) {}
+    std::size_t mask;
+    std::unique_ptr<Slot[]> slots;
+  };
+
+  struct Shard {
+    Shard() : arena(kArenaBlockSize) {
+      tables.emplace_back(new Slots(kInitialCapacity));
+      slots.store(tables.back().get(), std::memory_order_relaxed);
+    }
+
+    std::atomic<Slots*> slots;  // Current slots, replaced when the shard grows
+    std::vector<std::unique_ptr<Slots>> tables;  // Current and previous slots, the latter may still be probed by lookups
+    std::size_t size = 0;
+    std::mutex mutex;  // Serializes insertion
+    Arena arena;
+  };
+
+  Shard shards_[std::size_t(1) << kShardBits];
+  EntriesType entries_;
+  std::mutex entries_mutex_;  // Serializes assigning ids (outside of an InternLog)
+
+  static std::size_t ShardIndex(std::size_t hash) {
+    return hash >> (sizeof(std::size_t) * 8 - kShardBits);
+  }
+
+  static Elem* Find(const Slots* slots, const Key& key, std::size_t hash) {
+    for (std::size_t i = hash & slots->mask;; i = (i + 1) & slots->mask) {
+      const Slot& slot = slots->slots[i];
+      Elem* entry = slot.entry.load(std::memory_order_acquire);
+      if (!entry || (slot.hash.load(std::memory_order_relaxed) == hash && entry->key() == key)) {
+        return entry;
+      }
+    }
+  }
+
+  Elem* Find(const Key& key, std::size_t hash) const {
+    return Find(shards_[ShardIndex(hash)].slots.load(std::memory_order_acquire), key, hash);
+  }
+
+  Elem* Insert(Shard& shard, const Key& key, std::size_t hash) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    Slots* slots = shard.slots.load(std::memory_order_relaxed);
+    if (Elem* entry = Find(slots, key, hash)) {
+      // Inserted by another thread since the lookup
+      if (entry->id_ == kPendingId) {
+        Record(entry);
+      }
+      return entry;
+    }
+
+    if ((shard.size + 1) * 2 > slots->mask + 1) {  // Keep the load factor below 1/2
+      slots = Grow(shard);
+    }
+    // Entries and their keys are allocated in the shard's arena, and freed with it
+    Elem* entry = new (shard.arena.Allocate(sizeof(Elem), alignof(Elem)))
+        Elem(kPendingId, hash, Elem::Intern(shard.arena, key));
+    if (InternLog::Current()) {
+      Record(entry);
+    } else {
+      std::lock_guard<std::mutex> entries_lock(entries_mutex_);
+      AssignId(entry);
+    }
+
+    // Publish the entry (after initializing it) to lookups
+    std::size_t i = hash & slots->mask;
+    while (slots->slots[i].entry.load(std::memory_order_relaxed)) {
+      i = (i + 1) & slots->mask;
+    }
+    slots->slots[i].hash.store(hash, std::memory_order_relaxed);
+    slots->slots[i].entry.store(entry, std::memory_order_release);
+    shard.size++;
+    return entry;
+  }
+
+  Slots* Grow(Shard& shard) {
+    const Slots* old_slots = shard.slots.load(std::memory_order_relaxed);
+    Slots* slots = new Slots((old_slots->mask + 1) * 2);
+    shard.tables.emplace_back(slots);
+    for (std::size_t j = 0; j <= old_slots->mask; j++) {
+      const Slot& slot = old_slots->slots[j];
+      if (Elem* entry = slot.entry.load(std::memory_order_relaxed)) {
+        std::size_t hash = slot.hash.load(std::memory_order_relaxed);
+        std::size_t i = hash & slots->mask;
+        while (slots->slots[i].entry.load(std::memory_order_relaxed)) {
+          i = (i + 1) & slots->mask;
+        }
+        slots->slots[i].hash.store(hash, std::memory_order_relaxed);
+        slots->slots[i].entry.store(entry, std::memory_order_relaxed);
+      }
+    }
+    shard.slots.store(slots, std::memory_order_release);
+    return slots;
+  }
+
+  void AssignId(Elem* entry) {
+    if (entry->id_ == kPendingId) {
+      entry->id_ = entries_.size();
+      entries_.push_back(entry);
+    }
+  }
+
+  /// Record the entry in the calling thread's log, if any and if the log doesn't have it already
+  void Record(Elem* entry) {
+    InternLog* log = InternLog::Current();
+    if (log && log->recorded_.insert(entry).second) {
+      log->records_.push_back({&SymbolTable::AssignPendingId, this, entry});
+    }
+  }
+
+  static void AssignPendingId(void* table, void* entry) {
+    static_cast<SymbolTable*>(table)->AssignId(static_cast<Elem*>(entry));
+  }
 };
 
 // Entry types
@@ -185,6 +470,9 @@ class IndexedEntry {
   IdType id() const { return id_; }
   const Elem& value() const { return value_; }
 
+  /// Hash of the key, cached so that the SymbolTable never needs to recompute it
+  std::size_t hash() const { return hash_; }
+
   friend std::ostream& operator<<(std::ostream& os, const IndexedEntry& s) {
     return os << s.value_;
   }
@@ -197,23 +485,36 @@ class IndexedEntry {
   typedef Key KeyType;
 
   IdType id_;
+  std::size_t hash_;
   const Elem value_;
 
-  template <class... Args>
-  IndexedEntry(size_t id, Args&&... args) : id_(id), value_(std::forward<Args>(args)...) {}
+  IndexedEntry(IdType id, std::size_t hash, const Elem& value)
+      : id_(id), hash_(hash), value_(value) {}
 
   const Key key() const { return Key(value_); }
 };
 
 /**
  * @brief String entry in the SymbolTable. Used for identifiers and string literals.
+ *
+ * The characters are stored in the SymbolTable's Arena and are NUL-terminated.
  */
-class StringEntry : public IndexedEntry<StringRef, std::string> {
+class StringEntry : public IndexedEntry<StringRef, StringRef> {
+ public:
+  /// NUL-terminated string value
+  const char* c_str() const { return value_.data(); }
+
  private:
-  StringEntry(IdType id, const std::string& value) : IndexedEntry(id, value) {}
-  StringEntry(IdType id, const char* string, std::size_t length)
-      : IndexedEntry(id, string, string + length) {}
-  StringEntry(IdType id, const StringEntry* entry) : IndexedEntry(id, entry->value()) {}
+  StringEntry(IdType id, std::size_t hash, const StringRef& value)
+      : IndexedEntry(id, hash, value) {}
+
+  /// Copy the characters of \p key into \p arena
+  static StringRef Intern(Arena& arena, const StringRef& key) {
+    char* data = static_cast<char*>(arena.Allocate(key.size() + 1, 1));
+    std::memcpy(data, key.data(), key.size());
+    data[key.size()] = '\0';
+    return StringRef(data, key.size());
+  }
 
   friend class SymbolTable<StringEntry>;
 };
@@ -223,7 +524,9 @@ class StringEntry : public IndexedEntry<StringRef, std::string> {
  */
 class Int32Entry : public IndexedEntry<int32_t, int32_t> {
  private:
-  Int32Entry(IdType id, int32_t value) : IndexedEntry(id, value) {}
+  Int32Entry(IdType id, std::size_t hash, int32_t value) : IndexedEntry(id, hash, value) {}
+
+  static int32_t Intern(Arena& arena, int32_t key) { return key; }
 
   friend class SymbolTable<Int32Entry>;
 };
@@ -261,14 +564,6 @@ namespace std {
 
 template <>
 struct hash<cool::StringRef> {
-  std::size_t operator()(const cool::StringRef& s) const {
-    // https://stackoverflow.com/questions/35985960/c-why-is-boosthash-combine-the-best-way-to-combine-hash-values
-    std::size_t seed = 0;
-    std::hash<char> hasher;
-    for (const char *it = s.data(), *end = it + s.size(); it != end; ++it) {
-      seed ^= hasher(*it) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-    }
-    return seed;
-  }
+  std::size_t operator()(const cool::StringRef& s) const { return cool::HashKey(s); }
 };
 }  // namespace std
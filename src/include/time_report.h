@@ -0,0 +1,174 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+/**
+ * @file
+ *
+ * @brief Time and memory usage of the compiler phases (-R, -J)
+ */
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace cool {
+
+/**
+ * @brief Time and memory usage of each compiler phase, in the style of gcc's -ftime-report
+ *
+ * Phases are timed by PhaseTimer, which does nothing unless the report is enabled. Phases can be
+ * nested, e.g. the code generation steps within code generation, and must only be timed on the main
+ * thread (the parallel phases are timed as a whole). CPU time is that of the process, i.e. summed
+ * over all threads, and so can exceed the wall time of the parallel phases.
+ *
+ * The heap is the memory allocated with malloc (and thus new) and in use, so that its change over a
+ * phase includes the AST and tables it allocated and not yet freed. The peak is the maximum resident
+ * set size of the process by the end of the phase, which includes the heap and grows monotonically.
+ */
+class TimeReport {
+ public:
+  struct Phase {
+    std::string name;
+    int depth;                    // Number of enclosing phases
+    double wall_seconds = 0;
+    double cpu_seconds = 0;
+    std::int64_t heap_delta = 0;  // Change in heap in use (bytes), may be negative
+    std::size_t peak_rss = 0;     // Peak resident set size (bytes) at the end of the phase
+  };
+
+  /// Start measuring, phases are only recorded while enabled
+  void Enable();
+  bool enabled() const { return enabled_; }
+
+  /// Enable the report and print it as a table to stderr (-R)
+  void EnableTable() {
+    Enable();
+    print_table_ = true;
+  }
+
+  /// Enable the report and write it as JSON to \p filename (-J)
+  void EnableJSON(const std::string& filename) {
+    Enable();
+    json_filename_ = filename;
+  }
+
+  /**
+   * @brief Print and/or write the report as enabled, called by the drivers once compilation succeeds
+   *
+   * @return false if the JSON file could not be written
+   */
+  bool Report() const;
+
+  const std::vector<Phase>& phases() const { return phases_; }
+
+  /// Print a table of the phases (in the order they started) and the total to \p os
+  void PrintTable(std::ostream& os) const;
+
+  /// Print the phases and the total as a JSON object to \p os
+  void PrintJSON(std::ostream& os) const;
+
+ private:
+  friend class PhaseTimer;
+
+  struct Sample {
+    std::chrono::steady_clock::time_point wall;
+    double cpu_seconds;
+    std::size_t heap;
+  };
+
+  static Sample Now();
+
+  /// Pseudo-phase from Enable until now
+  Phase Total() const;
+
+  /// Begin a phase, returning its index
+  std::size_t Begin(const char* name);
+  void End(std::size_t index);
+
+  bool enabled_ = false;
+  bool print_table_ = false;
+  std::string json_filename_;
+  int depth_ = 0;
+  Sample start_;
+  std::vector<Phase> phases_;
+  std::vector<Sample> starts_;  // Start of each phase
+};
+
+/// Report of the phases of this process, enabled by -R or -J
+extern TimeReport gTimeReport;
+
+/**
+ * @brief Time a phase in gTimeReport from construction until Stop or destruction
+ *
+ * Example usage:
+ * \code{.cpp}
+ * PhaseTimer timer("SemantKlassTable");
+ * SemantKlassTable klass_table(error, program->klasses());
+ * timer.Stop();
+ * \endcode
+ */
+class PhaseTimer {
+ public:
+  explicit PhaseTimer(const char* name)
+      : index_(gTimeReport.enabled() ? gTimeReport.Begin(name) : kStopped) {}
+  ~PhaseTimer() { Stop(); }
+
+  PhaseTimer(const PhaseTimer&) = delete;
+  PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+  /// End the phase early, e.g. before the objects created within it go out of scope
+  void Stop() {
+    if (index_ != kStopped) {
+      gTimeReport.End(index_);
+      index_ = kStopped;
+    }
+  }
+
+ private:
+  static constexpr std::size_t kStopped = ~std::size_t(0);
+  std::size_t index_;
+};
+
+/// Call \p fn, timed as phase \p name
+template <class Fn>
+void TimePhase(const char* name, Fn&& fn) {
+  PhaseTimer timer(name);
+  fn();
+}
+
+}  // namespace cool
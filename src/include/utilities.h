@@ -43,12 +43,14 @@ limitations under the License.
 #include <iomanip>
 #include <iterator>
 
+#include "stringtab.h"
+
 union YYSTYPE;
 
 namespace cool {
 
 /// Print escaped string to std::ostream
-inline void print_escaped_string(std::ostream& str, const std::string& s) {
+inline void print_escaped_string(std::ostream& str, const StringRef& s) {
   // Include in header to avoid pulling in lexing/parsing libraries
   for (auto& c : s) {
     switch (c) {
@@ -87,7 +89,7 @@ inline void print_escaped_string(std::ostream& str, const std::string& s) {
 }
 
 const char* cool_token_to_string(int tok);
-void print_cool_token(std::ostream& out, int tok);
+void print_cool_token(std::ostream& out, int tok, const YYSTYPE& yylval);
 void dump_cool_token(std::ostream& out, int lineno, int token, YYSTYPE yylval);
 
 // Include in header to avoid pulling in lexing/parsing libraries
@@ -0,0 +1,99 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "mapped_file.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace cool {
+
+MappedFile::~MappedFile() { Close(); }
+
+void MappedFile::Close() {
+  if (data_) {
+    ::munmap(data_, mapped_size_);
+    data_ = nullptr;
+    size_ = mapped_size_ = 0;
+  }
+}
+
+bool MappedFile::Open(const char* path, std::size_t padding) {
+  Close();
+
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+    ::close(fd);
+    return false;
+  }
+
+  // Reserve zero-filled anonymous memory for the file and padding, and then map the file over the
+  // start of that region. Bytes past the end of the file in its last page are zero, and the padding
+  // can't fault even when the file ends exactly on a page boundary.
+  std::size_t size = info.st_size;
+  std::size_t page = ::sysconf(_SC_PAGESIZE);
+  std::size_t mapped_size = (size + padding + page - 1) / page * page;
+
+  void* region = ::mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                        -1, 0);
+  if (region == MAP_FAILED) {
+    ::close(fd);
+    return false;
+  }
+
+  int flags = MAP_PRIVATE | MAP_FIXED;
+#ifdef MAP_POPULATE
+  flags |= MAP_POPULATE;  // The whole file will be read, so avoid faulting in one page at a time
+#endif
+  if (size > 0 && ::mmap(region, size, PROT_READ | PROT_WRITE, flags, fd, 0) == MAP_FAILED) {
+    ::munmap(region, mapped_size);
+    ::close(fd);
+    return false;
+  }
+  ::close(fd);  // The mapping remains valid after the file is closed
+
+  data_ = static_cast<char*>(region);
+  size_ = size;
+  mapped_size_ = mapped_size;
+  return true;
+}
+
+}  // namespace cool
@@ -0,0 +1,295 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "mips.h"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+namespace cool {
+
+namespace {
+
+// Indexed by MipsOp
+const char* const kMnemonics[] = {
+    "",    "lw",  "sw",  "li",   "la",   "move", "neg", "add", "addu", "addiu", "sub",
+    "mul", "div", "sll", "slt",  "sle",  "seq",  "xori", "b",  "beqz", "beq",   "bne",
+    "blt", "ble", "bgt", "bge", "bgeu", "j",    "jal", "jalr", "jr",
+};
+static_assert(sizeof(kMnemonics) / sizeof(kMnemonics[0]) == static_cast<int>(MipsOp::kJr) + 1,
+              "missing mnemonic");
+
+// Indexed by MipsSpacing
+const char* const kSeparators[] = {"\t", " ", "\t "};
+
+// Local label or global symbol targeted by a jump
+std::ostream& PrintTarget(std::ostream& os, const MipsInstr& instr) {
+  if (instr.label != kNoLabel) {
+    return os << "label" << instr.label;
+  }
+  return os << instr.symbol;
+}
+
+// Offset or symbolic address, and base register of lw and sw
+std::ostream& PrintAddress(std::ostream& os, const MipsInstr& instr) {
+  if (instr.symbol.empty()) {
+    os << instr.imm;
+  } else {
+    os << instr.symbol;
+  }
+  return os << "(" << instr.rs << ")";
+}
+
+}  // namespace
+
+std::ostream& operator<<(std::ostream& os, const MipsInstr& instr) {
+  if (instr.op == MipsOp::kLabel) {
+    return PrintTarget(os, instr) << ":\n";
+  }
+
+  os << "\t" << kMnemonics[static_cast<int>(instr.op)]
+     << kSeparators[static_cast<int>(instr.spacing)];
+  switch (instr.op) {
+    case MipsOp::kLw:
+    case MipsOp::kSw:
+      PrintAddress(os << instr.rd << " ", instr);
+      break;
+    case MipsOp::kLi:
+      os << instr.rd << " " << instr.imm;
+      break;
+    case MipsOp::kLa:
+      os << instr.rd << " " << instr.symbol;
+      break;
+    case MipsOp::kMove:
+    case MipsOp::kNeg:
+      os << instr.rd << " " << instr.rs;
+      break;
+    case MipsOp::kAddiu:
+    case MipsOp::kSll:
+    case MipsOp::kXori:
+      os << instr.rd << " " << instr.rs << " " << instr.imm;
+      break;
+    case MipsOp::kB:
+    case MipsOp::kJ:
+    case MipsOp::kJal:
+      PrintTarget(os, instr);
+      break;
+    case MipsOp::kBeqz:
+      PrintTarget(os << instr.rs << " ", instr);
+      break;
+    case MipsOp::kBeq:
+    case MipsOp::kBne:
+    case MipsOp::kBlt:
+    case MipsOp::kBle:
+    case MipsOp::kBgt:
+    case MipsOp::kBge:
+    case MipsOp::kBgeu:
+      os << instr.rs << " ";
+      if (instr.rt) {
+        os << instr.rt;
+      } else {
+        os << instr.imm;
+      }
+      PrintTarget(os << " ", instr);
+      break;
+    case MipsOp::kJalr:
+      os << instr.rs;
+      break;
+    case MipsOp::kJr:
+      // The return was always written with a trailing tab
+      os << instr.rs << "\t";
+      break;
+    default:
+      os << instr.rd << " " << instr.rs << " " << instr.rt;
+      break;
+  }
+  return os << "\n";
+}
+
+bool SameRegister(Register a, Register b) { return a && b && std::strcmp(a, b) == 0; }
+
+Register MipsInstr::Written() const {
+  if (op == MipsOp::kSw || IsControl()) {
+    return kNullRegister;
+  }
+  return rd;
+}
+
+bool MipsInstr::Reads(Register reg) const {
+  switch (op) {
+    case MipsOp::kSw:
+      return SameRegister(rd, reg) || SameRegister(rs, reg);
+    case MipsOp::kLi:
+    case MipsOp::kLa:
+      return false;
+    default:
+      return SameRegister(rs, reg) || SameRegister(rt, reg);
+  }
+}
+
+std::ostream& operator<<(std::ostream& os, const MipsCode& code) {
+  for (auto& instr : code.instrs_) {
+    os << instr;
+  }
+  return os;
+}
+
+void MipsCode::RebaseLabels(int base) {
+  for (auto& instr : instrs_) {
+    if (instr.label != kNoLabel) {
+      instr.label += base;
+    }
+  }
+}
+
+void MipsCode::Label(int label) { Append(MipsOp::kLabel).label = label; }
+
+void MipsCode::Label(std::string name) { Append(MipsOp::kLabel).symbol = std::move(name); }
+
+void MipsCode::Lw(Register rd, int offset, Register base) {
+  auto& instr = Append(MipsOp::kLw);
+  instr.rd = rd;
+  instr.imm = offset;
+  instr.rs = base;
+}
+
+void MipsCode::Lw(Register rd, std::string address, Register base) {
+  auto& instr = Append(MipsOp::kLw);
+  instr.rd = rd;
+  instr.symbol = std::move(address);
+  instr.rs = base;
+}
+
+void MipsCode::Sw(Register rt, int offset, Register base) {
+  auto& instr = Append(MipsOp::kSw);
+  instr.rd = rt;
+  instr.imm = offset;
+  instr.rs = base;
+}
+
+void MipsCode::Li(Register rd, int imm) {
+  auto& instr = Append(MipsOp::kLi);
+  instr.rd = rd;
+  instr.imm = imm;
+}
+
+void MipsCode::La(Register rd, std::string address) {
+  auto& instr = Append(MipsOp::kLa);
+  instr.rd = rd;
+  instr.symbol = std::move(address);
+}
+
+void MipsCode::Move(Register rd, Register rs) {
+  auto& instr = Append(MipsOp::kMove);
+  instr.rd = rd;
+  instr.rs = rs;
+}
+
+void MipsCode::Neg(Register rd, Register rs) {
+  auto& instr = Append(MipsOp::kNeg);
+  instr.rd = rd;
+  instr.rs = rs;
+}
+
+void MipsCode::Arith(MipsOp op, Register rd, Register rs, Register rt) {
+  auto& instr = Append(op);
+  instr.rd = rd;
+  instr.rs = rs;
+  instr.rt = rt;
+}
+
+void MipsCode::ArithImm(MipsOp op, Register rd, Register rs, int imm) {
+  auto& instr = Append(op);
+  instr.rd = rd;
+  instr.rs = rs;
+  instr.imm = imm;
+}
+
+void MipsCode::B(int label, MipsSpacing spacing) {
+  auto& instr = Append(MipsOp::kB);
+  instr.label = label;
+  instr.spacing = spacing;
+}
+
+void MipsCode::Beqz(Register rs, int label) {
+  auto& instr = Append(MipsOp::kBeqz);
+  instr.rs = rs;
+  instr.label = label;
+}
+
+void MipsCode::Beqz(Register rs, std::string target) {
+  auto& instr = Append(MipsOp::kBeqz);
+  instr.rs = rs;
+  instr.symbol = std::move(target);
+}
+
+void MipsCode::Branch(MipsOp op, Register rs, Register rt, int label) {
+  assert(rt);
+  auto& instr = Append(op);
+  instr.rs = rs;
+  instr.rt = rt;
+  instr.label = label;
+}
+
+void MipsCode::Branch(MipsOp op, Register rs, int imm, int label) {
+  auto& instr = Append(op);
+  instr.rs = rs;
+  instr.imm = imm;
+  instr.label = label;
+}
+
+void MipsCode::J(std::string target) { Append(MipsOp::kJ).symbol = std::move(target); }
+
+void MipsCode::Jal(std::string target, MipsSpacing spacing) {
+  auto& instr = Append(MipsOp::kJal);
+  instr.symbol = std::move(target);
+  instr.spacing = spacing;
+}
+
+void MipsCode::Jalr(Register rs) { Append(MipsOp::kJalr).rs = rs; }
+
+void MipsCode::Jr(Register rs) { Append(MipsOp::kJr).rs = rs; }
+
+std::size_t MipsCode::size() const {
+  std::size_t size = 0;
+  for (auto& instr : instrs_) {
+    size += instr.op != MipsOp::kLabel;
+  }
+  return size;
+}
+
+}  // namespace cool
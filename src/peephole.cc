@@ -0,0 +1,221 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "peephole.h"
+
+#include <utility>
+
+#include "emit.h"
+
+namespace cool {
+
+namespace {
+
+// Number of instructions searched between a push and the matching pop
+constexpr std::size_t kPushPopWindow = 8;
+
+bool SameAddress(const MipsInstr& a, const MipsInstr& b) {
+  return SameRegister(a.rs, b.rs) && a.imm == b.imm && a.symbol == b.symbol;
+}
+
+bool IsStackAdjust(const MipsInstr& instr) {
+  return instr.op == MipsOp::kAddiu && SameRegister(instr.rd, SP) && SameRegister(instr.rs, SP);
+}
+
+// sw reg 0($sp) and addiu $sp $sp -4 starting at code[i]
+bool IsPush(const std::vector<MipsInstr>& code, std::size_t i) {
+  return code[i].op == MipsOp::kSw && code[i].symbol.empty() && code[i].imm == 0 &&
+         SameRegister(code[i].rs, SP) && IsStackAdjust(code[i + 1]) && code[i + 1].imm == -4;
+}
+
+}  // namespace
+
+void PeepholeOptimizer::Merge(const PeepholeOptimizer& other) {
+  for (std::size_t i = 0; i < kNumPeepholeRules; i++) {
+    hits_[i] += other.hits_[i];
+  }
+}
+
+const char* PeepholeOptimizer::RuleName(PeepholeRule rule) {
+  static const char* const kNames[] = {
+      "store-load", "push-pop", "stack-adjust", "redundant-move", "dead-write",
+  };
+  static_assert(sizeof(kNames) / sizeof(kNames[0]) == kNumPeepholeRules, "missing rule name");
+  return kNames[static_cast<std::size_t>(rule)];
+}
+
+void PeepholeOptimizer::Run(MipsCode& code) {
+  std::vector<MipsInstr> optimized;
+  optimized.reserve(code.instrs().size());
+  for (auto& instr : code.instrs()) {
+    optimized.push_back(std::move(instr));
+    while (Rewrite(optimized)) {
+    }
+  }
+  code.instrs() = std::move(optimized);
+}
+
+bool PeepholeOptimizer::Rewrite(std::vector<MipsInstr>& code) {
+  return RewriteStoreLoad(code) || RewritePushPop(code) || RewriteStackAdjust(code) ||
+         RewriteRedundantMove(code) || RewriteDeadWrite(code);
+}
+
+bool PeepholeOptimizer::RewriteStoreLoad(std::vector<MipsInstr>& code) {
+  // sw $a0 12($fp); lw $t1 12($fp) => sw $a0 12($fp); move $t1 $a0
+  if (code.size() < 2) {
+    return false;
+  }
+  MipsInstr& load = code.back();
+  const MipsInstr& store = code[code.size() - 2];
+  if (load.op != MipsOp::kLw || store.op != MipsOp::kSw || !SameAddress(load, store)) {
+    return false;
+  }
+  if (SameRegister(load.rd, store.rd)) {
+    code.pop_back();
+  } else {
+    Register rd = load.rd;
+    load = MipsInstr(MipsOp::kMove);
+    load.rd = rd;
+    load.rs = store.rd;
+  }
+  Hit(PeepholeRule::kStoreLoad);
+  return true;
+}
+
+bool PeepholeOptimizer::RewritePushPop(std::vector<MipsInstr>& code) {
+  // sw $a0 0($sp); addiu $sp $sp -4; ...; lw $t1 4($sp); addiu $sp $sp 4 => move $t1 $a0; ...
+  std::size_t n = code.size();
+  if (n < 4 || !IsStackAdjust(code[n - 1]) || code[n - 1].imm != 4) {
+    return false;
+  }
+  const MipsInstr& pop = code[n - 2];
+  if (pop.op != MipsOp::kLw || !pop.symbol.empty() || pop.imm != 4 || !SameRegister(pop.rs, SP)) {
+    return false;
+  }
+  Register rd = pop.rd;
+
+  // The instructions in between run after the copy, they must not touch the stack or its target
+  std::size_t end = n - 2;  // One past the last instruction in between
+  std::size_t push = end;
+  for (std::size_t i = end; i >= 2 && end - i <= kPushPopWindow; i--) {
+    if (IsPush(code, i - 2)) {
+      push = i - 2;
+      break;
+    }
+    const MipsInstr& instr = code[i - 1];
+    if (instr.IsControl() || instr.Mentions(SP) || instr.Mentions(rd)) {
+      return false;
+    }
+  }
+  if (push == end) {
+    return false;
+  }
+
+  Register rs = code[push].rd;
+  code.erase(code.begin() + (n - 2), code.end());
+  code.erase(code.begin() + (push + 1));
+  if (SameRegister(rd, rs)) {
+    code.erase(code.begin() + push);
+  } else {
+    code[push] = MipsInstr(MipsOp::kMove);
+    code[push].rd = rd;
+    code[push].rs = rs;
+  }
+  Hit(PeepholeRule::kPushPop);
+  return true;
+}
+
+bool PeepholeOptimizer::RewriteStackAdjust(std::vector<MipsInstr>& code) {
+  // addiu $sp $sp 4; addiu $sp $sp 8 => addiu $sp $sp 12
+  std::size_t n = code.size();
+  if (n < 2 || !IsStackAdjust(code[n - 1]) || !IsStackAdjust(code[n - 2])) {
+    return false;
+  }
+  code[n - 2].imm += code[n - 1].imm;
+  code.pop_back();
+  if (code.back().imm == 0) {
+    code.pop_back();
+  }
+  Hit(PeepholeRule::kStackAdjust);
+  return true;
+}
+
+bool PeepholeOptimizer::RewriteRedundantMove(std::vector<MipsInstr>& code) {
+  // move $a0 $a0 => (nothing), and move $s1 $a0; move $a0 $s1 => move $s1 $a0
+  const MipsInstr& move = code.back();
+  if (move.op != MipsOp::kMove) {
+    return false;
+  }
+  if (!SameRegister(move.rd, move.rs)) {
+    if (code.size() < 2) {
+      return false;
+    }
+    const MipsInstr& prev = code[code.size() - 2];
+    if (prev.op != MipsOp::kMove || !SameRegister(prev.rd, move.rs) ||
+        !SameRegister(prev.rs, move.rd)) {
+      return false;
+    }
+  }
+  code.pop_back();
+  Hit(PeepholeRule::kRedundantMove);
+  return true;
+}
+
+bool PeepholeOptimizer::RewriteDeadWrite(std::vector<MipsInstr>& code) {
+  // move $a0 $zero; la $a0 str_const1 => la $a0 str_const1
+  std::size_t n = code.size();
+  if (n < 2) {
+    return false;
+  }
+  const MipsInstr& prev = code[n - 2];
+  const MipsInstr& next = code[n - 1];
+  switch (prev.op) {
+    case MipsOp::kLw:
+    case MipsOp::kLi:
+    case MipsOp::kLa:
+    case MipsOp::kMove:
+      break;
+    default:
+      return false;
+  }
+  if (!SameRegister(next.Written(), prev.rd) || next.Reads(prev.rd)) {
+    return false;
+  }
+  code.erase(code.begin() + (n - 2));
+  Hit(PeepholeRule::kDeadWrite);
+  return true;
+}
+
+}  // namespace cool
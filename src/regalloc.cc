@@ -0,0 +1,117 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "regalloc.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace cool {
+
+void RegisterAllocator::Begin(const ASTNode* node, int index) {
+  index_.emplace(std::make_pair(node, index), intervals_.size());
+  intervals_.push_back(Interval{position_++, 0, 0, kNullRegister});
+}
+
+void RegisterAllocator::End(const ASTNode* node, int index) {
+  auto found = index_.find(std::make_pair(node, index));
+  assert(found != index_.end());
+  intervals_[found->second].end = position_++;
+}
+
+void RegisterAllocator::AddWeight(const ASTNode* node, int weight, int index) {
+  auto found = index_.find(std::make_pair(node, index));
+  assert(found != index_.end());
+  intervals_[found->second].weight += weight;
+}
+
+void RegisterAllocator::Allocate() {
+  // Free registers as a stack, with the most preferred register on top
+  std::vector<Register> free(registers_.rbegin(), registers_.rend());
+  // Intervals holding a register, ordered by increasing end
+  std::vector<Interval*> active;
+
+  for (auto& current : intervals_) {
+    if (current.weight < min_weight_) {
+      continue;
+    }
+
+    // Expire the intervals that ended before this one starts
+    auto expired = std::find_if(active.begin(), active.end(),
+                                [&](const Interval* i) { return i->end > current.start; });
+    for (auto i = expired; i != active.begin();) {
+      free.push_back((*--i)->reg);
+    }
+    active.erase(active.begin(), expired);
+
+    Interval* holder = &current;
+    if (free.empty()) {
+      // Spill the interval that ends last, which could be the current one
+      Interval* spill = active.empty() ? &current : active.back();
+      if (spill != &current && spill->end > current.end) {
+        current.reg = spill->reg;
+        spill->reg = kNullRegister;
+        active.pop_back();
+      } else {
+        holder = nullptr;
+      }
+      num_spilled_++;
+    } else {
+      current.reg = free.back();
+      free.pop_back();
+    }
+
+    if (holder) {
+      auto by_end = [](const Interval* a, const Interval* b) { return a->end < b->end; };
+      active.insert(std::upper_bound(active.begin(), active.end(), holder, by_end), holder);
+    }
+  }
+
+  // Registers in use, in order of preference
+  used_.clear();
+  for (auto reg : registers_) {
+    if (std::any_of(intervals_.begin(), intervals_.end(),
+                    [&](const Interval& i) { return i.reg == reg; })) {
+      used_.push_back(reg);
+    }
+  }
+}
+
+Register RegisterAllocator::Find(const ASTNode* node, int index) const {
+  auto found = index_.find(std::make_pair(node, index));
+  return found == index_.end() ? kNullRegister : intervals_[found->second].reg;
+}
+
+}  // namespace cool
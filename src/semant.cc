@@ -37,12 +37,17 @@ limitations under the License.
 #include <algorithm>
 #include <cstdlib>
 #include <fmt/ostream.h>
+#include <sstream>
 #include <spdlog/spdlog.h>
 
 #include "ast.h"
+#include "parallel.h"
 #include "semant.h"
+#include "time_report.h"
 #include "utilities.h"
 
+bool semant_parallel = false;  // Type check the classes on multiple threads
+
 namespace cool {
 
 // clang-format off
@@ -117,7 +122,7 @@ SemantKlassTable::SemantKlassTable(SemantError& error, Klasses* klasses)
         // Create Inheritance graph
         SemantNode *parent_node = ClassFind(node->parent_name());
         if (!parent_node) {
-            error_(node) << "Parent class " << node->parent_name() << " is not defined" << std::endl;
+            error_(node) << "Class " << node->name() << " inherits from an undefined class " << node->parent_name() << "." << std::endl;
             continue;
         }
         if (!parent_node->inheritable()) {
@@ -140,10 +145,13 @@ SemantKlassTable::SemantKlassTable(SemantError& error, Klasses* klasses)
     }
     if (error_.errors() > 0) return;  // Can't continue with class table construction if errors found
 
+    // Label the inheritance tree for constant time <= and LUB queries
+    AssignAllTags();
 } // end SemantKlassTable constructor
 
 
 void Semant(Program* program) {
+    PhaseTimer semant_timer("semant");
 
     // Initialize error tracker (and reporter)
     SemantError error(std::cerr);
@@ -151,7 +159,9 @@ void Semant(Program* program) {
     // Perform semantic analysis...
     // Constructor of a semant class table.
     // Inheritance graph is created along the way.
+    PhaseTimer klass_table_timer("SemantKlassTable");
     SemantKlassTable klass_table(error, program->klasses());
+    klass_table_timer.Stop();
 
     // Halt program with non-zero exit if there are semantic errors
     if (error.errors()) { // If number of errors reported is non-zero
@@ -160,14 +170,14 @@ void Semant(Program* program) {
     }
 
     // Create scoped table for each class containing attr names and method names
-    klass_table.make_all_sctables(klass_table.root());
+    TimePhase("make_all_sctables", [&]() { klass_table.make_all_sctables(klass_table.root()); });
 
     if (error.errors()) { // If number of errors reported is non-zero
         std::cerr << "Compilation halted due to static semantic errors." << std::endl;
         exit(1);
     }
 
-    klass_table.Typecheck_all();
+    TimePhase("Typecheck_all", [&]() { klass_table.Typecheck_all(); });
 
     if (error.errors()) { // If number of errors reported is non-zero
         std::cerr << "Compilation halted due to static semantic errors." << std::endl;
@@ -211,6 +221,49 @@ void SemantKlassTable::traverse(SemantNode *klass_node) {
 } // end void traverse(SemantNode *klass_node)
 
 
+// Assign preorder tags to all SemantNodes and build the sparse table over the Euler tour
+// used to answer lowest common ancestor queries
+void SemantKlassTable::AssignAllTags() {
+    std::size_t val = 0;
+    euler_.clear();
+    euler_.reserve(2 * nodes_.size());
+    AssignTag(root(), val);
+
+    // lca_table_[0] is the Euler tour itself, each subsequent level covers twice the range
+    lca_table_.assign(1, euler_);
+    for (std::size_t width = 2; width <= euler_.size(); width *= 2) {
+        const std::vector<SemantNode *> &prev = lca_table_.back();
+        std::vector<SemantNode *> level(euler_.size() - width + 1);
+        for (std::size_t i = 0; i < level.size(); i++) {
+            SemantNode *left = prev[i], *right = prev[i + width / 2];
+            level[i] = (right->depth_ < left->depth_) ? right : left;
+        }
+        lca_table_.push_back(std::move(level));
+    }
+
+    // floor_log2_[n] is the level whose two lookups cover a range of n klasses
+    floor_log2_.assign(euler_.size() + 1, 0);
+    for (std::size_t n = 2; n < floor_log2_.size(); n++) {
+        floor_log2_[n] = floor_log2_[n / 2] + 1;
+    }
+}
+
+
+// Assign tag for a SemantNode recursively, [tag_, next_sib_tag_) are the tags of its subtree
+void SemantKlassTable::AssignTag(SemantNode *klass_node, std::size_t &val) {
+    klass_node->tag_ = val;
+    val++;
+    klass_node->depth_ = klass_node->parent() ? klass_node->parent()->depth_ + 1 : 0;
+    klass_node->euler_index_ = euler_.size();
+    euler_.push_back(klass_node);
+    for (auto child : klass_node->children_) {
+        AssignTag(child, val);
+        euler_.push_back(klass_node);
+    }
+    klass_node->next_sib_tag_ = val;
+}
+
+
 
 /*
  * Part II: Create scoped tables
@@ -220,7 +273,7 @@ void SemantKlassTable::traverse(SemantNode *klass_node) {
 // Not sure whether any error will be detected here
 void SemantKlassTable::make_all_sctables(SemantNode *klass_node) {
 
-    // duplicate parent class' scoped-tables (both M-table and O-table)
+    // extend parent class' scoped-tables (both M-table and O-table), the parent's scopes are shared not copied
     klass_node->mtable_ = klass_node->parent()->mtable_;
     klass_node->otable_ = klass_node->parent()->otable_;
 
@@ -340,8 +393,37 @@ SemantEnv::SemantEnv(SemantKlassTable *klass_table_arg,
            curr_semant_node(curr_semant_node_arg),
            error_env(error_env_arg) {}
 
+// Find the type of an objectID, searching the method-local scopes and then the klass' attributes
+Symbol *SemantEnv::LookupObject(Symbol *name) const {
+    Symbol *type = local_otable.Lookup(name);
+    return type ? type : curr_semant_node->otable_.Lookup(name);
+}
+
+// Type check the klasses depth first from the root, i.e. by tag. With semant_parallel the klasses are
+// checked on NumThreads() threads. The klasses only share the read-only klass table, and each
+// reports its errors to its own buffer, printed in the serial order.
 void SemantKlassTable::Typecheck_all() {
-    Typecheck_subgraph(root());
+    std::vector<SemantNode *> klass_nodes(nodes_.size());
+    for (auto node : nodes_) {
+        klass_nodes[node->tag_] = node;
+    }
+
+    if (!semant_parallel) {
+        for (auto node : klass_nodes) {
+            Typecheck_klass(node, error_);
+        }
+    } else {
+        std::vector<std::ostringstream> messages(klass_nodes.size());
+        std::vector<std::size_t> errors(klass_nodes.size());
+        ParallelFor(klass_nodes.size(), [&](std::size_t i) {
+            SemantError error(messages[i]);
+            Typecheck_klass(klass_nodes[i], error);
+            errors[i] = error.errors();
+        });
+        for (std::size_t i = 0; i < klass_nodes.size(); i++) {
+            error_.Report(messages[i].str(), errors[i]);
+        }
+    }
 
     // Check whethe Main and main are present
     SemantNode *Main_node = ClassFind(Main);
@@ -349,18 +431,13 @@ void SemantKlassTable::Typecheck_all() {
     if (!Main_node->mtable_.Lookup(main_meth)) {error_() << "Method main is not defined\n"; return;}
 }
 
-// Type check all the classes in the subgraph of the inheritance graph
-// where the root of subgraph is klass_node
-void SemantKlassTable::Typecheck_subgraph(SemantNode *klass_node) {
+// Type check the attributes and methods of klass_node, may be called concurrently for different klasses
+void SemantKlassTable::Typecheck_klass(SemantNode *klass_node, SemantError &error) {
     // Construct the semantic environment specific to klass_node
-    SemantEnv envnow(this, klass_node, error_);
+    SemantEnv envnow(this, klass_node, error);
 
     // Traverse the AST under klass_node and do Typechecking
     klass_node->klass()->Typecheck(envnow);
-
-    for (auto child : klass_node->children_) {
-        Typecheck_subgraph(child);
-    }
 }
 
 // Check whether type1 <= type2
@@ -378,20 +455,18 @@ bool SemantEnv::type_LE(Symbol *type1, Symbol *type2) {
     // Below are the extensions of <= operator between types to SELF_TYPE
     else if (type1 == SELF_TYPE && type2 == SELF_TYPE) {return true; }
     else if (type1 != SELF_TYPE && type2 == SELF_TYPE) {return false; }
-    else if (type1 == SELF_TYPE && type2 != SELF_TYPE) {
+    else {  // type1 == SELF_TYPE && type2 != SELF_TYPE
         return klass_table->SNLE(curr_semant_node, klass_table->ClassFind(type2));
     }
 } // end SemantEnv::type_LE(Symbol *type1, Symbol *type2)
 
 // Check whether the first SemantNode is the descendant of or the same as the second SemantNode
+// The descendants of a klass are exactly the klasses with tags in [tag_, next_sib_tag_)
 bool SemantKlassTable::SNLE(SemantNode *klass_node_1, SemantNode *klass_node_2) {
     if (klass_node_1 == klass_node_2) {return true; }
+    if (!klass_node_1 || !klass_node_2) {return false; }
 
-    for (auto child : klass_node_2->children_) {
-        if (SNLE(klass_node_1, child)) {return true;}
-    }
-
-    return false;
+    return klass_node_2->tag_ <= klass_node_1->tag_ && klass_node_1->tag_ < klass_node_2->next_sib_tag_;
 }
 
 // Find the least upper bound of two types
@@ -430,12 +505,19 @@ Symbol *SemantEnv::type_LUB(Symbol *type1, Symbol *type2) {
 
 // Find the lowest common ancestor of two SemandNode's
 // If they don't share a common ancestor, return null
+// The lowest common ancestor is the shallowest klass visited in the Euler tour between the first
+// visits of the two klasses, found with two overlapping lookups in the sparse table
 SemantNode *SemantKlassTable::SNLUB(SemantNode *klass_node_1, SemantNode *klass_node_2) {
     if (klass_node_1 == klass_node_2) {return klass_node_1; }
-    SemantNode *next_up = klass_node_2->parent();
-    if (next_up == NULL) {return NULL; }
-    if (SNLE(klass_node_1, next_up)) {return next_up; }
-    return SNLUB(klass_node_1, next_up);
+    if (!klass_node_1 || !klass_node_2) {return NULL; }
+
+    std::size_t first = klass_node_1->euler_index_, last = klass_node_2->euler_index_;
+    if (first > last) {std::swap(first, last); }
+
+    std::size_t level = floor_log2_[last - first + 1];
+    SemantNode *left = lca_table_[level][first];
+    SemantNode *right = lca_table_[level][last + 1 - (std::size_t(1) << level)];
+    return (right->depth_ < left->depth_) ? right : left;
 }
 
 
@@ -456,10 +538,10 @@ void Feature::Typecheck(SemantEnv &env) {
     {
         Attr *attr = (Attr *)this;
         Expression *expr = attr->init();
-        env.curr_semant_node->otable_.EnterScope();
-        env.curr_semant_node->otable_.AddToScope(self, SELF_TYPE);
+        env.local_otable.EnterScope();
+        env.local_otable.AddToScope(self, SELF_TYPE);
         expr->Typecheck(env);
-        env.curr_semant_node->otable_.ExitScope();
+        env.local_otable.ExitScope();
 
         // catch error if the declared type of attribute does not exist
         if (!env.klass_table->ClassFind(attr->decl_type())) {
@@ -479,12 +561,12 @@ void Feature::Typecheck(SemantEnv &env) {
     // If the feature is a method
     {
         Method *meth = (Method *)this;
-        env.curr_semant_node->otable_.EnterScope();
-        env.curr_semant_node->otable_.AddToScope(self, SELF_TYPE);
+        env.local_otable.EnterScope();
+        env.local_otable.AddToScope(self, SELF_TYPE);
 
         for (auto formal : *meth->formals()) {
             // Check repeating formal name
-            if (env.curr_semant_node->otable_.Probe(formal->name())) {
+            if (env.local_otable.Probe(formal->name())) {
                 env.error_env(env.curr_semant_node->klass(), this) << "Formal name \"" << formal->name() << "\" is already defined\n";
                 continue;
             }
@@ -493,23 +575,23 @@ void Feature::Typecheck(SemantEnv &env) {
             // if the type of a formal is undefined
             {
                 env.error_env(env.curr_semant_node->klass(), this) << "Type \"" << formal->decl_type() << "\" is undefined\n";
-                env.curr_semant_node->otable_.AddToScope(formal->name(), Object);
+                env.local_otable.AddToScope(formal->name(), Object);
             }
 
             else if (formal->decl_type() == SELF_TYPE)
             // if the type of a formal is SELF_TYPE
             {
                 env.error_env(env.curr_semant_node->klass(), this) << "Formals cannot have type \"SELF_TYPE\"\n";
-                env.curr_semant_node->otable_.AddToScope(formal->name(), Object);
+                env.local_otable.AddToScope(formal->name(), Object);
             }
 
             else {
-                env.curr_semant_node->otable_.AddToScope(formal->name(), formal->decl_type());
+                env.local_otable.AddToScope(formal->name(), formal->decl_type());
             }
         } // end for
 
         meth->body_->Typecheck(env);
-        env.curr_semant_node->otable_.ExitScope();
+        env.local_otable.ExitScope();
 
         // catch error if the declared type of method does not exist
         if (!env.klass_table->ClassFind(meth->decl_type())) {
@@ -541,7 +623,7 @@ void StringLiteral::Typecheck(SemantEnv &env) {
 }
 
 void Ref::Typecheck(SemantEnv &env) {
-    Symbol *type = env.curr_semant_node->otable_.Lookup(name_);
+    Symbol *type = env.LookupObject(name_);
     // Need to check whether the objectID is undefined
     if (type) {set_type(type); }
     else {
@@ -552,7 +634,7 @@ void Ref::Typecheck(SemantEnv &env) {
 }
 
 void Assign::Typecheck(SemantEnv &env) {
-    Symbol *type_lhs = env.curr_semant_node->otable_.Lookup(name_);
+    Symbol *type_lhs = env.LookupObject(name_);
     value_->Typecheck(env);
     Symbol *type_rhs = value_->type();
 
@@ -638,16 +720,16 @@ void Let::Typecheck(SemantEnv &env) {
         }
     }
 
-    // Push a new scope into the current Object Scoped Table
+    // Push a new scope into the method-local Object Scoped Table
     // Temporary: name_ ----mapTo----> decl_type_final
-    env.curr_semant_node->otable_.EnterScope();
-    env.curr_semant_node->otable_.AddToScope(name_, decl_type_final);
+    env.local_otable.EnterScope();
+    env.local_otable.AddToScope(name_, decl_type_final);
 
     // Under the current temporary environment, typecheck the body expression of Let
     body_->Typecheck(env);
 
     // Delete the temporary scope
-    env.curr_semant_node->otable_.ExitScope();
+    env.local_otable.ExitScope();
 
     if (!error_flag) {set_type(body_->type()); }
 } // end void Let::Typecheck(SemantEnv &env)
@@ -661,11 +743,11 @@ void Kase::Typecheck(SemantEnv &env) {
     Symbol *ans = leaf;
 
     for (auto branch : *cases_) {
-        env.curr_semant_node->otable_.EnterScope();
-        env.curr_semant_node->otable_.AddToScope(branch->name_, branch->decl_type_);
+        env.local_otable.EnterScope();
+        env.local_otable.AddToScope(branch->name_, branch->decl_type_);
         branch->body_->Typecheck(env);
         ans = env.type_LUB(ans, branch->body_->type());
-        env.curr_semant_node->otable_.ExitScope();
+        env.local_otable.ExitScope();
     }
 
     set_type(ans);
@@ -800,8 +882,9 @@ void Dispatch::Typecheck(SemantEnv &env) {
             type_actual = env.curr_semant_node->klass()->name();
         }
 
-        if (type_formal != type_actual) {
-            env.error_env(env.curr_semant_node->klass(), this) << "The " << i << "th/st/nd argument shoud have type \"" << type_formal << "\" but instead has type \"" << type_actual;
+        // Arguments may be of any subtype of the formal type
+        if (!env.type_LE(type_actual, type_formal)) {
+            env.error_env(env.curr_semant_node->klass(), this) << "The " << i << "th/st/nd argument shoud have type \"" << type_formal << "\" but instead has type \"" << type_actual << "\"\n";
             error_flag = true;
         }
 
@@ -867,8 +950,9 @@ void StaticDispatch::Typecheck(SemantEnv &env) {
             type_actual = env.curr_semant_node->klass()->name();
         }
 
-        if (type_formal != type_actual) {
-            env.error_env(env.curr_semant_node->klass(), this) << "The " << i << "th/st/nd argument shoud have type \"" << type_formal << "\" but instead has type \"" << type_actual;
+        // Arguments may be of any subtype of the formal type
+        if (!env.type_LE(type_actual, type_formal)) {
+            env.error_env(env.curr_semant_node->klass(), this) << "The " << i << "th/st/nd argument shoud have type \"" << type_formal << "\" but instead has type \"" << type_actual << "\"\n";
             error_flag = true;
         }
 
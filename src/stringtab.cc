@@ -36,6 +36,7 @@ limitations under the License.
 #include <cassert>
 #include <cstring>
 #include <new>
+#include <ostream>
 #include <type_traits>
 
 #include "stringtab.h"
@@ -51,6 +52,20 @@ bool StringRef::operator==(const StringRef& rhs) const {
   return length_ == rhs.length_ && ::memcmp(data_, rhs.data_, length_) == 0;
 };
 
+std::ostream& operator<<(std::ostream& os, const StringRef& s) {
+  return os.write(s.data(), s.size());
+}
+
+namespace {
+thread_local InternLog* gCurrInternLog = nullptr;
+}
+
+InternLog* InternLog::Current() { return gCurrInternLog; }
+
+InternLog::Scope::Scope(InternLog& log) : previous_(gCurrInternLog) { gCurrInternLog = &log; }
+
+InternLog::Scope::~Scope() { gCurrInternLog = previous_; }
+
 // Nifty Counter Idiom
 // https://en.wikibooks.org/wiki/More_C%2B%2B_Idioms/Nifty_Counter
 
@@ -0,0 +1,190 @@
+/*
+Copyright (c) 1995,1996 The Regents of the University of California.
+All rights reserved.
+
+Permission to use, copy, modify, and distribute this software for any
+purpose, without fee, and without written agreement is hereby granted,
+provided that the above copyright notice and the following two
+paragraphs appear in all copies of this software.
+
+IN NO EVENT SHALL THE UNIVERSITY OF CALIFORNIA BE LIABLE TO ANY PARTY FOR
+DIRECT, INDIRECT, SPECIAL, INCIDENTAL, OR CONSEQUENTIAL DAMAGES ARISING OUT
+OF THE USE OF THIS SOFTWARE AND ITS DOCUMENTATION, EVEN IF THE UNIVERSITY OF
+CALIFORNIA HAS BEEN ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+THE UNIVERSITY OF CALIFORNIA SPECIFICALLY DISCLAIMS ANY WARRANTIES,
+INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY
+AND FITNESS FOR A PARTICULAR PURPOSE.  THE SOFTWARE PROVIDED HEREUNDER IS
+ON AN "AS IS" BASIS, AND THE UNIVERSITY OF CALIFORNIA HAS NO OBLIGATION TO
+PROVIDE MAINTENANCE, SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
+
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "time_report.h"
+
+#include <sys/resource.h>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <ostream>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#endif
+
+namespace cool {
+
+TimeReport gTimeReport;
+
+namespace {
+
+std::size_t HeapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+#elif defined(__GLIBC__)
+  struct mallinfo info = mallinfo();  // Fields are int and so wrap above 2GB
+  return static_cast<unsigned>(info.uordblks) + static_cast<unsigned>(info.hblkhd);
+#elif defined(__APPLE__)
+  return mstats().bytes_used;
+#else
+  return 0;
+#endif
+}
+
+std::size_t PeakRSS() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+  return usage.ru_maxrss;  // In bytes
+#else
+  return usage.ru_maxrss * 1024;  // In KB
+#endif
+}
+
+double Seconds(const struct timeval& tv) { return tv.tv_sec + tv.tv_usec * 1e-6; }
+
+void PrintPhaseJSON(std::ostream& os, const TimeReport::Phase& phase) {
+  os << "{\"name\": \"";
+  for (char c : phase.name) {
+    if (c == '"' || c == '\\') os << '\\';
+    os << c;
+  }
+  os << "\", \"depth\": " << phase.depth << ", \"wall_seconds\": " << phase.wall_seconds
+     << ", \"cpu_seconds\": " << phase.cpu_seconds << ", \"heap_delta_bytes\": " << phase.heap_delta
+     << ", \"peak_rss_bytes\": " << phase.peak_rss << "}";
+}
+
+}  // namespace
+
+TimeReport::Sample TimeReport::Now() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return Sample{std::chrono::steady_clock::now(), Seconds(usage.ru_utime) + Seconds(usage.ru_stime),
+                HeapInUse()};
+}
+
+void TimeReport::Enable() {
+  if (!enabled_) {
+    enabled_ = true;
+    start_ = Now();
+  }
+}
+
+std::size_t TimeReport::Begin(const char* name) {
+  Phase phase;
+  phase.name = name;
+  phase.depth = depth_++;
+  phases_.push_back(phase);
+  starts_.push_back(Now());
+  return phases_.size() - 1;
+}
+
+void TimeReport::End(std::size_t index) {
+  Sample end = Now();
+  const Sample& start = starts_[index];
+  Phase& phase = phases_[index];
+  phase.wall_seconds = std::chrono::duration<double>(end.wall - start.wall).count();
+  phase.cpu_seconds = end.cpu_seconds - start.cpu_seconds;
+  phase.heap_delta = static_cast<std::int64_t>(end.heap) - static_cast<std::int64_t>(start.heap);
+  phase.peak_rss = PeakRSS();
+  depth_--;
+}
+
+TimeReport::Phase TimeReport::Total() const {
+  Sample end = Now();
+  Phase total;
+  total.name = "total";
+  total.depth = 0;
+  total.wall_seconds = std::chrono::duration<double>(end.wall - start_.wall).count();
+  total.cpu_seconds = end.cpu_seconds - start_.cpu_seconds;
+  total.heap_delta = static_cast<std::int64_t>(end.heap) - static_cast<std::int64_t>(start_.heap);
+  total.peak_rss = PeakRSS();
+  return total;
+}
+
+void TimeReport::PrintTable(std::ostream& os) const {
+  Phase total = Total();
+  auto print_row = [&](const Phase& phase) {
+    os << std::left << std::setw(32) << (std::string(2 * phase.depth, ' ') + phase.name)
+       << std::right << std::fixed << std::setprecision(3) << std::setw(10) << phase.wall_seconds
+       << std::setw(7) << std::setprecision(1)
+       << (total.wall_seconds > 0 ? 100 * phase.wall_seconds / total.wall_seconds : 0) << "%"
+       << std::setprecision(3) << std::setw(10) << phase.cpu_seconds << std::setw(14)
+       << std::showpos << phase.heap_delta / 1024 << std::noshowpos << std::setw(14)
+       << phase.peak_rss / 1024 << std::endl;
+  };
+
+  std::ios_base::fmtflags flags = os.flags();
+  os << std::left << std::setw(32) << "Phase" << std::right << std::setw(10) << "Wall (s)"
+     << std::setw(8) << "Wall" << std::setw(10) << "CPU (s)" << std::setw(14) << "Heap (KB)" << std::setw(14)
+     << "Peak RSS (KB)" << std::endl;
+  for (const Phase& phase : phases_) {
+    print_row(phase);
+  }
+  print_row(total);
+  os.flags(flags);
+}
+
+void TimeReport::PrintJSON(std::ostream& os) const {
+  os << "{\"phases\": [";
+  for (std::size_t i = 0; i < phases_.size(); i++) {
+    os << (i ? ",\n  " : "\n  ");
+    PrintPhaseJSON(os, phases_[i]);
+  }
+  os << "\n], \"total\": ";
+  PrintPhaseJSON(os, Total());
+  os << "}" << std::endl;
+}
+
+bool TimeReport::Report() const {
+  if (print_table_) {
+    PrintTable(std::cerr);
+  }
+  if (!json_filename_.empty()) {
+    std::ofstream json_stream(json_filename_);
+    if (!json_stream) {
+      std::cerr << "Cannot open time report file " << json_filename_ << std::endl;
+      return false;
+    }
+    PrintJSON(json_stream);
+  }
+  return true;
+}
+
+}  // namespace cool
@@ -93,7 +93,7 @@ const char* cool::cool_token_to_string(int tok) {
   }
 }
 
-void cool::print_cool_token(std::ostream& out, int tok) {
+void cool::print_cool_token(std::ostream& out, int tok, const YYSTYPE& yylval) {
 
   out << cool_token_to_string(tok);
 
@@ -101,31 +101,31 @@ void cool::print_cool_token(std::ostream& out, int tok) {
     case (STR_CONST):
       out << " = ";
       out << " \"";
-      print_escaped_string(out, static_cast<StringLiteral*>(cool_yylval.expression)->value());
+      print_escaped_string(out, static_cast<StringLiteral*>(yylval.expression)->value());
       out << "\"";
 #ifdef DEBUG
-      assert(gStringTable.has(static_cast<StringLiteral*>(cool_yylval.expression)->value()));
+      assert(gStringTable.has(static_cast<StringLiteral*>(yylval.expression)->value()));
 #endif
       break;
     case (INT_CONST):
-      out << " = " << static_cast<IntLiteral*>(cool_yylval.expression)->value();
+      out << " = " << static_cast<IntLiteral*>(yylval.expression)->value();
 #ifdef DEBUG
-      assert(gIntTable.has(static_cast<IntLiteral*>(cool_yylval.expression)->value()));
+      assert(gIntTable.has(static_cast<IntLiteral*>(yylval.expression)->value()));
 #endif
       break;
     case (BOOL_CONST):
-      out << (static_cast<BoolLiteral*>(cool_yylval.expression)->value() ? " = true" : " = false");
+      out << (static_cast<BoolLiteral*>(yylval.expression)->value() ? " = true" : " = false");
       break;
     case (TYPEID):
     case (OBJECTID):
-      out << " = " << cool_yylval.symbol;
+      out << " = " << yylval.symbol;
 #ifdef DEBUG
-      assert(gIdentTable.has(cool_yylval.symbol));
+      assert(gIdentTable.has(yylval.symbol));
 #endif
       break;
     case (ERROR):
       out << " = ";
-      print_escaped_string(out, cool_yylval.error_msg);
+      print_escaped_string(out, yylval.error_msg);
       break;
   }
 }
@@ -136,26 +136,26 @@ void cool::dump_cool_token(std::ostream& out, int lineno, int token, YYSTYPE yyl
   switch (token) {
     case (STR_CONST):
       out << " \"";
-      print_escaped_string(out, static_cast<StringLiteral*>(cool_yylval.expression)->value());
+      print_escaped_string(out, static_cast<StringLiteral*>(yylval.expression)->value());
       out << "\"";
 #ifdef DEBUG
-      assert(gStringTable.has(static_cast<StringLiteral*>(cool_yylval.expression)->value()));
+      assert(gStringTable.has(static_cast<StringLiteral*>(yylval.expression)->value()));
 #endif
       break;
     case (INT_CONST):
-      out << " " << static_cast<IntLiteral*>(cool_yylval.expression)->value();
+      out << " " << static_cast<IntLiteral*>(yylval.expression)->value();
 #ifdef DEBUG
-      assert(gIntTable.has(static_cast<IntLiteral*>(cool_yylval.expression)->value()));
+      assert(gIntTable.has(static_cast<IntLiteral*>(yylval.expression)->value()));
 #endif
       break;
     case (BOOL_CONST):
-      out << (static_cast<BoolLiteral*>(cool_yylval.expression)->value() ? " true" : " false");
+      out << (static_cast<BoolLiteral*>(yylval.expression)->value() ? " true" : " false");
       break;
     case (TYPEID):
     case (OBJECTID):
-      out << " " << cool_yylval.symbol;
+      out << " " << yylval.symbol;
 #ifdef DEBUG
-      assert(gIdentTable.has(cool_yylval.symbol));
+      assert(gIdentTable.has(yylval.symbol));
 #endif
       break;
     case (ERROR):
@@ -164,12 +164,12 @@ void cool::dump_cool_token(std::ostream& out, int lineno, int token, YYSTYPE yyl
       // if we see an "empty" string here, we can safely assume the
       // lexer is reporting an occurrence of an illegal NUL in the
       // input stream
-      if (cool_yylval.error_msg[0] == 0) {
+      if (yylval.error_msg[0] == 0) {
         out << " \"\\000\"";
       }
       else {
         out << " \"";
-        print_escaped_string(out, cool_yylval.error_msg);
+        print_escaped_string(out, yylval.error_msg);
         out << "\"";
         break;
       }
@@ -8,10 +8,11 @@ LEXER="lexer"
 PARSER="parser"
 SEMANT="semant"
 CGEN="cg"
+CGEN_FLAGS=""
 SPIM="spim"
 TRAP_HANDLER="trap.handler"
 
-while getopts "L:P:S:C:M:H:w:" Option
+while getopts "L:P:S:C:F:M:H:w:" Option
 do
     case $Option in
         L)
@@ -26,6 +27,9 @@ do
         C)
             CGEN=$OPTARG
             ;;
+        F)
+            CGEN_FLAGS=$OPTARG
+            ;;
         M)
             SPIM=$OPTARG
             ;;
@@ -42,7 +46,7 @@ done
 shift $((OPTIND-1))
 
 SFILE="${WD}/$(basename "$1").s"
-"$LEXER" "$1" | "$PARSER" | "$SEMANT" | "$CGEN" -o "$SFILE"
+"$LEXER" "$1" | "$PARSER" | "$SEMANT" | "$CGEN" $CGEN_FLAGS -o "$SFILE"
 "$SPIM" -exception_file "$TRAP_HANDLER" -f "$SFILE" | \
     grep -v "^All Rights Reserved." | \
     grep -v "^Loaded: "
@@ -0,0 +1,50 @@
+#!/usr/bin/env bash
+
+# Compile the Cool files listed in the test (one per line, relative to the test) as a single
+# program. The errors are merged into stdout, so they are compared in order.
+
+set -e
+
+WD="."
+
+COOL="coolc"
+COOL_FLAGS="-j 4"
+SPIM="spim"
+TRAP_HANDLER="trap.handler"
+
+while getopts "C:F:M:H:w:" Option
+do
+    case $Option in
+        C)
+            COOL=$OPTARG
+            ;;
+        F)
+            COOL_FLAGS=$OPTARG
+            ;;
+        M)
+            SPIM=$OPTARG
+            ;;
+        H)
+            TRAP_HANDLER=$OPTARG
+            ;;
+        w)
+            WD=$OPTARG
+            ;;
+
+    esac
+done
+
+shift $((OPTIND-1))
+
+FILES=()
+while read -r file; do
+    FILES+=("$(dirname "$1")/$file")
+done < "$1"
+
+SFILE="${WD}/$(basename "$1").s"
+"$COOL" $COOL_FLAGS -o "$SFILE" "${FILES[@]}" 2>&1
+"$SPIM" -exception_file "$TRAP_HANDLER" -f "$SFILE" | \
+    grep -v "^All Rights Reserved." | \
+    grep -v "^Loaded: " | \
+    grep -v "GenGC initialized in test mode." | \
+    grep -v "Garbage collecting ..."
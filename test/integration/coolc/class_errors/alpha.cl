@@ -0,0 +1,3 @@
+class Alpha inherits Zeta {
+  a() : Bool { 1 };
+};
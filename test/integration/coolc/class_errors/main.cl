@@ -0,0 +1,3 @@
+class Main {
+  main() : Object { (new Beta).a(1) };
+};
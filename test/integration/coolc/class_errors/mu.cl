@@ -0,0 +1,7 @@
+class Mu {
+  m(x : Int) : Int { x.unknown() };
+};
+
+class Beta inherits Alpha {
+  b() : String { z() };
+};
@@ -0,0 +1,3 @@
+class Zeta {
+  z() : Int { true };
+};
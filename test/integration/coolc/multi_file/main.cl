@@ -0,0 +1,9 @@
+class Main inherits IO {
+  main() : Object {
+    {
+      (new Shape).describe(self);
+      (new Square).describe(self);
+      out_string((new Square).type_name().concat("\n"));
+    }
+  };
+};
@@ -0,0 +1,3 @@
+class Named {
+  name() : String { "shape" };
+};
@@ -0,0 +1,5 @@
+(* Classes are used before, and inherit from classes in, files later on the command line *)
+class Shape inherits Named {
+  area() : Int { 0 };
+  describe(io : IO) : IO { io.out_string(name()).out_string(" ").out_int(area()).out_string("\n") };
+};
@@ -0,0 +1,5 @@
+class Square inherits Shape {
+  side : Int <- 3;
+  name() : String { "square" };
+  area() : Int { side * side };
+};
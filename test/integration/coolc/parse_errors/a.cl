@@ -0,0 +1,3 @@
+class A {
+  a() : Int { 1 };
+};
@@ -0,0 +1,3 @@
+class B {
+  b() : Int { 1 + };
+};
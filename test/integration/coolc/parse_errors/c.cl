@@ -0,0 +1,3 @@
+class C {
+  c : Int <- 1 # 2;
+};
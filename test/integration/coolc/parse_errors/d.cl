@@ -0,0 +1,3 @@
+class D inherits A {
+  d() : Int { a() };
+};
@@ -0,0 +1,5 @@
+class Main {
+  main() : Object {
+    let x : Int <- 1 in x x
+  };
+};
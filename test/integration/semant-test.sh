@@ -5,8 +5,9 @@ WD="."
 LEXER="lexer"
 PARSER="parser"
 SEMANT="semant"
+SEMANT_FLAGS=""
 
-while getopts "L:P:S:w:" Option
+while getopts "L:P:S:F:w:" Option
 do
     case $Option in
         L)
@@ -18,6 +19,9 @@ do
         S)
             SEMANT=$OPTARG
             ;;
+        F)
+            SEMANT_FLAGS=$OPTARG
+            ;;
         w)
             WD=$OPTARG
             ;;
@@ -26,4 +30,4 @@ done
 
 shift $((OPTIND-1))
 
-"$LEXER" "$1" | "$PARSER" | "$SEMANT"
\ No newline at end of file
+"$LEXER" "$1" | "$PARSER" | "$SEMANT" $SEMANT_FLAGS
\ No newline at end of file
@@ -15,6 +15,7 @@ limitations under the License.
 */
 #include <gtest/gtest.h>
 #include "ast.h"
+#include "ast_context.h"
 
 // Symbols defined in ast_consumer.cc
 namespace cool {
@@ -42,3 +43,32 @@ TEST(gIdentTableTest, InitializesPredefinedSymbols) {
     ASSERT_TRUE(arg);
     EXPECT_TRUE(gIdentTable.has("arg"));
 }
+
+TEST(ASTContextTest, AllocatesNodesInCurrentContext) {
+  using namespace cool;
+
+  ASTContext context;
+  {
+    ASTContext::Scope scope(context);
+    EXPECT_EQ(&context, &ASTContext::Current());
+
+    Expression* lhs = IntLiteral::Create(1);
+    Expression* rhs = IntLiteral::Create(2);
+    Expressions* body = Expressions::Create({lhs, rhs});
+    Block* block = Block::Create(body);
+    EXPECT_EQ(2UL, body->size());
+
+    // Nodes are allocated contiguously, in order of creation
+    EXPECT_LT(reinterpret_cast<char*>(lhs), reinterpret_cast<char*>(rhs));
+    EXPECT_LT(reinterpret_cast<char*>(rhs), reinterpret_cast<char*>(block));
+    EXPECT_LT(reinterpret_cast<char*>(block) - reinterpret_cast<char*>(lhs), 256);
+    EXPECT_GE(context.bytes_allocated(),
+              sizeof(IntLiteral) * 2 + sizeof(Expressions) + sizeof(Block));
+  }
+  EXPECT_NE(&context, &ASTContext::Current());
+
+  // Nodes created outside of the scope are not allocated in the context
+  std::size_t allocated = context.bytes_allocated();
+  IntLiteral::Create(3);
+  EXPECT_EQ(allocated, context.bytes_allocated());
+}
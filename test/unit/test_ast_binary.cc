@@ -0,0 +1,86 @@
+/*
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <sstream>
+#include "ast.h"
+#include "ast_binary.h"
+
+namespace {
+
+cool::Program* MakeProgram() {
+  using namespace cool;
+  auto Int = gIdentTable.emplace("Int");
+  auto x = gIdentTable.emplace("x");
+
+  auto sum = BinaryOperator::Create(BinaryOperator::BinaryKind::BO_Add, Ref::Create(x, 3),
+                                    IntLiteral::Create(42, 3), 3);
+  sum->set_type(Int);
+  auto body = Let::Create(x, Int, IntLiteral::Create(-7, 2), sum, 2);
+  auto method = Method::Create(gIdentTable.emplace("f"),
+                               Formals::Create(Formal::Create(gIdentTable.emplace("y"), Int, 1)),
+                               Int, body, 1);
+  auto attr = Attr::Create(gIdentTable.emplace("s"), gIdentTable.emplace("String"),
+                           StringLiteral::Create("tab\tand \"quote\""), 4);
+  auto klass = Klass::Create(gIdentTable.emplace("A"), gIdentTable.emplace("Object"),
+                             Features::Create({method, attr}), StringLiteral::Create("a.cl"), 1);
+  return Program::Create(Klasses::Create(klass), 1);
+}
+
+}  // anonymous namespace
+
+TEST(BinaryASTTest, RoundTripsTree) {
+  using namespace cool;
+  auto program = MakeProgram();
+
+  for (bool with_types : {false, true}) {
+    std::stringstream binary;
+    DumpBinaryAST(binary, program, with_types);
+    ASSERT_TRUE(IsBinaryAST(binary));
+
+    auto copy = ReadBinaryAST(binary);
+    ASSERT_NE(nullptr, copy);
+
+    std::ostringstream expected, actual;
+    program->DumpTree(expected, 0, with_types);
+    copy->DumpTree(actual, 0, with_types);
+    EXPECT_EQ(expected.str(), actual.str());
+  }
+}
+
+TEST(BinaryASTTest, IsSmallerThanText) {
+  auto program = MakeProgram();
+
+  std::ostringstream binary, text;
+  cool::DumpBinaryAST(binary, program, true);
+  program->DumpTree(text, 0, true);
+  EXPECT_LT(binary.str().size(), text.str().size());
+}
+
+TEST(BinaryASTTest, DetectsTextFormat) {
+  std::istringstream text("#1\n_program\n");
+  EXPECT_FALSE(cool::IsBinaryAST(text));
+}
+
+TEST(BinaryASTTest, RejectsTableSizeBeyondInput) {
+  std::ostringstream binary;
+  cool::DumpBinaryAST(binary, MakeProgram(), false);
+
+  // Replace the number of symbols, which follows the magic number and version, with 2^32 - 1
+  std::string corrupt = binary.str();
+  corrupt.replace(12, 4, "\xff\xff\xff\xff");
+  std::istringstream input(corrupt);
+  EXPECT_EXIT(cool::ReadBinaryAST(input), ::testing::ExitedWithCode(1), "Malformed binary AST");
+}
@@ -0,0 +1,123 @@
+/*
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <sstream>
+#include "emit.h"
+#include "mips.h"
+
+using namespace cool;
+
+namespace {
+std::string Print(const MipsCode& code) {
+    std::ostringstream os;
+    os << code;
+    return os.str();
+}
+}
+
+TEST(MipsCodeTest, PrintsOperandsOfEachForm) {
+    MipsCode code;
+    code.Label("Main.main");
+    code.Lw(T1, 12, ACC);
+    code.Sw(ACC, 0, SP);
+    code.Addiu(SP, SP, -4);
+    code.La(ACC, "int_const0");
+    code.Add(T1, T1, T2);
+    code.Beqz(T1, 3);
+    code.Branch(MipsOp::kBlt, T2, 5, 3);
+    code.Lw(ACC, INTCACHE, T2);
+    code.Label(3);
+    code.Jr(RA);
+
+    EXPECT_EQ(
+        "Main.main:\n"
+        "\tlw\t$t1 12($a0)\n"
+        "\tsw\t$a0 0($sp)\n"
+        "\taddiu\t$sp $sp -4\n"
+        "\tla\t$a0 int_const0\n"
+        "\tadd\t$t1 $t1 $t2\n"
+        "\tbeqz\t$t1 label3\n"
+        "\tblt\t$t2 5 label3\n"
+        "\tlw\t$a0 _int_cache($t2)\n"
+        "label3:\n"
+        "\tjr\t$ra\t\n",
+        Print(code));
+    EXPECT_EQ(9, code.size());
+}
+
+TEST(MipsCodeTest, KeepsSpellingOfInstruction) {
+    MipsCode code;
+    code.B(1);
+    code.B(1, MipsSpacing::kTabSpace);
+    code.Jal("Object.copy");
+    code.Jal("_dispatch_abort", MipsSpacing::kSpace);
+
+    EXPECT_EQ(
+        "\tb\tlabel1\n"
+        "\tb\t label1\n"
+        "\tjal\tObject.copy\n"
+        "\tjal _dispatch_abort\n",
+        Print(code));
+}
+
+TEST(MipsCodeTest, InstructionsCanBeRewritten) {
+    MipsCode code;
+    code.Move(T1, ACC);
+    code.instrs()[0].rs = SELF;
+    EXPECT_EQ(MipsOp::kMove, code.instrs()[0].op);
+    EXPECT_EQ("\tmove\t$t1 $s0\n", Print(code));
+}
+
+TEST(MipsCodeTest, FindsRegistersReadAndWritten) {
+    MipsCode code;
+    code.Sw(ACC, 12, SELF);
+    code.Lw(T1, 4, SP);
+    code.Li(ACC, 1);
+    code.Beq(T1, T2, 1);
+
+    const auto& instrs = code.instrs();
+    EXPECT_TRUE(instrs[0].Reads(ACC));
+    EXPECT_TRUE(instrs[0].Reads(SELF));
+    EXPECT_EQ(nullptr, instrs[0].Written());
+    EXPECT_TRUE(instrs[1].Mentions(SP));
+    EXPECT_TRUE(SameRegister(T1, instrs[1].Written()));
+    EXPECT_FALSE(instrs[2].Reads(ACC));
+    EXPECT_TRUE(instrs[2].Mentions(ACC));
+    EXPECT_TRUE(instrs[3].IsControl());
+    EXPECT_TRUE(instrs[3].Reads(T2));
+    EXPECT_EQ(nullptr, instrs[3].Written());
+}
+
+TEST(MipsCodeTest, RebasesLocalLabels) {
+    MipsCode code;
+    code.Label("Main.main");
+    int loop = code.NewLabel();
+    int done = code.NewLabel();
+    code.Label(loop);
+    code.Beqz(T1, done);
+    code.B(loop);
+    code.Label(done);
+    EXPECT_EQ(2, code.num_labels());
+
+    code.RebaseLabels(5);
+    EXPECT_EQ(
+        "Main.main:\n"
+        "label5:\n"
+        "\tbeqz\t$t1 label6\n"
+        "\tb\tlabel5\n"
+        "label6:\n",
+        Print(code));
+}
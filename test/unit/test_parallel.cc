@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#include "parallel.h"
+
+using namespace cool;
+
+namespace {
+
+class ParallelForTest : public ::testing::Test {
+ protected:
+    void SetUp() override { saved_ = gNumThreads; }
+    void TearDown() override { gNumThreads = saved_; }
+
+ private:
+    int saved_;
+};
+
+}
+
+TEST_F(ParallelForTest, CallsEachIndexOnce) {
+    for (int threads : {1, 4}) {
+        gNumThreads = threads;
+        std::vector<int> calls(1000);
+        ParallelFor(calls.size(), [&](std::size_t i) { calls[i]++; });
+        for (int n : calls) {
+            EXPECT_EQ(1, n);
+        }
+    }
+}
+
+TEST_F(ParallelForTest, RethrowsException) {
+    gNumThreads = 4;
+    EXPECT_THROW(ParallelFor(100, [](std::size_t i) {
+        if (i == 42) {
+            throw std::runtime_error("failed");
+        }
+    }), std::runtime_error);
+}
@@ -0,0 +1,125 @@
+/*
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include <sstream>
+#include "emit.h"
+#include "peephole.h"
+
+using namespace cool;
+
+namespace {
+std::string Print(const MipsCode& code) {
+    std::ostringstream os;
+    os << code;
+    return os.str();
+}
+}
+
+TEST(PeepholeOptimizerTest, ForwardsStoreToLoad) {
+    MipsCode code;
+    code.Sw(ACC, 28, SELF);
+    code.Lw(ACC, 28, SELF);
+    code.Sw(ACC, 12, FP);
+    code.Lw(T1, 12, FP);
+    code.Lw(T2, 16, FP);
+
+    PeepholeOptimizer peephole;
+    peephole.Run(code);
+    EXPECT_EQ(
+        "\tsw\t$a0 28($s0)\n"
+        "\tsw\t$a0 12($fp)\n"
+        "\tmove\t$t1 $a0\n"
+        "\tlw\t$t2 16($fp)\n",
+        Print(code));
+    EXPECT_EQ(2, peephole.hits(PeepholeRule::kStoreLoad));
+}
+
+TEST(PeepholeOptimizerTest, ReplacesPushAndPopWithMove) {
+    MipsCode code;
+    code.Sw(ACC, 0, SP);
+    code.Addiu(SP, SP, -4);
+    code.Li(ACC, 15);
+    code.Lw(T1, 4, SP);
+    code.Addiu(SP, SP, 4);
+    code.Add(ACC, T1, ACC);
+
+    PeepholeOptimizer peephole;
+    peephole.Run(code);
+    EXPECT_EQ(
+        "\tmove\t$t1 $a0\n"
+        "\tli\t$a0 15\n"
+        "\tadd\t$a0 $t1 $a0\n",
+        Print(code));
+    EXPECT_EQ(1, peephole.hits(PeepholeRule::kPushPop));
+}
+
+TEST(PeepholeOptimizerTest, KeepsPushAcrossCall) {
+    MipsCode code;
+    code.Sw(ACC, 0, SP);
+    code.Addiu(SP, SP, -4);
+    code.Jal("Object.copy");
+    code.Lw(T1, 4, SP);
+    code.Addiu(SP, SP, 4);
+    code.Addiu(SP, SP, 8);
+
+    PeepholeOptimizer peephole;
+    peephole.Run(code);
+    EXPECT_EQ(
+        "\tsw\t$a0 0($sp)\n"
+        "\taddiu\t$sp $sp -4\n"
+        "\tjal\tObject.copy\n"
+        "\tlw\t$t1 4($sp)\n"
+        "\taddiu\t$sp $sp 12\n",
+        Print(code));
+    EXPECT_EQ(0, peephole.hits(PeepholeRule::kPushPop));
+    EXPECT_EQ(1, peephole.hits(PeepholeRule::kStackAdjust));
+}
+
+TEST(PeepholeOptimizerTest, RemovesRedundantMovesAndDeadWrites) {
+    MipsCode code;
+    code.Move(S2, ACC);
+    code.Move(ACC, S2);
+    code.Move(ACC, ZERO);
+    code.Move(ACC, SELF);
+    code.Label(1);
+    code.Move(T1, T1);
+    code.Li(T1, 1);
+
+    PeepholeOptimizer peephole;
+    peephole.Run(code);
+    EXPECT_EQ(
+        "\tmove\t$s2 $a0\n"
+        "\tmove\t$a0 $s0\n"
+        "label1:\n"
+        "\tli\t$t1 1\n",
+        Print(code));
+    EXPECT_EQ(2, peephole.hits(PeepholeRule::kRedundantMove));
+    EXPECT_EQ(1, peephole.hits(PeepholeRule::kDeadWrite));
+}
+
+TEST(PeepholeOptimizerTest, DoesNotMatchAcrossLabel) {
+    MipsCode code;
+    code.Sw(ACC, 12, FP);
+    code.Label(2);
+    code.Lw(ACC, 12, FP);
+    code.Li(T1, 0);
+    code.Beqz(T1, 2);
+    code.Li(T1, 1);
+
+    PeepholeOptimizer peephole;
+    peephole.Run(code);
+    EXPECT_EQ(6, code.instrs().size());
+}
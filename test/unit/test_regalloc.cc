@@ -0,0 +1,92 @@
+/*
+Copyright 2017-2019 Michael Linderman.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+#include <gtest/gtest.h>
+#include "ast.h"
+#include "regalloc.h"
+
+using namespace cool;
+
+namespace {
+const Register kS1 = "$s1";
+const Register kS2 = "$s2";
+}
+
+TEST(RegisterAllocatorTest, ReusesRegistersOfExpiredIntervals) {
+    RegisterAllocator regs({kS1, kS2});
+    auto a = NoExpr::Create(), b = NoExpr::Create(), c = NoExpr::Create();
+    regs.Begin(a);
+    regs.Begin(b);
+    regs.End(b);
+    regs.Begin(c);
+    regs.End(c);
+    regs.End(a);
+    regs.Allocate();
+
+    EXPECT_EQ(kS1, regs.Find(a));
+    EXPECT_EQ(kS2, regs.Find(b));
+    EXPECT_EQ(kS2, regs.Find(c));
+    EXPECT_EQ(0, regs.num_spilled());
+    EXPECT_EQ(std::vector<Register>({kS1, kS2}), regs.used());
+}
+
+TEST(RegisterAllocatorTest, SpillsIntervalEndingLast) {
+    RegisterAllocator regs({kS1});
+    auto outer = NoExpr::Create(), inner = NoExpr::Create(), after = NoExpr::Create();
+    regs.Begin(outer);
+    regs.Begin(inner);
+    regs.End(inner);
+    regs.Begin(after);
+    regs.End(after);
+    regs.End(outer);
+    regs.Allocate();
+
+    // The outer interval gives up its register to the nested intervals
+    EXPECT_EQ(kNullRegister, regs.Find(outer));
+    EXPECT_EQ(kS1, regs.Find(inner));
+    EXPECT_EQ(kS1, regs.Find(after));
+    EXPECT_EQ(1, regs.num_spilled());
+}
+
+TEST(RegisterAllocatorTest, SkipsLightValues) {
+    RegisterAllocator regs({kS1}, 3);
+    auto light = NoExpr::Create(), heavy = NoExpr::Create(), unknown = NoExpr::Create();
+    regs.Begin(light);
+    regs.AddWeight(light, 2);
+    regs.End(light);
+    regs.Begin(heavy);
+    regs.AddWeight(heavy, 3);
+    regs.End(heavy);
+    regs.Allocate();
+
+    EXPECT_EQ(kNullRegister, regs.Find(light));
+    EXPECT_EQ(kS1, regs.Find(heavy));
+    EXPECT_EQ(kNullRegister, regs.Find(unknown));
+    EXPECT_EQ(0, regs.num_spilled());
+}
+
+TEST(RegisterAllocatorTest, DistinguishesValuesOfNode) {
+    RegisterAllocator regs({kS1, kS2});
+    auto node = NoExpr::Create();
+    regs.Begin(node);
+    regs.Begin(node, 1);
+    regs.End(node, 1);
+    regs.End(node);
+    regs.Allocate();
+
+    EXPECT_EQ(kS1, regs.Find(node));
+    EXPECT_EQ(kS2, regs.Find(node, 1));
+    EXPECT_EQ(kNullRegister, regs.Find(node, 2));
+}
@@ -17,7 +17,17 @@ limitations under the License.
 #include "stringtab.h"
 #include "scopedtab.h"
 
-TEST(SymTabTest, ReturnsMostCloselyNestedScope) {
+// Run the same tests against each ScopedTable implementation
+template <class Table>
+class SymTabTest : public ::testing::Test {};
+
+typedef ::testing::Types<cool::ScopedTable<cool::Symbol*, int*>,
+                         cool::PersistentScopedTable<cool::Symbol*, int*>,
+                         cool::FlatScopedTable<cool::Symbol*, int*>>
+    ScopedTableTypes;
+TYPED_TEST_SUITE(SymTabTest, ScopedTableTypes);
+
+TYPED_TEST(SymTabTest, ReturnsMostCloselyNestedScope) {
   // Create string table and test keys (we don't use gIdentTable to prevent crosstalk with
   // other tests)
   cool::SymbolTable<cool::Symbol> string_table;
@@ -26,7 +36,7 @@ TEST(SymTabTest, ReturnsMostCloselyNestedScope) {
   // Possible values
   int a=1, b=2, c=3;
 
-  cool::ScopedTable<cool::Symbol*,int*> table;
+  TypeParam table;
 
   ASSERT_EQ(nullptr, table.Lookup(foo));
 
@@ -50,7 +60,7 @@ TEST(SymTabTest, ReturnsMostCloselyNestedScope) {
   EXPECT_EQ(nullptr, table.Lookup(baz));
 }
 
-TEST(SymTabTest, CopyConstructsTable) {
+TYPED_TEST(SymTabTest, CopyConstructsTable) {
   // Create string table and test keys (we don't use gIdentTable to prevent crosstalk with
   // other tests)
   cool::SymbolTable<cool::Symbol> string_table;
@@ -59,7 +69,7 @@ TEST(SymTabTest, CopyConstructsTable) {
   // Possible values
   int a=1, b=2, c=3;
 
-  cool::ScopedTable<cool::Symbol*,int*> table1;
+  TypeParam table1;
 
   table1.EnterScope();
   table1.AddToScope(foo, &a);
@@ -67,7 +77,7 @@ TEST(SymTabTest, CopyConstructsTable) {
   table1.EnterScope();
   table1.AddToScope(baz, &c);
 
-  cool::ScopedTable<cool::Symbol*,int*> table2(table1);
+  TypeParam table2(table1);
   EXPECT_EQ(&c, table2.Probe(baz));
   EXPECT_EQ(nullptr, table2.Probe(bar));
   table2.ExitScope();
@@ -75,7 +85,7 @@ TEST(SymTabTest, CopyConstructsTable) {
   EXPECT_EQ(&b, table2.Probe(bar));
 }
 
-TEST(SymTabTest, DumpsTable) {
+TYPED_TEST(SymTabTest, DumpsTable) {
   // Create string table and test keys (we don't use gIdentTable to prevent crosstalk with
   // other tests)
   cool::SymbolTable<cool::Symbol> string_table;
@@ -85,7 +95,7 @@ TEST(SymTabTest, DumpsTable) {
   // Possible values
   int a = 1, b = 2, c = 3;
 
-  cool::ScopedTable<cool::Symbol *, int*> table1;
+  TypeParam table1;
 
   table1.EnterScope();
   table1.AddToScope(foo, &a);
@@ -106,3 +116,62 @@ foo: 1
 )");
     EXPECT_EQ(expected, output.str());
 }
+
+TEST(PersistentSymTabTest, SharesScopesWithCopy) {
+  cool::SymbolTable<cool::Symbol> string_table;
+  cool::Symbol *foo = string_table.emplace("foo"), *bar = string_table.emplace("bar"),
+               *baz = string_table.emplace("baz");
+
+  // Possible values
+  int a = 1, b = 2, c = 3;
+
+  cool::PersistentScopedTable<cool::Symbol*, int*> parent;
+  parent.EnterScope();
+  parent.AddToScope(foo, &a);
+
+  // Extending the copy should not modify the original
+  cool::PersistentScopedTable<cool::Symbol*, int*> child(parent);
+  child.AddToScope(bar, &b);
+  child.EnterScope();
+  child.AddToScope(foo, &c);
+  EXPECT_EQ(&c, child.Lookup(foo));
+  EXPECT_EQ(&b, child.Lookup(bar));
+  EXPECT_EQ(&a, parent.Lookup(foo));
+  EXPECT_EQ(nullptr, parent.Lookup(bar));
+
+  // Extending the original should not modify the copy
+  parent.AddToScope(baz, &b);
+  EXPECT_EQ(&b, parent.Probe(baz));
+  EXPECT_EQ(nullptr, child.Lookup(baz));
+
+  child.ExitScope();
+  EXPECT_EQ(&a, child.Lookup(foo));
+  EXPECT_EQ(&b, child.Probe(bar));
+  EXPECT_THROW(child.AddToScope(bar, &c), std::invalid_argument);
+}
+
+TYPED_TEST(SymTabTest, RebindsKeysAfterExitScope) {
+  cool::SymbolTable<cool::Symbol> string_table;
+  cool::Symbol *foo = string_table.emplace("foo"), *bar = string_table.emplace("bar");
+
+  // Possible values
+  int a = 1, b = 2, c = 3;
+
+  TypeParam table;
+  table.EnterScope();
+  table.AddToScope(foo, &a);
+  for (int i = 0; i < 3; i++) {
+    table.EnterScope();
+    EXPECT_EQ(nullptr, table.Probe(foo));
+    table.AddToScope(foo, &b);
+    table.AddToScope(bar, &c);
+    EXPECT_THROW(table.AddToScope(bar, &c), std::invalid_argument);
+    EXPECT_EQ(&b, table.Lookup(foo));
+    table.ExitScope();
+    EXPECT_EQ(&a, table.Probe(foo));
+    EXPECT_EQ(nullptr, table.Lookup(bar));
+  }
+  table.ExitScope();
+  table.ExitScope();  // Exiting with no scopes is a no-op
+  EXPECT_EQ(nullptr, table.Lookup(foo));
+}
@@ -14,6 +14,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 #include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
 #include "stringtab.h"
 
 TEST(StringTableTest, MaintainsUniqueIdentifiers) {
@@ -54,3 +57,127 @@ TEST(StringTableTest, CanEmplaceSymbol) {
   EXPECT_NE(sym1_2, sym2_1);
   EXPECT_EQ(sym1_2->value(), sym2_1->value());
 }
+
+TEST(StringTableTest, EntriesStableAcrossGrowth) {
+  cool::SymbolTable<cool::Symbol> string_table;
+  cool::Symbol* first = string_table.emplace("Object");
+  std::vector<cool::Symbol*> syms;
+  for (int i = 0; i < 10000; i++) {
+    syms.push_back(string_table.emplace("sym" + std::to_string(i)));
+  }
+  EXPECT_EQ(10001UL, string_table.size());
+  EXPECT_EQ(first, string_table.lookup("Object"));
+  for (int i = 0; i < 10000; i++) {
+    std::string str("sym" + std::to_string(i));
+    EXPECT_EQ(syms[i], string_table.lookup(str));
+    EXPECT_EQ(i + 1UL, syms[i]->id());
+    EXPECT_EQ(str, syms[i]->value().str());
+  }
+}
+
+TEST(StringTableTest, IteratesInIdOrder) {
+  cool::SymbolTable<cool::Int32Entry> int_table;
+  for (int32_t i = 500; i > 0; i--) {
+    int_table.emplace(i);
+  }
+  std::size_t id = 0;
+  for (auto entry : int_table) {
+    EXPECT_EQ(id++, entry->id());
+    EXPECT_EQ(500 - static_cast<int32_t>(entry->id()), entry->value());
+  }
+  EXPECT_EQ(500UL, id);
+}
+
+TEST(StringTableTest, CopiesStringValue) {
+  cool::SymbolTable<cool::StringEntry> string_table;
+  std::string str(1000, 'a');
+  str[10] = '\0';  // Keys are not NUL-terminated
+  cool::StringEntry* entry = string_table.emplace(str);
+  str[0] = 'b';
+  EXPECT_EQ(1000UL, entry->value().size());
+  EXPECT_EQ('a', entry->c_str()[0]);
+  EXPECT_EQ('\0', entry->c_str()[1000]);
+  EXPECT_EQ(cool::HashKey(entry->value()), entry->hash());
+  EXPECT_EQ(nullptr, string_table.lookup(str));
+}
+
+TEST(StringTableTest, ConcurrentEmplaceMaintainsUniqueEntries) {
+  cool::SymbolTable<cool::Symbol> string_table;
+  std::vector<std::vector<cool::Symbol*>> syms(4, std::vector<cool::Symbol*>(1000));
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < syms.size(); t++) {
+    threads.emplace_back([&, t]() {
+      for (std::size_t i = 0; i < syms[t].size(); i++) {
+        syms[t][i] = string_table.emplace(std::to_string(i));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(1000UL, string_table.size());
+  for (std::size_t i = 0; i < syms[0].size(); i++) {
+    EXPECT_EQ(std::to_string(i), syms[0][i]->c_str());
+    for (std::size_t t = 1; t < syms.size(); t++) {
+      EXPECT_EQ(syms[0][i], syms[t][i]);
+    }
+  }
+  std::size_t id = 0;
+  for (auto entry : string_table) {
+    EXPECT_EQ(id++, entry->id());
+  }
+}
+
+TEST(StringTableTest, InternLogAssignsIdsInLogOrder) {
+  cool::SymbolTable<cool::Symbol> string_table;
+  string_table.emplace("Object");
+
+  // Intern "Int" first, but in the second log
+  cool::InternLog logs[2];
+  {
+    cool::InternLog::Scope scope(logs[1]);
+    string_table.emplace("Int");
+    string_table.emplace("Bool");
+  }
+  {
+    cool::InternLog::Scope scope(logs[0]);
+    string_table.emplace("String");
+    string_table.emplace("Int");
+    string_table.emplace("Object");
+  }
+  EXPECT_EQ(1UL, string_table.size());
+
+  for (auto& log : logs) {
+    log.AssignIds();
+  }
+  ASSERT_EQ(4UL, string_table.size());
+  EXPECT_EQ(0UL, string_table.lookup("Object")->id());
+  EXPECT_EQ(1UL, string_table.lookup("String")->id());
+  EXPECT_EQ(2UL, string_table.lookup("Int")->id());
+  EXPECT_EQ(3UL, string_table.lookup("Bool")->id());
+}
+
+TEST(StringTableTest, InternLogRecordsEachEntryOnce) {
+  cool::SymbolTable<cool::Symbol> string_table;
+  string_table.emplace("Object");
+
+  cool::InternLog log;
+  {
+    cool::InternLog::Scope scope(log);
+    for (int i = 0; i < 100; ++i) {
+      string_table.emplace("Int");
+      string_table.emplace("Object");  // Already has an id, not recorded
+    }
+    EXPECT_EQ(1UL, log.size());
+    string_table.emplace("Bool");
+    string_table.emplace("Int");
+  }
+  EXPECT_EQ(2UL, log.size());
+
+  log.AssignIds();
+  EXPECT_EQ(0UL, log.size());
+  ASSERT_EQ(3UL, string_table.size());
+  EXPECT_EQ(1UL, string_table.lookup("Int")->id());
+  EXPECT_EQ(2UL, string_table.lookup("Bool")->id());
+}
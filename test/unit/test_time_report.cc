@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include <sstream>
+#include <vector>
+#include "time_report.h"
+
+using namespace cool;
+
+namespace {
+
+class TimeReportTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        saved_ = gTimeReport;
+        gTimeReport = TimeReport();
+    }
+    void TearDown() override { gTimeReport = saved_; }
+
+ private:
+    TimeReport saved_;
+};
+
+}
+
+TEST_F(TimeReportTest, DisabledRecordsNothing) {
+    TimePhase("parse", []() {});
+    EXPECT_TRUE(gTimeReport.phases().empty());
+}
+
+TEST_F(TimeReportTest, RecordsNestedPhasesInStartOrder) {
+    gTimeReport.Enable();
+    {
+        PhaseTimer outer("cgen");
+        TimePhase("CgenConstants", []() {});
+        TimePhase("CgenUnits", []() {
+            std::vector<char> buffer(1 << 20, 1);  // Allocate during the phase
+            EXPECT_EQ(1, buffer.back());
+        });
+    }
+    TimePhase("semant", []() {});
+
+    const auto& phases = gTimeReport.phases();
+    ASSERT_EQ(4UL, phases.size());
+    EXPECT_EQ("cgen", phases[0].name);
+    EXPECT_EQ(0, phases[0].depth);
+    EXPECT_EQ("CgenConstants", phases[1].name);
+    EXPECT_EQ(1, phases[1].depth);
+    EXPECT_EQ("CgenUnits", phases[2].name);
+    EXPECT_EQ(1, phases[2].depth);
+    EXPECT_EQ("semant", phases[3].name);
+    EXPECT_EQ(0, phases[3].depth);
+    for (const auto& phase : phases) {
+        EXPECT_LE(0, phase.wall_seconds);
+        EXPECT_LT(0UL, phase.peak_rss);
+    }
+    EXPECT_LE(phases[1].wall_seconds + phases[2].wall_seconds, phases[0].wall_seconds);
+}
+
+TEST_F(TimeReportTest, StopEndsPhaseOnce) {
+    gTimeReport.Enable();
+    PhaseTimer timer("SemantKlassTable");
+    timer.Stop();
+    TimePhase("make_all_sctables", []() {});
+    timer.Stop();
+
+    ASSERT_EQ(2UL, gTimeReport.phases().size());
+    EXPECT_EQ(0, gTimeReport.phases()[1].depth);
+}
+
+TEST_F(TimeReportTest, PrintsTableAndJSON) {
+    gTimeReport.Enable();
+    TimePhase("allBinding", []() {});
+
+    std::ostringstream table;
+    gTimeReport.PrintTable(table);
+    EXPECT_NE(std::string::npos, table.str().find("allBinding"));
+    EXPECT_NE(std::string::npos, table.str().find("total"));
+
+    std::ostringstream json;
+    gTimeReport.PrintJSON(json);
+    EXPECT_EQ(0UL, json.str().find("{\"phases\": [\n  {\"name\": \"allBinding\", \"depth\": 0, "));
+    EXPECT_NE(std::string::npos, json.str().find("\"total\": {\"name\": \"total\""));
+}